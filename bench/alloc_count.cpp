@@ -0,0 +1,43 @@
+// Counting global operator new/delete for bench_alloc.sh. Linked into a tool (daq_threshold,
+// daq_sw), it replaces the allocator of the whole process, ROOT's libraries included, and
+// prints the number of operator new calls at exit:
+//   [alloc] N operator new calls
+// malloc() calls made directly (C code, zlib) are not counted.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocs{0};
+
+static void* counted_alloc(size_t n, size_t align = 0){
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = nullptr;
+    if(align > alignof(std::max_align_t)){ if(posix_memalign(&p, align, n ? n : 1)) p = nullptr; }
+    else p = std::malloc(n ? n : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new(size_t n){ return counted_alloc(n); }
+void* operator new[](size_t n){ return counted_alloc(n); }
+void* operator new(size_t n, std::align_val_t a){ return counted_alloc(n, (size_t)a); }
+void* operator new[](size_t n, std::align_val_t a){ return counted_alloc(n, (size_t)a); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept { try { return counted_alloc(n); } catch(...){ return nullptr; } }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { try { return counted_alloc(n); } catch(...){ return nullptr; } }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+struct Report {
+    ~Report(){ fprintf(stderr, "[alloc] %llu operator new calls\n", (unsigned long long)g_allocs.load()); }
+} g_report;
+}
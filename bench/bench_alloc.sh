@@ -0,0 +1,86 @@
+#!/usr/bin/env bash
+set -euo pipefail
+# Heap allocations and write latency per event of the real tools against the simulated digitizer
+# (sim/CAENDigitizer.h), for the working tree and a base commit built the same way.
+# daq_threshold and daq_sw are linked with bench/alloc_count.cpp (counting operator new, whole
+# process, ROOT included) and each case runs twice, with N and 2N events:
+#   allocs/ev : (allocations(2N) - allocations(N)) / N, so setup and finalize cancel out but
+#               per-event costs that ROOT defers (keys, basket flushes) are included
+#   p50..max  : the write stage's root_ns histogram of the 2N run ([perf] line), in us
+# Usage: bench_alloc.sh [N_EVENTS] [BASE_REF] [RATE_HZ]
+#   BASE_REF: commit to compare with (default: the commit before the TH1I/TGraph reuse)
+# daq_sw has a fixed 10 ms per software trigger, so it runs N/20 and N/10 waveforms.
+# Exit status 1 if a working-tree case allocates more per event than ROOT's own work needs
+# (-c 0 saves one channel, so th1 and daq_sw write one key per event):
+#   tree/packed   ALLOC_MAX_TREE (default 1): basket flushes, amortised over the events per basket
+#   th1, daq_sw   ALLOC_MAX_KEY (default 16): the TKey of each Write, its name/title/class TStrings
+#                 and buffer; the histogram or graph itself is reused
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+repo="$(cd "${script_dir}/.." && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+n="${1:-20000}"
+base="${2:-$(git -C "${repo}" log -S 'std::unique_ptr<TH1I> th1[8]' --format=%H -- daq_threshold_v1.0.0.cpp | tail -1)^}"
+export DGTZ_SIM_RATE="${3:-2000}"
+nsw=$(( n/20 > 10 ? n/20 : 10 ))
+maxTree="${ALLOC_MAX_TREE:-1}"
+maxKey="${ALLOC_MAX_KEY:-16}"
+failed=0
+
+mkdir -p "${work}/base"
+git -C "${repo}" archive "${base}" | tar -x -C "${work}/base"
+
+# build <src dir> <name>: daq_threshold and daq_sw (N_EVENTS patched per run) of one tree
+build(){
+  local src="$1" out="${work}/$2"
+  mkdir -p "${out}"
+  g++ -O2 -std=c++17 -I"${src}" -I"${src}/sim" "${src}/daq_threshold_v1.0.0.cpp" "${script_dir}/alloc_count.cpp" \
+      -o "${out}/daq_threshold_sim" $(root-config --cflags --libs) -pthread
+  for k in 1 2; do
+    # older daq_sw decoded into an event it never allocated, which the sim rejects
+    sed -e "s/^#define N_EVENTS .*/#define N_EVENTS $((k*nsw))/" \
+        -e 's/CAEN_DGTZ_AllocateEvent(handle, (void\*\*)&evt);/CAEN_DGTZ_AllocateEvent(handle, \&eventPtr);/' \
+        "${src}/daq_sw.cpp" >"${out}/daq_sw_${k}.cpp"
+    g++ -O2 -std=c++17 -I"${src}" -I"${src}/sim" "${out}/daq_sw_${k}.cpp" "${script_dir}/alloc_count.cpp" \
+        -o "${out}/daq_sw_${k}" $(root-config --cflags --libs) -pthread
+  done
+}
+build "${work}/base" base
+build "${repo}" work
+
+allocs(){ sed -n 's/^\[alloc\] \([0-9]*\) operator new calls/\1/p' "$1"; }
+# check <case> <allocs/ev> <bound>: only the working tree is held to the bound
+check(){
+  if awk -v a="$2" -v m="$3" 'BEGIN{exit !(a=="" || a>m)}'; then
+    echo "FAIL: ${1} allocates ${2:-?} per event, bound ${3}"
+    failed=1
+  fi
+}
+
+printf "%-10s %-5s %10s %9s %9s %9s %9s\n" "case" "tree" "allocs/ev" "p50" "p99" "p99.9" "max(us)"
+for fmt in tree packed th1; do
+  for t in base work; do
+    for k in 1 2; do
+      "${work}/${t}/daq_threshold_sim" -n $((k*n)) -m self -c 0 -t 50 -r 1024 --cfg-cache none --evt-rate 0 \
+          --root "${work}/out.root" --format "${fmt}" >"${work}/out_${k}" 2>"${work}/err_${k}"
+      rm -f "${work}/out.root"
+    done
+    per="$(awk -v a="$(allocs "${work}/err_1")" -v b="$(allocs "${work}/err_2")" -v n="${n}" 'BEGIN{if(a!="" && b!="") printf "%.2f", (b-a)/n}')"
+    p50=; p99=; p999=; pmax=
+    read -r p50 p99 p999 pmax < <(sed -n 's/^\[perf\] root_ns .* p50 *\([0-9.]*\) *p99 *\([0-9.]*\) *p99.9 *\([0-9.]*\) *max *\([0-9.]*\) us/\1 \2 \3 \4/p' "${work}/out_2") || true
+    printf "%-10s %-5s %10s %9s %9s %9s %9s\n" "${fmt}" "${t}" "${per}" "${p50:--}" "${p99:--}" "${p999:--}" "${pmax:--}"
+    if [[ "${t}" == work ]]; then check "${fmt}" "${per}" "$([[ "${fmt}" == th1 ]] && echo "${maxKey}" || echo "${maxTree}")"; fi
+  done
+done
+for t in base work; do
+  for k in 1 2; do
+    (cd "${work}" && "${work}/${t}/daq_sw_${k}" >/dev/null 2>"${work}/err_${k}")
+  done
+  per="$(awk -v a="$(allocs "${work}/err_1")" -v b="$(allocs "${work}/err_2")" -v n="${nsw}" 'BEGIN{if(a!="" && b!="") printf "%.2f", (b-a)/n}')"
+  printf "%-10s %-5s %10s %9s %9s %9s %9s\n" "daq_sw" "${t}" "${per}" - - - -
+  if [[ "${t}" == work ]]; then check daq_sw "${per}" "${maxKey}"; fi
+done
+if (( failed )); then exit 1; fi
+echo "ok: allocations per event within the bounds"
@@ -0,0 +1,86 @@
+// Event-builder merge rate (common/event_builder.h) on synthetic streams: k producer threads push
+// time-ordered hits from a common Poisson pulse train (each board sees a pulse with probability
+// 'eff', jittered by a few ns), one builder merges them, and the consumer only counts.
+//   Mhits/s : hits merged per second of builder wall time
+//   ns/event: builder wall time per global event
+// Build: g++ -O2 -std=c++17 -I.. bench_builder.cpp -o bench_builder -pthread
+// Usage: bench_builder [N_PULSES] [WINDOW_NS] [EFF]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/event_builder.h"
+
+static uint64_t now_ns(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv){
+    const uint64_t N   = argc>1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    const uint64_t win = argc>2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+    const double eff   = argc>3 ? std::atof(argv[3]) : 0.9;
+
+    // Pulse times are shared, generated once (mean spacing 10 us).
+    std::vector<uint64_t> pulses(N);
+    {
+        std::mt19937_64 rng(7);
+        std::exponential_distribution<double> gap(1.0/10000.0);
+        double t = 0;
+        for(auto& p : pulses){ t += gap(rng); p = (uint64_t)t + 1000; }
+    }
+
+    printf("%-6s %12s %12s %12s %10s\n", "boards", "hits", "events", "Mhits/s", "ns/event");
+    for(int k : {2, 4, 8}){
+        std::vector<std::unique_ptr<BoardStream>> own;
+        std::vector<BoardStream*> streams;
+        for(int b=0;b<k;++b){ own.emplace_back(new BoardStream(1u<<14)); streams.push_back(own.back().get()); }
+
+        std::vector<uint64_t> pushed(k, 0);
+        std::vector<std::thread> prod;
+        for(int b=0;b<k;++b){
+            prod.emplace_back([&, b]{
+                BoardStream& s = *streams[b];
+                std::mt19937 rng(100 + b);
+                std::uniform_real_distribution<double> u(0.0, 1.0);
+                Backoff bo;
+                for(uint64_t i=0;i<N;++i){
+                    if((i & 63)==0) s.drainedNs.store(pulses[i], std::memory_order_release);
+                    if(u(rng) >= eff) continue;
+                    BoardHit h;
+                    h.tNs = pulses[i] + rng()%8;
+                    h.readNs = pulses[i];                 // time-ordered stand-in for the readout clock
+                    h.counter = (uint32_t)pushed[b]++;
+                    while(!s.q.try_push(h)) bo.wait();
+                    bo.reset();
+                }
+                s.drainedNs.store(~0ull >> 1, std::memory_order_release);
+                s.done.store(true, std::memory_order_release);
+            });
+        }
+
+        EventBuilder eb(streams, win);
+        uint64_t events = 0, hits = 0;
+        const uint64_t t0 = now_ns();
+        Backoff bo;
+        for(;;){
+            const int r = eb.step([&](const BuiltEvent& be){ events++; hits += be.n; return true; });
+            if(r<0) break;
+            if(r==0) bo.wait(); else bo.reset();
+        }
+        const double sec = (now_ns() - t0)*1e-9;
+        for(auto& t : prod) t.join();
+        uint64_t sent = 0;
+        for(uint64_t p : pushed) sent += p;
+        if(sent != hits) fprintf(stderr,"[ERR] k=%d: %llu hits pushed, %llu merged\n", k,
+                                 (unsigned long long)sent, (unsigned long long)hits);
+        printf("%-6d %12llu %12llu %12.1f %10.1f\n", k, (unsigned long long)hits, (unsigned long long)events,
+               hits/sec/1e6, sec*1e9/events);
+    }
+    return 0;
+}
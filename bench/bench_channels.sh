@@ -0,0 +1,29 @@
+#!/usr/bin/env bash
+set -euo pipefail
+# Readout throughput vs. number of stored channels (--save-mask 0x01 .. 0xFF) against the
+# simulated digitizer. Disabled channels are not read out, so bytes/event scale with the mask.
+# External-trigger mode, so the enable mask is exactly the save mask.
+# Usage: bench_channels.sh [N_EVENTS] [RATE_HZ] [extra daq_threshold args...]
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+repo="${script_dir}/.."
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+n="${1:-10000}"; shift || true
+export DGTZ_SIM_RATE="${1:-50000}"; shift || true
+
+bin="${work}/daq_threshold_sim"
+g++ -O2 -std=c++17 -I"${repo}" -I"${repo}/sim" "${repo}/daq_threshold_v1.0.0.cpp" -o "${bin}" \
+    $(root-config --cflags --libs) -pthread
+
+printf "%-4s %-6s %12s %10s\n" "nch" "mask" "ev/s" "MB/s"
+for nch in 1 2 3 4 5 6 7 8; do
+  mask="$(printf '0x%02x' $(( (1<<nch) - 1 )))"
+  out="$("${bin}" -n "${n}" -m ext -c 0 -r 1500 --save-mask "${mask}" \
+         --format tree --root "${work}/bench.root" "$@" | grep '^\[pipe\] stages')"
+  evs="$(sed -n 's/.* \([0-9.]*\) ev\/s .*/\1/p' <<<"${out}")"
+  mbs="$(sed -n 's/.* \([0-9.]*\) MB\/s .*/\1/p' <<<"${out}")"
+  printf "%-4s %-6s %12s %10s\n" "${nch}" "${mask}" "${evs}" "${mbs}"
+  rm -f "${work}/bench.root"
+done
@@ -0,0 +1,121 @@
+// Waveform codec (common/wavecodec.h) throughput and ratio, per kernel, on the channel records of
+// a recorded run (.x7raw, see --raw) or on synthetic 14-bit pulses. Every record is round-tripped
+// and every kernel's stream is checked byte-for-byte against the scalar one.
+//   ratio     : raw uint16 bytes / encoded bytes
+//   enc/dec   : MB/s of uint16 samples in/out of the codec, one thread
+// Compare with ROOT's own compressors through bench_formats (tree/lz4, tree/zstd, tree/lzma, packed/...).
+// Build: g++ -O2 -std=c++17 -I.. bench_codec.cpp -o bench_codec
+// Usage: bench_codec [file.x7raw | N_RECORDS] [RECLEN] [--reps n]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/rawfile.h"
+#include "common/wavecodec.h"
+#include "common/x730.h"
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv){
+    std::string in;
+    uint32_t L = 1500;
+    int reps = 5;
+    std::vector<std::string> pos;
+    for(int i=1;i<argc;++i){
+        std::string a = argv[i];
+        if(a=="--reps" && i+1<argc) reps = std::max(1, std::atoi(argv[++i]));
+        else if(a=="-h" || a=="--help"){ fprintf(stderr,"Usage: %s [file.x7raw | N_RECORDS] [RECLEN] [--reps n]\n", argv[0]); return 0; }
+        else pos.push_back(a);
+    }
+    if(pos.size()>1) L = (uint32_t)std::atoi(pos[1].c_str());
+
+    // Records, concatenated (all of length L when synthetic; per channel record length when recorded).
+    std::vector<uint16_t> samples;
+    std::vector<uint32_t> lens;
+    if(!pos.empty() && pos[0].find(".x7raw")!=std::string::npos){
+        RawMap map;
+        if(!map.open(pos[0])){ fprintf(stderr,"[ERR] cannot map '%s'\n", pos[0].c_str()); return 1; }
+        map.walk([](const RawFileHeader&){}, [&](const RawBlockHeader& bh, const char* p){
+            x730_for_each(p, bh.bytes, [&](const X730Event& ev){
+                for(int c=0;c<8;++c){
+                    if(!((ev.chMask>>c)&1) || !ev.wordsPerCh) continue;
+                    const size_t off = samples.size();
+                    samples.resize(off + 2*ev.wordsPerCh);
+                    x730_unpack(x730_channel(ev, c), ev.wordsPerCh, samples.data() + off);
+                    lens.push_back(2*ev.wordsPerCh);
+                }
+            });
+        });
+        printf("[info] %s: %zu channel records, %.1f MB of samples\n", pos[0].c_str(), lens.size(), samples.size()*2/1e6);
+    } else {
+        const int N = pos.empty() ? 20000 : std::atoi(pos[0].c_str());
+        std::mt19937 rng(1);
+        std::normal_distribution<double> noise(0.0, 3.0);
+        samples.resize((size_t)N*L);
+        for(int r=0;r<N;++r){
+            const double amp = 200.0 + rng()%3000;
+            for(uint32_t s=0;s<L;++s){
+                double v = 13107 + noise(rng);
+                if(s >= L/5){ double dt = s - L/5.0; v -= amp*(std::exp(-dt/20.0)-std::exp(-dt/2.0)); }
+                samples[(size_t)r*L+s] = (uint16_t)std::max(0.0, std::min(16383.0, v));
+            }
+            lens.push_back(L);
+        }
+        printf("[info] synthetic: %d records of %u samples (noise 3 ADC), %.1f MB\n", N, L, samples.size()*2/1e6);
+    }
+    if(lens.empty()) return 1;
+
+    std::vector<WcKernels> kernels = {wc_scalar_kernels()};
+    if(std::strcmp(wc_best_kernels().name, "scalar")) kernels.push_back(wc_best_kernels());
+
+    const double rawMB = samples.size()*2/1e6;
+    size_t maxRec = 0;
+    for(uint32_t n : lens) maxRec = std::max<size_t>(maxRec, wc_max_bytes(n));
+    std::vector<uint8_t> ref, enc;
+    std::vector<size_t> offs(lens.size()+1);
+    std::vector<uint16_t> dec(samples.size());
+
+    printf("%-8s %8s %10s %10s %12s\n", "kernel", "ratio", "enc MB/s", "dec MB/s", "bits/sample");
+    int bad = 0;
+    for(const auto& k : kernels){
+        enc.assign(maxRec * lens.size(), 0);
+        double te = 1e30, td = 1e30;
+        for(int r=0;r<reps;++r){
+            double t0 = now_s();
+            size_t o = 0, s = 0;
+            for(size_t i=0;i<lens.size();++i){
+                offs[i] = o;
+                o += wc_encode_with(k, samples.data()+s, lens[i], enc.data()+o);
+                s += lens[i];
+            }
+            offs[lens.size()] = o;
+            te = std::min(te, now_s()-t0);
+
+            t0 = now_s();
+            s = 0;
+            for(size_t i=0;i<lens.size();++i){
+                if(!wc_decode_with(k, enc.data()+offs[i], offs[i+1]-offs[i], dec.data()+s, lens[i])) bad++;
+                s += lens[i];
+            }
+            td = std::min(td, now_s()-t0);
+        }
+        const size_t bytes = offs[lens.size()];
+        if(dec != samples){ bad++; fprintf(stderr,"[ERR] %s: round trip differs\n", k.name); }
+        if(ref.empty()) ref.assign(enc.begin(), enc.begin()+bytes);
+        else if(bytes != ref.size() || std::memcmp(ref.data(), enc.data(), bytes)){
+            bad++; fprintf(stderr,"[ERR] %s: stream differs from scalar\n", k.name);
+        }
+        printf("%-8s %8.2f %10.1f %10.1f %12.2f\n", k.name, samples.size()*2.0/bytes, rawMB/te, rawMB/td,
+               8.0*bytes/samples.size());
+    }
+    return bad ? 1 : 0;
+}
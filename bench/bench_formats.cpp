@@ -0,0 +1,160 @@
+// Write/read throughput of the waveform formats on synthetic 14-bit pulses or on the ch records
+// of a recorded run (.x7raw):
+//   th1    : one TH1I key per event under a tag directory (legacy)
+//   tree   : one 'waves' TTree per tag (common/waves_tree.h), several compression settings
+//   packed : the same tree with codec-packed samples (common/wavecodec.h), read back decoded
+// Build: g++ -O2 -std=c++17 -I.. bench_formats.cpp -o bench_formats $(root-config --cflags --libs)
+// Usage: bench_formats [N_EVENTS] [RECLEN] [workdir] [file.x7raw]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TDirectory.h>
+#include <TH1I.h>
+#include <TTree.h>
+
+#include "common/rawfile.h"
+#include "common/waves_tree.h"
+#include "common/x730.h"
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static long long file_size(const std::string& p){
+    FILE* f = std::fopen(p.c_str(), "rb");
+    if(!f) return 0;
+    std::fseek(f, 0, SEEK_END);
+    long long n = std::ftell(f);
+    std::fclose(f);
+    return n;
+}
+
+int main(int argc, char** argv){
+    const int N        = argc>1 ? std::atoi(argv[1]) : 10000;
+    const uint32_t L   = argc>2 ? (uint32_t)std::atoi(argv[2]) : 1500;
+    const std::string dir = argc>3 ? argv[3] : ".";
+    const std::string raw = argc>4 ? argv[4] : "";
+
+    // A pool of waveforms, reused round-robin so generation is not timed: synthetic, or
+    // the first records of length L in a recorded run.
+    std::vector<std::vector<uint16_t>> waves;
+    if(!raw.empty()){
+        RawMap map;
+        if(!map.open(raw)){ fprintf(stderr,"[ERR] cannot map '%s'\n", raw.c_str()); return 1; }
+        map.walk([](const RawFileHeader&){}, [&](const RawBlockHeader& bh, const char* p){
+            x730_for_each(p, bh.bytes, [&](const X730Event& ev){
+                for(int c=0;c<8 && waves.size()<4096;++c){
+                    if(!((ev.chMask>>c)&1) || 2*ev.wordsPerCh!=L) continue;
+                    waves.emplace_back(L);
+                    x730_unpack(x730_channel(ev, c), ev.wordsPerCh, waves.back().data());
+                }
+            });
+        });
+        if(waves.empty()){ fprintf(stderr,"[ERR] no records of %u samples in '%s'\n", L, raw.c_str()); return 1; }
+        printf("[info] %zu recorded waveforms from %s\n", waves.size(), raw.c_str());
+    } else {
+        waves.assign(64, std::vector<uint16_t>(L));
+        std::mt19937 rng(1);
+        std::normal_distribution<double> noise(0.0, 3.0);
+        for(auto& w : waves){
+            const double amp = 200.0 + rng()%3000;
+            for(uint32_t s=0;s<L;++s){
+                double v = 13107 + noise(rng);
+                if(s >= L/5){ double dt = s - L/5.0; v -= amp*(std::exp(-dt/20.0)-std::exp(-dt/2.0)); }
+                w[s] = (uint16_t)std::max(0.0, std::min(16383.0, v));
+            }
+        }
+    }
+    const int pool = (int)waves.size();
+    const double rawMB = double(N)*L*2/1e6;
+    printf("%-14s %10s %10s %10s %8s\n", "format", "write MB/s", "read MB/s", "file MB", "ratio");
+
+    // --- th1 ---
+    {
+        const std::string path = dir + "/bench_th1.root";
+        double t0 = now_s();
+        TFile* f = TFile::Open(path.c_str(), "RECREATE");
+        TDirectory* d = f->mkdir("self");
+        d->cd();
+        char hname[64];
+        for(int ev=0; ev<N; ++ev){
+            const auto& w = waves[ev%pool];
+            snprintf(hname, sizeof(hname), "wave_ev%06d_ch%d", ev, 0);
+            TH1I h(hname, hname, L, 0.0, double(L));
+            for(uint32_t s=0;s<L;++s) h.SetBinContent(int(s)+1, w[s]);
+            h.Write();
+        }
+        f->Write(); f->Close(); delete f;
+        const double tw = now_s()-t0;
+
+        t0 = now_s();
+        f = TFile::Open(path.c_str(), "READ");
+        uint64_t sum = 0;
+        for(int ev=0; ev<N; ++ev){
+            snprintf(hname, sizeof(hname), "self/wave_ev%06d_ch%d", ev, 0);
+            auto* h = (TH1I*)f->Get(hname);
+            if(!h) continue;
+            for(uint32_t s=0;s<L;++s) sum += (uint64_t)h->GetBinContent(int(s)+1);
+            delete h;
+        }
+        f->Close(); delete f;
+        const double tr = now_s()-t0;
+        const double mb = file_size(path)/1e6;
+        printf("%-14s %10.1f %10.1f %10.1f %8.2f   (checksum %llu)\n", "th1", rawMB/tw, rawMB/tr, mb, mb>0?rawMB/mb:0.0,
+               (unsigned long long)sum);
+    }
+
+    // --- tree and packed tree, per compression setting ---
+    struct Setting { bool packed; const char* spec; };
+    for(const Setting& st : {Setting{false,"none"}, Setting{false,"zlib:1"}, Setting{false,"lz4:4"}, Setting{false,"zstd:5"},
+                             Setting{false,"lzma:6"}, Setting{true,"none"}, Setting{true,"lz4:4"}, Setting{true,"zstd:5"}}){
+        const char* spec = st.spec;
+        const std::string path = dir + "/bench_tree.root";
+        const int comp = parse_root_compression(spec);
+        double t0 = now_s();
+        TFile* f = TFile::Open(path.c_str(), "RECREATE");
+        f->SetCompressionSettings(comp);
+        TDirectory* d = f->mkdir("self");
+        WavesTree wt;
+        wt.attach(d, L, 0x1, 0, comp, st.packed);
+        for(int ev=0; ev<N; ++ev){
+            wt.EventCounter = (uint32_t)ev;
+            wt.TriggerTimeTag = (uint32_t)ev*1000u;
+            wt.ChannelMask = 0x1;
+            wt.set(0, waves[ev%pool].data(), L);
+            wt.fill();
+        }
+        wt.write();
+        f->Close(); delete f;
+        const double tw = now_s()-t0;
+
+        t0 = now_s();
+        f = TFile::Open(path.c_str(), "READ");
+        auto* t = (TTree*)f->Get("self/waves");
+        uint64_t sum = 0;
+        WavesTree rt;
+        if(t && rt.open(t, L, 0x1)){
+            const long long n = t->GetEntries();
+            for(long long i=0;i<n;++i){
+                if(!rt.get(i)) break;
+                for(uint32_t s=0;s<L;++s) sum += rt.wave[0][s];
+            }
+        }
+        f->Close(); delete f;
+        const double tr = now_s()-t0;
+        const double mb = file_size(path)/1e6;
+        char label[32]; snprintf(label, sizeof(label), "%s/%s", st.packed ? "packed" : "tree", spec);
+        printf("%-14s %10.1f %10.1f %10.1f %8.2f   (checksum %llu)\n", label, rawMB/tw, rawMB/tr, mb, mb>0?rawMB/mb:0.0,
+               (unsigned long long)sum);
+        std::remove(path.c_str());
+    }
+    std::remove((dir + "/bench_th1.root").c_str());
+    return 0;
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+set -euo pipefail
+# End-to-end throughput per output mode against the simulated digitizer (sim/CAENDigitizer.h):
+# events/s, MB/s over the link, dead time (triggers lost with the board memory full, as counted
+# by the sim) and CPU per event of each pipeline stage. Run the trigger rate above what the
+# host sustains to measure the ceiling, or at the expected rate to measure dead time.
+# Usage: bench_outputs.sh [N_EVENTS] [RATE_HZ] [LINK_MBPS] [extra daq_threshold args...]
+#   LINK_MBPS: 0 = unlimited, ~30 = USB 2.0, ~80 = CONET optical
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+repo="${script_dir}/.."
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+n="${1:-20000}"; shift || true
+export DGTZ_SIM_RATE="${1:-50000}"; shift || true
+export DGTZ_SIM_LINK_MBPS="${1:-0}"; shift || true
+export DGTZ_SIM_REPORT=1
+
+bin="${work}/daq_threshold_sim"
+g++ -O2 -std=c++17 -I"${repo}" -I"${repo}/sim" "${repo}/daq_threshold_v1.0.0.cpp" -o "${bin}" \
+    $(root-config --cflags --libs) -pthread
+
+declare -A modes=(
+  [none]="--stages rd"
+  [txt]="--txt ${work}/out.txt"
+  [txtdir]="--txtdir ${work}/txtdir"
+  [txtchunk]="--txtdir ${work}/txtdir --txt-chunk 1000"
+  [root-th1]="--root ${work}/out.root --format th1"
+  [root-tree]="--root ${work}/out.root --format tree"
+  [raw]="--raw ${work}/out.x7raw"
+)
+
+printf "%-10s %10s %9s %8s %10s %10s %10s %11s\n" \
+       "output" "ev/s" "MB/s" "dead%" "ro us/ev" "dec us/ev" "wr us/ev" "finalize ms"
+for mode in none txt txtdir txtchunk root-th1 root-tree raw; do
+  # shellcheck disable=SC2086
+  out="$("${bin}" -n "${n}" -m self -c 0 -t 50 -r 1500 --post 80 --cfg-cache none ${modes[$mode]} "$@" \
+         2>"${work}/stderr" | grep -E '^\[(pipe|time)\]')"
+  evs="$(sed -n 's/^\[pipe\] stages.* \([0-9.]*\) ev\/s .*/\1/p' <<<"${out}")"
+  mbs="$(sed -n 's/^\[pipe\] stages.* \([0-9.]*\) MB\/s .*/\1/p' <<<"${out}")"
+  dead="$(sed -n 's/^\[sim\].*dead time \([0-9.]*\)%.*/\1/p' "${work}/stderr")"
+  read -r ro dec wr < <(sed -n 's/^\[pipe\] cpu per event: readout \([0-9.]*\) us, decode \([0-9.]*\) us, write \([0-9.]*\) us/\1 \2 \3/p' <<<"${out}")
+  fin="$(sed -n 's/^\[time\] finalize \([0-9.]*\) ms/\1/p' <<<"${out}")"
+  printf "%-10s %10s %9s %8s %10s %10s %10s %11s\n" \
+         "${mode}" "${evs}" "${mbs}" "${dead:-0}" "${ro}" "${dec}" "${wr}" "${fin:--}"
+  rm -rf "${work}"/out.* "${work}/txtdir"
+done
@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+set -euo pipefail
+# Sustained events/s of the readout/decode/write pipeline against the simulated digitizer
+# (sim/CAENDigitizer.h), with each stage enabled and disabled.
+# Usage: bench_pipeline.sh [N_EVENTS] [RATE_HZ]
+
+script_dir="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+repo="${script_dir}/.."
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+
+n="${1:-10000}"
+export DGTZ_SIM_RATE="${2:-50000}"
+
+bin="${work}/daq_threshold_sim"
+g++ -O2 -std=c++17 -I"${repo}" -I"${repo}/sim" "${repo}/daq_threshold_v1.0.0.cpp" -o "${bin}" \
+    $(root-config --cflags --libs) -pthread
+
+printf "%-8s %-6s %12s %10s  %s\n" "stages" "nbuf" "ev/s" "MB/s" "backpressure"
+for stages in r rd rdw; do
+  for nbuf in 1 4; do
+    out="$("${bin}" -n "${n}" -m self -r 1500 --post 80 --nbuf "${nbuf}" --stages "${stages}" \
+           --root "${work}/bench.root" | grep '^\[pipe\]')"
+    evs="$(sed -n 's/.* \([0-9.]*\) ev\/s .*/\1/p' <<<"${out}")"
+    mbs="$(sed -n 's/.* \([0-9.]*\) MB\/s .*/\1/p' <<<"${out}")"
+    bp="$(sed -n 's/^\[pipe\] backpressure: //p' <<<"${out}")"
+    printf "%-8s %-6s %12s %10s  %s\n" "${stages}" "${nbuf}" "${evs}" "${mbs}" "${bp}"
+    rm -f "${work}/bench.root"
+  done
+done
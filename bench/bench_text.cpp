@@ -0,0 +1,123 @@
+// Text export throughput on synthetic 14-bit pulses: the old ofstream code (per-sample operator<<,
+// one ofstream per event with --txtdir) against common/text_writer.h (to_chars on a background
+// thread, big write() calls, optional N events per file).
+//   caller MB/s : text bytes / time the write stage spends handing events over
+//   total MB/s  : text bytes / time until everything is on disk (page cache), drain included
+// Build: g++ -O2 -std=c++17 -I.. bench_text.cpp -o bench_text -pthread
+// Usage: bench_text [N_EVENTS] [RECLEN] [workdir]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "common/text_writer.h"
+
+static double now_s(){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Result { double callerSec, totalSec; };
+
+int main(int argc, char** argv){
+    const int N        = argc>1 ? std::atoi(argv[1]) : 10000;
+    const uint32_t L   = argc>2 ? (uint32_t)std::atoi(argv[2]) : 1500;
+    const std::string dir = argc>3 ? argv[3] : ".";
+
+    // A pool of synthetic waveforms, reused round-robin so generation is not timed.
+    const int pool = 64;
+    std::vector<std::vector<uint16_t>> waves(pool, std::vector<uint16_t>(L));
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 3.0);
+    for(auto& w : waves){
+        const double amp = 200.0 + rng()%3000;
+        for(uint32_t s=0;s<L;++s){
+            double v = 13107 + noise(rng);
+            if(s >= L/5){ double dt = s - L/5.0; v -= amp*(std::exp(-dt/20.0)-std::exp(-dt/2.0)); }
+            w[s] = (uint16_t)std::max(0.0, std::min(16383.0, v));
+        }
+    }
+    const std::string tag = "self", trig = "self";
+
+    // Old daq_threshold code, verbatim apart from the event source.
+    auto legacy = [&](const std::string& txt, const std::string& txtdir){
+        std::ofstream txt_out;
+        if(!txt.empty()) txt_out.open(txt, std::ios::app);
+        const double t0 = now_s();
+        for(int i=0;i<N;++i){
+            const std::vector<uint16_t>& w = waves[i%pool];
+            std::ofstream fout;
+            std::ostream* os = nullptr;
+            if(!txtdir.empty()){
+                char tmp[512];
+                snprintf(tmp, sizeof(tmp), "%s/waveform_%d.txt", txtdir.c_str(), i);
+                fout.open(tmp, std::ios::app);
+                if(fout.is_open()) os = &fout;
+            } else if(txt_out.is_open()){
+                os = &txt_out;
+            }
+            if(!os) continue;
+            *os << "# Event " << i << "  tag=" << tag << "  trig=" << trig
+                << "  ch=" << 0 << "  size=" << L
+                << "  cnt=" << (uint32_t)i << "  ttag=" << (uint32_t)(i*1000) << "\n";
+            for(uint32_t s=0; s<L; ++s) *os << w[s] << "\n";
+            *os << "\n";
+        }
+        txt_out.close();
+        const double t = now_s()-t0;
+        return Result{t, t};
+    };
+    auto async = [&](const std::string& txt, const std::string& txtdir, uint32_t perFile, uint64_t& bytes){
+        TextWriter tw;
+        tw.open(txt, txtdir, perFile, tag, trig);
+        const double t0 = now_s();
+        const uint16_t* wave[8] = {};
+        uint32_t ns[8] = {L};
+        for(int i=0;i<N;++i){
+            wave[0] = waves[i%pool].data();
+            tw.add(i, (uint32_t)i, (uint32_t)(i*1000), wave, ns);
+        }
+        const double t1 = now_s();
+        tw.close();
+        bytes = tw.bytes_written();
+        return Result{t1-t0, now_s()-t0};
+    };
+
+    // Every mode writes the same text, so the async byte count sizes all of them.
+    uint64_t bytes = 0;
+    printf("%-22s %12s %12s %10s\n", "mode", "caller MB/s", "total MB/s", "text MB");
+    auto row = [&](const char* name, Result r){
+        printf("%-22s %12.1f %12.1f %10.1f\n", name, bytes/r.callerSec/1e6, bytes/r.totalSec/1e6, bytes/1e6);
+    };
+    auto fresh = [&](const std::string& d){
+        if(system(("rm -rf '" + d + "'").c_str())!=0) {}
+        mkdir(d.c_str(), 0755);
+        return d;
+    };
+
+    const std::string f1 = dir + "/bench_txt_async.txt", f0 = dir + "/bench_txt_legacy.txt";
+    std::remove(f1.c_str()); std::remove(f0.c_str());
+    Result ra = async(f1, "", 1, bytes);
+    Result rl = legacy(f0, "");
+    row("txt legacy", rl);
+    row("txt async", ra);
+
+    rl = legacy("", fresh(dir + "/bench_txtdir_legacy"));
+    uint64_t b2 = 0;
+    ra = async("", fresh(dir + "/bench_txtdir_async"), 1, b2);
+    row("txtdir legacy", rl);
+    row("txtdir async", ra);
+    for(uint32_t chunk : {100u, 1000u}){
+        char name[64];
+        snprintf(name, sizeof(name), "txtdir async chunk=%u", chunk);
+        ra = async("", fresh(dir + "/bench_txtdir_chunk"), chunk, b2);
+        row(name, ra);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// Shadow of the digitizer registers daq_threshold programs, so a run only writes what changed.
+// The last applied configuration is cached per board serial (board_<serial>.cfg) together with
+// a readback signature; the cache is trusted only if the board still reads back that signature
+// (a power cycle, or another program such as daq_multi changing any shadowed register, forces a
+// Reset + full programming).
+
+#pragma once
+#include <CAENDigitizer.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <unistd.h>
+
+struct BoardConfig {
+    uint32_t acqMode = 0, enMask = 0, recLen = 0, post = 0, maxBLT = 0;
+    uint32_t dcOffset[8] = {}, thr[8] = {};
+    uint32_t pulsePol[8] = {}, trigPol[8] = {};
+    uint32_t selfMask = 0;             // channels with self-trigger ACQ_ONLY, the others disabled
+    uint32_t swMode = 0, extMode = 0;  // CAEN_DGTZ_TriggerMode_t
+    uint32_t countAllTrig = 0;         // Acquisition Control bit 3: EventCounter counts every trigger
+};
+static_assert(std::has_unique_object_representations<BoardConfig>::value, "hashed as raw bytes");
+
+// Readback of every register the shadow covers (~50 reads), identifying "the board still holds
+// what we wrote". Values are as the board reports them, so compare signatures, not configs.
+struct BoardSignature {
+    uint32_t enMask = 0, recLen = 0, post = 0, maxBLT = 0;
+    uint32_t acqCtrl = 0;              // Acquisition Control (0x8100): acquisition mode, count-all-triggers
+    uint32_t dcOffset[8] = {}, thr[8] = {};
+    uint32_t pulsePol[8] = {}, trigPol[8] = {};
+    uint32_t selfMask = 0;             // channels reading back self-trigger ACQ_ONLY
+    uint32_t swMode = 0, extMode = 0;
+    bool operator==(const BoardSignature& o) const { return std::memcmp(this, &o, sizeof(*this))==0; }
+};
+static_assert(std::has_unique_object_representations<BoardSignature>::value, "compared as raw bytes");
+
+inline uint64_t fnv1a64(const void* p, size_t n, uint64_t h = 1469598103934665603ull){
+    const unsigned char* b = (const unsigned char*)p;
+    for(size_t i=0;i<n;++i){ h ^= b[i]; h *= 1099511628211ull; }
+    return h;
+}
+inline uint64_t config_hash(const BoardConfig& c){ return fnv1a64(&c, sizeof(c)); }
+
+inline CAEN_DGTZ_ErrorCode read_signature(int handle, BoardSignature& s){
+    CAEN_DGTZ_ErrorCode ec;
+    if((ec = CAEN_DGTZ_GetChannelEnableMask(handle, &s.enMask)) != CAEN_DGTZ_Success) return ec;
+    if((ec = CAEN_DGTZ_GetRecordLength(handle, &s.recLen)) != CAEN_DGTZ_Success) return ec;
+    if((ec = CAEN_DGTZ_GetPostTriggerSize(handle, &s.post)) != CAEN_DGTZ_Success) return ec;
+    if((ec = CAEN_DGTZ_GetMaxNumEventsBLT(handle, &s.maxBLT)) != CAEN_DGTZ_Success) return ec;
+    if((ec = CAEN_DGTZ_ReadRegister(handle, 0x8100, &s.acqCtrl)) != CAEN_DGTZ_Success) return ec;
+    s.selfMask = 0;
+    for(uint32_t c=0;c<8;++c){
+        CAEN_DGTZ_PulsePolarity_t pp; CAEN_DGTZ_TriggerPolarity_t tp; CAEN_DGTZ_TriggerMode_t tm;
+        if((ec = CAEN_DGTZ_GetChannelDCOffset(handle, c, &s.dcOffset[c])) != CAEN_DGTZ_Success) return ec;
+        if((ec = CAEN_DGTZ_GetChannelTriggerThreshold(handle, c, &s.thr[c])) != CAEN_DGTZ_Success) return ec;
+        if((ec = CAEN_DGTZ_GetChannelPulsePolarity(handle, c, &pp)) != CAEN_DGTZ_Success) return ec;
+        if((ec = CAEN_DGTZ_GetTriggerPolarity(handle, c, &tp)) != CAEN_DGTZ_Success) return ec;
+        if((ec = CAEN_DGTZ_GetChannelSelfTrigger(handle, c, &tm)) != CAEN_DGTZ_Success) return ec;
+        s.pulsePol[c] = pp; s.trigPol[c] = tp;
+        if(tm==CAEN_DGTZ_TRGMODE_ACQ_ONLY) s.selfMask |= 1u << c;
+    }
+    CAEN_DGTZ_TriggerMode_t sw, ext;
+    if((ec = CAEN_DGTZ_GetSWTriggerMode(handle, &sw)) != CAEN_DGTZ_Success) return ec;
+    if((ec = CAEN_DGTZ_GetExtTriggerInputMode(handle, &ext)) != CAEN_DGTZ_Success) return ec;
+    s.swMode = sw; s.extMode = ext;
+    return CAEN_DGTZ_Success;
+}
+
+// --- cache file: header + BoardConfig + BoardSignature ---
+constexpr uint32_t kCfgCacheMagic = 0x47464358; // "XCFG"
+constexpr uint32_t kCfgCacheVersion = 3;
+struct CfgCacheHeader { uint32_t magic = kCfgCacheMagic, version = kCfgCacheVersion, serial = 0, reserved = 0; uint64_t hash = 0; };
+
+inline std::string config_cache_path(const std::string& dir, uint32_t serial){
+    return dir + "/board_" + std::to_string(serial) + ".cfg";
+}
+
+inline bool load_config_cache(const std::string& path, uint32_t serial, BoardConfig& c, BoardSignature& s){
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+    CfgCacheHeader h;
+    const bool okRead = fread(&h, sizeof(h), 1, f)==1 && fread(&c, sizeof(c), 1, f)==1 && fread(&s, sizeof(s), 1, f)==1;
+    fclose(f);
+    return okRead && h.magic==kCfgCacheMagic && h.version==kCfgCacheVersion && h.serial==serial && h.hash==config_hash(c);
+}
+
+// Written to a temp file and renamed, so a crash never leaves a half-written cache.
+inline bool save_config_cache(const std::string& path, uint32_t serial, const BoardConfig& c, const BoardSignature& s){
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f) return false;
+    CfgCacheHeader h; h.serial = serial; h.hash = config_hash(c);
+    bool okWrite = fwrite(&h, sizeof(h), 1, f)==1 && fwrite(&c, sizeof(c), 1, f)==1 && fwrite(&s, sizeof(s), 1, f)==1;
+    okWrite = (fclose(f)==0) && okWrite;
+    if(!okWrite || rename(tmp.c_str(), path.c_str())!=0){ unlink(tmp.c_str()); return false; }
+    return true;
+}
+
+// Register writes that go through the shadow: skipped when the board already holds the value.
+// After a failed write the shadow is no longer trusted and every later call writes.
+class BoardWriter {
+public:
+    BoardWriter(int handle, BoardConfig& shadow, bool known) : h_(handle), s_(shadow), known_(known) {}
+
+    CAEN_DGTZ_ErrorCode acq_mode(CAEN_DGTZ_AcqMode_t m){
+        return put_(s_.acqMode, m, [&]{ return CAEN_DGTZ_SetAcquisitionMode(h_, m); });
+    }
+    CAEN_DGTZ_ErrorCode enable_mask(uint32_t v){
+        return put_(s_.enMask, v, [&]{ return CAEN_DGTZ_SetChannelEnableMask(h_, v); });
+    }
+    CAEN_DGTZ_ErrorCode record_length(uint32_t v){
+        return put_(s_.recLen, v, [&]{ return CAEN_DGTZ_SetRecordLength(h_, v); });
+    }
+    CAEN_DGTZ_ErrorCode post_trigger(uint32_t v){
+        return put_(s_.post, v, [&]{ return CAEN_DGTZ_SetPostTriggerSize(h_, v); });
+    }
+    CAEN_DGTZ_ErrorCode max_blt(uint32_t v){
+        return put_(s_.maxBLT, v, [&]{ return CAEN_DGTZ_SetMaxNumEventsBLT(h_, v); });
+    }
+    CAEN_DGTZ_ErrorCode pulse_polarity(uint32_t ch, CAEN_DGTZ_PulsePolarity_t p){
+        return put_(s_.pulsePol[ch], p, [&]{ return CAEN_DGTZ_SetChannelPulsePolarity(h_, ch, p); });
+    }
+    CAEN_DGTZ_ErrorCode trigger_polarity(uint32_t ch, CAEN_DGTZ_TriggerPolarity_t p){
+        return put_(s_.trigPol[ch], p, [&]{ return CAEN_DGTZ_SetTriggerPolarity(h_, ch, p); });
+    }
+    CAEN_DGTZ_ErrorCode dc_offset(uint32_t ch, uint32_t v){
+        return put_(s_.dcOffset[ch], v, [&]{ return CAEN_DGTZ_SetChannelDCOffset(h_, ch, v); });
+    }
+    CAEN_DGTZ_ErrorCode threshold(uint32_t ch, uint32_t v){
+        return put_(s_.thr[ch], v, [&]{ return CAEN_DGTZ_SetChannelTriggerThreshold(h_, ch, v); });
+    }
+    CAEN_DGTZ_ErrorCode sw_trigger(CAEN_DGTZ_TriggerMode_t m){
+        return put_(s_.swMode, m, [&]{ return CAEN_DGTZ_SetSWTriggerMode(h_, m); });
+    }
+    CAEN_DGTZ_ErrorCode ext_trigger(CAEN_DGTZ_TriggerMode_t m){
+        return put_(s_.extMode, m, [&]{ return CAEN_DGTZ_SetExtTriggerInputMode(h_, m); });
+    }
+    // Read-modify-write of Acquisition Control (0x8100) bit 3, keeping the other bits.
+    CAEN_DGTZ_ErrorCode count_all_triggers(bool on){
+        return put_(s_.countAllTrig, on ? 1u : 0u, [&]{
+            uint32_t v = 0;
+            CAEN_DGTZ_ErrorCode ec = CAEN_DGTZ_ReadRegister(h_, 0x8100, &v);
+            if(ec!=CAEN_DGTZ_Success) return ec;
+            return CAEN_DGTZ_WriteRegister(h_, 0x8100, on ? (v | (1u<<3)) : (v & ~(1u<<3)));
+        });
+    }
+    // Self-trigger ACQ_ONLY on exactly the channels in acqMask.
+    CAEN_DGTZ_ErrorCode self_trigger(uint32_t acqMask){
+        acqMask &= 0xFF;
+        if(known_ && s_.selfMask==acqMask){ skipped_++; return CAEN_DGTZ_Success; }
+        const uint32_t off = known_ ? (s_.selfMask & ~acqMask) : (0xFFu & ~acqMask);
+        const uint32_t on  = known_ ? (acqMask & ~s_.selfMask) : acqMask;
+        CAEN_DGTZ_ErrorCode ec = CAEN_DGTZ_Success;
+        if(off){ writes_++; ec = CAEN_DGTZ_SetChannelSelfTrigger(h_, CAEN_DGTZ_TRGMODE_DISABLED, off); }
+        if(ec==CAEN_DGTZ_Success && on){ writes_++; ec = CAEN_DGTZ_SetChannelSelfTrigger(h_, CAEN_DGTZ_TRGMODE_ACQ_ONLY, on); }
+        if(ec==CAEN_DGTZ_Success) s_.selfMask = acqMask; else known_ = false;
+        return ec;
+    }
+
+    bool known() const { return known_; }
+    unsigned writes() const { return writes_; }
+    unsigned skipped() const { return skipped_; }
+
+private:
+    template <class V, class F>
+    CAEN_DGTZ_ErrorCode put_(uint32_t& slot, V v, F write){
+        if(known_ && slot==(uint32_t)v){ skipped_++; return CAEN_DGTZ_Success; }
+        writes_++;
+        CAEN_DGTZ_ErrorCode ec = write();
+        if(ec==CAEN_DGTZ_Success) slot = (uint32_t)v; else known_ = false;
+        return ec;
+    }
+
+    int h_;
+    BoardConfig& s_;
+    bool known_;
+    unsigned writes_ = 0, skipped_ = 0;
+};
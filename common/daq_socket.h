@@ -0,0 +1,92 @@
+// UNIX-socket plumbing for the acquisition daemon (daq_threshold --daemon) and its clients.
+// One request line per connection; the daemon answers with one line and closes:
+//   PING              -> OK pong serial=<n> busy=<0|1>
+//   TEMP              -> OK temp <t0> ... <t7>          (-1 where the board has no sensor)
+//   RUN <cli options> -> OK events=<n> setup_ms=<ms> acq_s=<s>  |  ERR <why>
+//   QUIT              -> OK bye                           (refused while a run is active)
+
+#pragma once
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+constexpr const char* kDefaultDaqSocket = "/home/ANNIE/daq/.daq.sock";
+
+inline bool unix_addr(const std::string& path, sockaddr_un& sa){
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(sa.sun_path)){
+        fprintf(stderr,"[ERR] socket path too long: %s\n", path.c_str());
+        return false;
+    }
+    std::memcpy(sa.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// Bind + listen; a stale socket file from a dead daemon is replaced, a live one is not.
+inline int unix_listen(const std::string& path){
+    sockaddr_un sa;
+    if(!unix_addr(path, sa)) return -1;
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(probe>=0 && connect(probe, (sockaddr*)&sa, sizeof(sa))==0){
+        close(probe);
+        fprintf(stderr,"[ERR] a daemon is already listening on %s\n", path.c_str());
+        return -1;
+    }
+    if(probe>=0) close(probe);
+    unlink(path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd<0 || bind(fd, (sockaddr*)&sa, sizeof(sa))!=0 || listen(fd, 8)!=0){
+        fprintf(stderr,"[ERR] cannot listen on %s: %s\n", path.c_str(), strerror(errno));
+        if(fd>=0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline int unix_connect(const std::string& path){
+    sockaddr_un sa;
+    if(!unix_addr(path, sa)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd<0) return -1;
+    if(connect(fd, (sockaddr*)&sa, sizeof(sa))!=0){ close(fd); return -1; }
+    return fd;
+}
+
+inline bool sock_write_all(int fd, const std::string& s){
+    size_t off = 0;
+    while(off < s.size()){
+        ssize_t w = send(fd, s.data()+off, s.size()-off, MSG_NOSIGNAL);
+        if(w<0){ if(errno==EINTR) continue; return false; }
+        off += (size_t)w;
+    }
+    return true;
+}
+
+// Reads up to '\n' (not included); false on EOF/error before any byte or past maxLen.
+inline bool sock_read_line(int fd, std::string& line, size_t maxLen = 4096){
+    line.clear();
+    char c;
+    for(;;){
+        ssize_t r = recv(fd, &c, 1, 0);
+        if(r<0 && errno==EINTR) continue;
+        if(r<=0) return !line.empty();
+        if(c=='\n') return true;
+        if(c!='\r') line.push_back(c);
+        if(line.size() > maxLen) return false;
+    }
+}
+
+// One request/response round trip; false if the daemon is not reachable.
+inline bool daq_request(const std::string& path, const std::string& request, std::string& reply){
+    int fd = unix_connect(path);
+    if(fd<0) return false;
+    const bool okIo = sock_write_all(fd, request + "\n") && sock_read_line(fd, reply);
+    close(fd);
+    return okIo;
+}
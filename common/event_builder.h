@@ -0,0 +1,102 @@
+// Multi-board event building: k-way merge of per-board, time-ordered hit streams into global
+// events. Every board thread pushes its hits (64-bit corrected time, see X730TimeUnwrap) into its
+// own BoardStream; one builder thread merges the stream heads and groups hits whose times lie
+// within 'window' ns of the earliest one (at most one hit per board per global event).
+//
+// A stream with no queued hit holds the merge back until it has proven it has nothing earlier:
+// its thread publishes drainedNs, the steady-clock start of its last completed ReadData whose
+// hits are all queued. A trigger that happened before the candidate hit was read out (plus the
+// window) is in that board's memory by then, so once drainedNs passes readNs + window of the
+// candidate the stream cannot produce an earlier hit.
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "common/spsc_ring.h"
+
+constexpr int kMaxBuildBoards = 8;
+
+struct BoardHit {
+    uint64_t tNs = 0;        // corrected time: unwrapped TTT * 8 ns - board offset
+    uint64_t readNs = 0;     // steady clock when the ReadData holding it returned
+    uint64_t ticks = 0;      // unwrapped trigger time tag
+    uint32_t counter = 0;    // EventCounter
+    uint32_t slot = 0;       // the board's event pool slot holding the samples
+};
+
+struct BoardStream {
+    explicit BoardStream(size_t capacity) : q(capacity) {}
+    SpscRing<BoardHit> q;
+    std::atomic<uint64_t> drainedNs{0};
+    std::atomic<bool> done{false};     // set after the last hit is queued
+};
+
+struct BuiltEvent {
+    uint64_t tNs = 0;                  // time of the earliest hit
+    int      n = 0;
+    uint8_t  board[kMaxBuildBoards] = {};
+    BoardHit hit[kMaxBuildBoards];
+};
+
+class EventBuilder {
+public:
+    EventBuilder(std::vector<BoardStream*> streams, uint64_t windowNs)
+        : s_(std::move(streams)), window_(windowNs), have_(s_.size(), false), head_(s_.size()) {}
+
+    // Builds what can be built now; emit(const BuiltEvent&) returns false to pause (no room
+    // downstream). Returns the number of events built, or -1 once every stream is done and empty.
+    template <class Emit>
+    int step(Emit&& emit, int maxEvents = 1024){
+        const int k = (int)s_.size();
+        int built = 0;
+        while(built < maxEvents){
+            int best = -1;
+            for(int b=0;b<k;++b){
+                if(!have_[b]) have_[b] = s_[b]->q.try_pop(head_[b]);
+                if(have_[b] && (best<0 || head_[b].tNs < head_[best].tNs)) best = b;
+            }
+            // Flags and watermarks are loaded before the queue is re-checked: the board thread
+            // queues its hits before it publishes them.
+            bool retry = false, wait = false;
+            if(best<0){
+                for(int b=0;b<k;++b){
+                    const bool done = s_[b]->done.load(std::memory_order_acquire);
+                    if((have_[b] = s_[b]->q.try_pop(head_[b]))) retry = true;
+                    else if(!done) wait = true;
+                }
+                if(retry) continue;
+                return (wait || built) ? built : -1;
+            }
+            const BoardHit& c = head_[best];
+            for(int b=0;b<k;++b){
+                if(have_[b]) continue;
+                const bool done = s_[b]->done.load(std::memory_order_acquire);
+                const uint64_t drained = s_[b]->drainedNs.load(std::memory_order_acquire);
+                if((have_[b] = s_[b]->q.try_pop(head_[b]))) retry = true;
+                else if(!done && drained < c.readNs + window_) wait = true;
+            }
+            if(retry) continue;   // a new head may be earlier than the candidate
+            if(wait) return built;
+            ev_.tNs = c.tNs; ev_.n = 0;
+            for(int b=0;b<k;++b){
+                if(have_[b] && head_[b].tNs - c.tNs <= window_){
+                    ev_.board[ev_.n] = (uint8_t)b; ev_.hit[ev_.n] = head_[b]; ev_.n++;
+                }
+            }
+            if(!emit(ev_)) return built;
+            for(int i=0;i<ev_.n;++i) have_[ev_.board[i]] = false;
+            built++;
+        }
+        return built;
+    }
+
+private:
+    std::vector<BoardStream*> s_;
+    uint64_t window_;
+    std::vector<char> have_;
+    std::vector<BoardHit> head_;
+    BuiltEvent ev_;
+};
@@ -0,0 +1,259 @@
+// InfluxDB v1 exporter: line protocol batched over one keep-alive HTTP connection, with a bounded
+// on-disk spool so nothing is lost while the server is unreachable.
+//   add()   : append one line (timestamped here if the caller gives none); the batch is sent once it
+//             reaches batchBytes
+//   poll()  : send the batch once its oldest line is flushSec old; replay the spool when due
+//   flush() : POST the batch now. 2xx -> sent, then the spool is replayed.
+//             network error / 5xx -> batch appended to the spool, server left alone for retrySec
+//             (doubling up to 300 s; batches meanwhile go straight to the spool).
+//             4xx -> Influx refused the lines themselves: dropped with a warning (a replay would
+//             only be refused again and block everything behind it).
+// The spool is plain line protocol under flock, so several exporters (temperature loop,
+// heartbeats, perf stats) can share one file. Past spoolMax the oldest lines are dropped, at least half.
+// Link with -lcurl.
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <curl/curl.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common/perf.h"
+
+struct InfluxConfig {
+    std::string host = "127.0.0.1";
+    int port = 8086;
+    std::string db = "testdb";
+    std::string user, pass;
+    size_t batchBytes = 64 * 1024;  // send once the batch is this big
+    double flushSec = 10;           // ... or once its oldest line is this old
+    double retrySec = 15;           // first back-off after a failed POST
+    long timeoutMs = 5000;          // whole request; connecting gets at most 2 s of it
+    std::string spool;              // failed batches go here ("" = dropped)
+    size_t spoolMax = 32u << 20;
+    bool verbose = false;
+};
+
+// INFLUX_HOST/PORT/DB/USER/PASS and INFLUX_SPOOL, as the orchestrator's .env exports them.
+inline void influx_config_from_env(InfluxConfig& c){
+    if(const char* v = getenv("INFLUX_HOST"); v && *v) c.host = v;
+    if(const char* v = getenv("INFLUX_PORT"); v && *v) c.port = atoi(v);
+    if(const char* v = getenv("INFLUX_DB");   v && *v) c.db = v;
+    if(const char* v = getenv("INFLUX_USER"); v && *v) c.user = v;
+    if(const char* v = getenv("INFLUX_PASS"); v && *v) c.pass = v;
+    if(const char* v = getenv("INFLUX_SPOOL"); v && *v) c.spool = v;
+}
+
+inline uint64_t influx_now_ns(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct InfluxStats {
+    uint64_t lines = 0, posts = 0, failures = 0;
+    uint64_t sentLines = 0, spooledLines = 0, replayedLines = 0, droppedLines = 0;
+    uint64_t connects = 0;          // TCP connections opened (1 while keep-alive holds)
+};
+
+class InfluxExporter {
+public:
+    explicit InfluxExporter(const InfluxConfig& cfg) : cfg_(cfg) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        curl_ = curl_easy_init();
+        std::string url = "http://" + cfg_.host + ":" + std::to_string(cfg_.port) + "/write?db=" + esc_(cfg_.db) + "&precision=ns";
+        if(!cfg_.user.empty()) url += "&u=" + esc_(cfg_.user) + "&p=" + esc_(cfg_.pass);
+        hdr_ = curl_slist_append(hdr_, "Content-Type: text/plain; charset=utf-8");
+        hdr_ = curl_slist_append(hdr_, "Expect:");    // no 100-continue round trip on big batches
+        if(curl_){
+            curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(curl_, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, hdr_);
+            curl_easy_setopt(curl_, CURLOPT_TIMEOUT_MS, cfg_.timeoutMs);
+            curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT_MS, std::min(cfg_.timeoutMs, 2000L));
+            curl_easy_setopt(curl_, CURLOPT_NOSIGNAL, 1L);
+            curl_easy_setopt(curl_, CURLOPT_TCP_KEEPALIVE, 1L);
+            curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, &InfluxExporter::body_);
+            curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &reply_);
+        }
+        nextReplayNs_ = perf_now_ns();
+    }
+    ~InfluxExporter(){
+        flush();
+        if(curl_) curl_easy_cleanup(curl_);
+        curl_slist_free_all(hdr_);
+        curl_global_cleanup();
+    }
+    InfluxExporter(const InfluxExporter&) = delete;
+    InfluxExporter& operator=(const InfluxExporter&) = delete;
+
+    // One complete line ("meas,tags fields [ts]").
+    void add_line(const std::string& line){
+        if(line.empty()) return;
+        if(buf_.empty()) oldestNs_ = perf_now_ns();
+        buf_ += line;
+        if(line.back() != '\n') buf_ += '\n';
+        ++nbuf_; ++st_.lines;
+        if(buf_.size() >= cfg_.batchBytes) flush();
+    }
+    // "meas,tags" + fields; tsNs = 0 stamps it now, so a spooled point keeps its own time.
+    void add(const std::string& measTags, const std::string& fields, uint64_t tsNs = 0){
+        if(fields.empty()) return;
+        add_line(measTags + " " + fields + " " + std::to_string(tsNs ? tsNs : influx_now_ns()));
+    }
+
+    bool poll(){
+        const uint64_t now = perf_now_ns();
+        if(!buf_.empty() && now - oldestNs_ >= (uint64_t)(cfg_.flushSec*1e9)) return flush();
+        if(buf_.empty() && now >= nextReplayNs_) return replay_();
+        return true;
+    }
+
+    // Send what is buffered; false if it ended up in the spool (or dropped).
+    bool flush(){
+        if(buf_.empty()) return true;
+        if(perf_now_ns() < retryNs_){ spool_(buf_.data(), buf_.size(), nbuf_); clear_(); return false; }
+        const int r = post_(buf_.data(), buf_.size());
+        if(r == kRejected) st_.droppedLines += nbuf_;
+        else if(r == kRetry) spool_(buf_.data(), buf_.size(), nbuf_);
+        else st_.sentLines += nbuf_;
+        clear_();
+        if(r == kRetry) return false;
+        replay_();
+        return r == kOk;
+    }
+
+    const InfluxStats& stats() const { return st_; }
+    bool healthy() const { return retryNs_ == 0; }
+
+private:
+    enum { kOk, kRetry, kRejected };
+
+    static size_t body_(char* p, size_t sz, size_t n, void* ud){
+        std::string* s = static_cast<std::string*>(ud);
+        if(s->size() < 512) s->append(p, std::min<size_t>(sz*n, 512));
+        return sz*n;
+    }
+    std::string esc_(const std::string& v){
+        char* e = curl_easy_escape(nullptr, v.c_str(), (int)v.size());
+        std::string r = e ? e : "";
+        curl_free(e);
+        return r;
+    }
+    void clear_(){ buf_.clear(); nbuf_ = 0; }
+
+    int post_(const char* p, size_t n){
+        if(!curl_) return kRetry;
+        reply_.clear();
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, p);
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)n);
+        const CURLcode res = curl_easy_perform(curl_);
+        long code = 0, conns = 0;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &code);
+        curl_easy_getinfo(curl_, CURLINFO_NUM_CONNECTS, &conns);
+        ++st_.posts; st_.connects += (uint64_t)conns;
+        if(res == CURLE_OK && code >= 200 && code < 300){
+            retryNs_ = 0; backoffSec_ = cfg_.retrySec;
+            return kOk;
+        }
+        ++st_.failures;
+        while(!reply_.empty() && (reply_.back()=='\n' || reply_.back()=='\r')) reply_.pop_back();
+        if(res == CURLE_OK && code >= 400 && code < 500){
+            fprintf(stderr,"[warn] influx refused %zu bytes (HTTP %ld): %s\n", n, code, reply_.c_str());
+            return kRejected;
+        }
+        fprintf(stderr,"[warn] influx %s:%d unreachable (%s); retry in %.0f s\n", cfg_.host.c_str(), cfg_.port,
+                res != CURLE_OK ? curl_easy_strerror(res) : ("HTTP " + std::to_string(code)).c_str(), backoffSec_);
+        retryNs_ = perf_now_ns() + (uint64_t)(backoffSec_*1e9);
+        nextReplayNs_ = retryNs_;
+        backoffSec_ = std::min(300.0, 2*backoffSec_);
+        return kRetry;
+    }
+
+    static uint64_t count_lines_(const char* p, size_t n){ return (uint64_t)std::count(p, p+n, '\n'); }
+
+    // Append under the lock; trims the oldest lines first if the file would pass spoolMax.
+    void spool_(const char* p, size_t n, uint64_t lines){
+        if(cfg_.spool.empty()){ st_.droppedLines += lines; return; }
+        const int fd = open(cfg_.spool.c_str(), O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+        if(fd < 0){ fprintf(stderr,"[warn] cannot open influx spool '%s'\n", cfg_.spool.c_str()); st_.droppedLines += lines; return; }
+        flock(fd, LOCK_EX);
+        struct stat sb{};
+        fstat(fd, &sb);
+        size_t size = (size_t)sb.st_size;
+        if(n > cfg_.spoolMax){              // keep the newest lines of an oversized batch
+            const char* q = (const char*)memchr(p + (n - cfg_.spoolMax/2), '\n', cfg_.spoolMax/2);
+            const size_t skip = q ? size_t(q + 1 - p) : n;
+            st_.droppedLines += count_lines_(p, skip); lines -= count_lines_(p, skip);
+            p += skip; n -= skip;
+        }
+        if(size + n > cfg_.spoolMax){
+            std::string keep(size, '\0');
+            const ssize_t got = pread(fd, &keep[0], size, 0);
+            keep.resize(got > 0 ? (size_t)got : 0);
+            const size_t room = std::min(cfg_.spoolMax/2, cfg_.spoolMax - n);
+            size_t cut = keep.size() > room ? keep.size() - room : 0;
+            if(cut){ const size_t nl = keep.find('\n', cut); cut = nl == std::string::npos ? keep.size() : nl + 1; }
+            const uint64_t dropped = count_lines_(keep.data(), cut);
+            st_.droppedLines += dropped;
+            fprintf(stderr,"[warn] influx spool full (%zu bytes): dropped the oldest %llu lines\n", size, (unsigned long long)dropped);
+            size = keep.size() - cut;
+            if(pwrite(fd, keep.data() + cut, size, 0) != (ssize_t)size || ftruncate(fd, (off_t)size) != 0)
+                fprintf(stderr,"[warn] cannot rewrite influx spool '%s'\n", cfg_.spool.c_str());
+        }
+        if(pwrite(fd, p, n, (off_t)size) == (ssize_t)n) st_.spooledLines += lines;
+        else { st_.droppedLines += lines; fprintf(stderr,"[warn] cannot append to influx spool '%s'\n", cfg_.spool.c_str()); }
+        close(fd);
+    }
+
+    // Post the spool in batchBytes chunks, oldest first; what could not be sent stays in it.
+    bool replay_(){
+        nextReplayNs_ = perf_now_ns() + 60000000000ull;    // also catch what other exporters spooled
+        if(cfg_.spool.empty() || perf_now_ns() < retryNs_) return healthy();
+        const int fd = open(cfg_.spool.c_str(), O_RDWR|O_CLOEXEC);
+        if(fd < 0) return true;
+        if(flock(fd, LOCK_EX|LOCK_NB) != 0){ close(fd); return true; }   // another exporter is at it
+        struct stat sb{};
+        fstat(fd, &sb);
+        std::string data((size_t)sb.st_size, '\0');
+        const ssize_t got = sb.st_size ? pread(fd, &data[0], data.size(), 0) : 0;
+        data.resize(got > 0 ? (size_t)got : 0);
+        size_t off = 0;
+        bool ok = true;
+        while(off < data.size()){
+            size_t end = std::min(data.size(), off + cfg_.batchBytes);
+            if(end < data.size()){ const size_t nl = data.rfind('\n', end - 1); end = nl != std::string::npos && nl >= off ? nl + 1 : data.find('\n', end); }
+            if(end == std::string::npos) end = data.size();
+            const uint64_t lines = count_lines_(data.data() + off, end - off);
+            const int r = post_(data.data() + off, end - off);
+            if(r == kRetry){ ok = false; break; }
+            if(r == kRejected) st_.droppedLines += lines; else st_.replayedLines += lines;
+            off = end;
+        }
+        if(off){
+            const size_t rest = data.size() - off;
+            if((rest && pwrite(fd, data.data() + off, rest, 0) != (ssize_t)rest) || ftruncate(fd, (off_t)rest) != 0)
+                fprintf(stderr,"[warn] cannot rewrite influx spool '%s'\n", cfg_.spool.c_str());
+            if(cfg_.verbose) fprintf(stderr,"[info] influx spool: replayed %zu bytes, %zu left\n", off, rest);
+        }
+        close(fd);
+        return ok;
+    }
+
+    InfluxConfig cfg_;
+    CURL* curl_ = nullptr;
+    curl_slist* hdr_ = nullptr;
+    std::string buf_, reply_;
+    uint64_t nbuf_ = 0, oldestNs_ = 0;
+    uint64_t retryNs_ = 0, nextReplayNs_ = 0;
+    double backoffSec_ = cfg_.retrySec;
+    InfluxStats st_;
+};
@@ -0,0 +1,221 @@
+// Live monitoring stream in POSIX shared memory (/dev/shm/<name>): one writer (the acquisition's
+// write stage), any number of readers that only map it read-only, so they cannot slow or block
+// the run.
+//   header : geometry, a generation that changes whenever the writer (re)initialises the segment,
+//            and 'head' = records published so far
+//   status : run state, counts, rates and temperatures under a seqlock (odd = being written)
+//   ring   : nslots fixed-size slots; record n goes to slot n % nslots. Each slot has its own
+//            seqlock: 2n+1 while record n is written, 2n+2 once it is complete.
+// A reader copies (or inspects in place) a record and re-checks the slot's sequence afterwards;
+// a changed sequence means the writer lapped it and the copy is discarded.
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+constexpr uint32_t kLiveMagic   = 0x5649564Cu;  // "LVIV"
+constexpr uint32_t kLiveVersion = 1;
+constexpr const char* kDefaultLiveName = "/daq_live";
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+enum LiveState : uint32_t { kLiveIdle = 0, kLiveRunning = 1, kLiveEnded = 2 };
+
+struct LiveStatus {
+    uint32_t state = kLiveIdle;
+    uint32_t serial = 0;
+    char     tag[32] = {};
+    uint64_t startWallNs = 0;       // CLOCK_REALTIME at acquisition start
+    uint64_t updateWallNs = 0;
+    uint64_t events = 0;            // events written so far
+    uint64_t triggers = 0;          // EventCounter-based, including triggers lost while busy
+    double   eventRate = 0;         // Hz over the last update interval
+    double   triggerRate = 0;       // Hz of trigger time over the same interval
+    double   deadFrac = 0;          // lost / triggers over the interval
+    float    temp[8] = {};          // ADC temperatures (C), -1 when not read
+    uint64_t tempWallNs = 0;
+};
+
+struct LiveHeader {
+    uint32_t magic = 0, version = 0;
+    uint32_t nslots = 0, slotBytes = 0;
+    uint32_t recLen = 0, chMask = 0;        // samples per channel and the channels in each record
+    uint32_t pid = 0, reserved = 0;
+    std::atomic<uint64_t> generation;
+    std::atomic<uint64_t> head;             // records published
+    std::atomic<uint64_t> statusSeq;
+    LiveStatus status;
+};
+
+struct LiveRecord {
+    std::atomic<uint64_t> seq;
+    uint64_t tNs = 0;                       // rollover-corrected trigger time
+    uint32_t eventCounter = 0, ttt = 0;
+    uint32_t chMask = 0, ns = 0;            // channels present, valid samples per channel
+    // then recLen uint16 per channel of the header's chMask, in channel order
+    const uint16_t* samples() const { return reinterpret_cast<const uint16_t*>(this + 1); }
+    uint16_t* samples() { return reinterpret_cast<uint16_t*>(this + 1); }
+};
+
+// Samples of channel c in record r (nullptr if c is not in the record).
+inline const uint16_t* live_channel(const LiveHeader& h, const LiveRecord& r, int c){
+    if(!((r.chMask>>c)&1) || !((h.chMask>>c)&1)) return nullptr;
+    return r.samples() + (size_t)__builtin_popcount(h.chMask & ((1u<<c)-1)) * h.recLen;
+}
+
+inline size_t live_slot_bytes(uint32_t recLen, uint32_t chMask){
+    const size_t b = sizeof(LiveRecord) + (size_t)__builtin_popcount(chMask & 0xFF) * recLen * sizeof(uint16_t);
+    return (b + 63) & ~size_t(63);
+}
+
+inline size_t live_segment_bytes(uint32_t nslots, uint32_t slotBytes){
+    return ((sizeof(LiveHeader) + 63) & ~size_t(63)) + (size_t)nslots * slotBytes;
+}
+
+class LiveWriter {
+public:
+    ~LiveWriter(){ close(); }
+
+    // Create (or take over) the segment. Readers mapped on an older geometry see the generation change.
+    bool open(const std::string& name, uint32_t nslots, uint32_t recLen, uint32_t chMask){
+        close();
+        const uint32_t slot = (uint32_t)live_slot_bytes(recLen, chMask);
+        bytes_ = live_segment_bytes(nslots, slot);
+        int fd = shm_open(name.c_str(), O_CREAT|O_RDWR, 0644);
+        if(fd < 0) return false;
+        struct stat st{};
+        // never shrink: a reader still mapping the old size would fault past the end
+        if(fstat(fd, &st) != 0 || ((size_t)st.st_size < bytes_ && ftruncate(fd, (off_t)bytes_) != 0)){ ::close(fd); return false; }
+        void* p = mmap(nullptr, bytes_, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) return false;
+        base_ = (char*)p;
+        h_ = reinterpret_cast<LiveHeader*>(base_);
+        const uint64_t gen = h_->magic == kLiveMagic ? h_->generation.load(std::memory_order_relaxed) + 1 : 1;
+        h_->magic = 0;                        // readers back off while the header is rewritten
+        std::atomic_thread_fence(std::memory_order_release);
+        h_->version = kLiveVersion;
+        h_->nslots = nslots; h_->slotBytes = slot;
+        h_->recLen = recLen; h_->chMask = chMask & 0xFF;
+        h_->pid = (uint32_t)getpid();
+        h_->head.store(0, std::memory_order_relaxed);
+        h_->statusSeq.store(0, std::memory_order_relaxed);
+        h_->status = LiveStatus{};
+        for(uint32_t i=0;i<nslots;++i) slot_(i)->seq.store(0, std::memory_order_relaxed);
+        h_->generation.store(gen, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        h_->magic = kLiveMagic;
+        return true;
+    }
+
+    void close(){
+        if(base_) munmap(base_, bytes_);
+        base_ = nullptr; h_ = nullptr;
+    }
+    bool is_open() const { return h_ != nullptr; }
+
+    // Publish one event; wave[c] / ns as in the pipeline's Event (channels outside the mask are skipped).
+    void publish(uint64_t tNs, uint32_t cnt, uint32_t ttt, uint16_t* const wave[8], const uint32_t ns[8]){
+        if(!h_) return;
+        const uint64_t n = h_->head.load(std::memory_order_relaxed);
+        LiveRecord* r = slot_((uint32_t)(n % h_->nslots));
+        r->seq.store(2*n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        uint32_t len = h_->recLen, mask = 0;
+        for(int c=0;c<8;++c) if(((h_->chMask>>c)&1) && wave[c] && ns[c]){ mask |= 1u<<c; if(ns[c] < len) len = ns[c]; }
+        r->tNs = tNs; r->eventCounter = cnt; r->ttt = ttt;
+        r->chMask = mask; r->ns = mask ? len : 0;
+        uint16_t* out = r->samples();
+        for(int c=0;c<8;++c)                  // slots are laid out for the full header mask
+            if((h_->chMask>>c)&1){ if((mask>>c)&1) std::memcpy(out, wave[c], len*sizeof(uint16_t)); out += h_->recLen; }
+        r->seq.store(2*n + 2, std::memory_order_release);
+        h_->head.store(n + 1, std::memory_order_release);
+    }
+
+    void set_status(const LiveStatus& s){
+        if(!h_) return;
+        const uint64_t q = h_->statusSeq.load(std::memory_order_relaxed);
+        h_->statusSeq.store(q + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        h_->status = s;
+        h_->statusSeq.store(q + 2, std::memory_order_release);
+    }
+
+private:
+    LiveRecord* slot_(uint32_t i){
+        return reinterpret_cast<LiveRecord*>(base_ + ((sizeof(LiveHeader) + 63) & ~size_t(63)) + (size_t)i * h_->slotBytes);
+    }
+    char* base_ = nullptr;
+    size_t bytes_ = 0;
+    LiveHeader* h_ = nullptr;
+};
+
+class LiveReader {
+public:
+    ~LiveReader(){ close(); }
+
+    bool open(const std::string& name){
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if(fd < 0) return false;
+        struct stat st{};
+        if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LiveHeader)){ ::close(fd); return false; }
+        bytes_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) return false;
+        base_ = (const char*)p;
+        h_ = reinterpret_cast<const LiveHeader*>(base_);
+        if(h_->magic != kLiveMagic || h_->version != kLiveVersion
+           || live_segment_bytes(h_->nslots, h_->slotBytes) > bytes_){ close(); return false; }
+        gen_ = h_->generation.load(std::memory_order_acquire);
+        return true;
+    }
+    void close(){
+        if(base_) munmap((void*)base_, bytes_);
+        base_ = nullptr; h_ = nullptr;
+    }
+
+    // The writer re-initialised the segment (new run geometry): open() again.
+    bool stale() const { return !h_ || h_->magic != kLiveMagic || h_->generation.load(std::memory_order_acquire) != gen_; }
+    const LiveHeader* header() const { return h_; }
+    uint64_t head() const { return h_->head.load(std::memory_order_acquire); }
+
+    bool status(LiveStatus& out) const {
+        for(int tries=0; tries<100; ++tries){
+            const uint64_t a = h_->statusSeq.load(std::memory_order_acquire);
+            if(a & 1) continue;
+            std::memcpy(&out, (const void*)&h_->status, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(h_->statusSeq.load(std::memory_order_relaxed) == a) return true;
+        }
+        return false;
+    }
+
+    // Zero-copy access to record n: fn(const LiveRecord&) runs on the shared slot. Returns false
+    // if the record is not (or no longer) there; then whatever fn saw must be thrown away.
+    template <class Fn>
+    bool peek(uint64_t n, Fn&& fn) const {
+        const LiveRecord* r = slot_((uint32_t)(n % h_->nslots));
+        if(r->seq.load(std::memory_order_acquire) != 2*n + 2) return false;
+        fn(*r);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return r->seq.load(std::memory_order_relaxed) == 2*n + 2;
+    }
+
+private:
+    const LiveRecord* slot_(uint32_t i) const {
+        return reinterpret_cast<const LiveRecord*>(base_ + ((sizeof(LiveHeader) + 63) & ~size_t(63)) + (size_t)i * h_->slotBytes);
+    }
+    const char* base_ = nullptr;
+    size_t bytes_ = 0;
+    const LiveHeader* h_ = nullptr;
+    uint64_t gen_ = 0;
+};
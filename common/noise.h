@@ -0,0 +1,325 @@
+// Online baseline noise from software-triggered events (--noise):
+//   mean/rms : per channel and sample, running mean and variance over events (Welford; one event
+//              updates every sample with the same 1/n, so the loop vectorizes: SSE2/AVX2 and
+//              aarch64 NEON kernels, scalar fallback)
+//   psd      : averaged one-sided power spectral density in ADC^2/Hz of the first nfft samples
+//              (largest power of two <= record length), event mean removed, Hann window,
+//              radix-2 real FFT (an nfft/2 complex FFT plus the split step)
+// NoiseWorker runs the accumulation on its own thread: the write stage offer()s an event, which
+// is copied into a small pool and never waits; with the pool full the event is dropped (counted).
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "common/spsc_ring.h"
+
+// --- Welford update with the n-th event (invN = 1/n) ---
+
+inline void noise_welford_scalar(const uint16_t* s, uint32_t ns, double invN, double* mean, double* m2){
+    for(uint32_t i=0;i<ns;++i){
+        const double x = s[i], d = x - mean[i];
+        mean[i] += d*invN;
+        m2[i] += d*(x - mean[i]);
+    }
+}
+
+#if defined(__x86_64__)
+inline void noise_welford_sse2(const uint16_t* s, uint32_t ns, double invN, double* mean, double* m2){
+    const __m128d inv = _mm_set1_pd(invN);
+    const __m128i z = _mm_setzero_si128();
+    uint32_t i = 0;
+    for(; i+4<=ns; i+=4){
+        const __m128i v = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s+i)), z);
+        const __m128d x[2] = {_mm_cvtepi32_pd(v), _mm_cvtepi32_pd(_mm_srli_si128(v, 8))};
+        for(int h=0;h<2;++h){
+            const __m128d m = _mm_loadu_pd(mean+i+2*h), d = _mm_sub_pd(x[h], m);
+            const __m128d mn = _mm_add_pd(m, _mm_mul_pd(d, inv));
+            _mm_storeu_pd(mean+i+2*h, mn);
+            _mm_storeu_pd(m2+i+2*h, _mm_add_pd(_mm_loadu_pd(m2+i+2*h), _mm_mul_pd(d, _mm_sub_pd(x[h], mn))));
+        }
+    }
+    noise_welford_scalar(s+i, ns-i, invN, mean+i, m2+i);
+}
+
+__attribute__((target("avx2")))
+inline void noise_welford_avx2(const uint16_t* s, uint32_t ns, double invN, double* mean, double* m2){
+    const __m256d inv = _mm256_set1_pd(invN);
+    uint32_t i = 0;
+    for(; i+4<=ns; i+=4){
+        const __m256d x = _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s+i))));
+        const __m256d m = _mm256_loadu_pd(mean+i), d = _mm256_sub_pd(x, m);
+        const __m256d mn = _mm256_add_pd(m, _mm256_mul_pd(d, inv));
+        _mm256_storeu_pd(mean+i, mn);
+        _mm256_storeu_pd(m2+i, _mm256_add_pd(_mm256_loadu_pd(m2+i), _mm256_mul_pd(d, _mm256_sub_pd(x, mn))));
+    }
+    noise_welford_scalar(s+i, ns-i, invN, mean+i, m2+i);
+}
+#endif
+
+#if defined(__aarch64__)
+inline void noise_welford_neon(const uint16_t* s, uint32_t ns, double invN, double* mean, double* m2){
+    const float64x2_t inv = vdupq_n_f64(invN);
+    uint32_t i = 0;
+    for(; i+4<=ns; i+=4){
+        const uint32x4_t v = vmovl_u16(vld1_u16(s+i));
+        const float64x2_t x[2] = {vcvtq_f64_u64(vmovl_u32(vget_low_u32(v))), vcvtq_f64_u64(vmovl_u32(vget_high_u32(v)))};
+        for(int h=0;h<2;++h){
+            const float64x2_t m = vld1q_f64(mean+i+2*h), d = vsubq_f64(x[h], m);
+            const float64x2_t mn = vaddq_f64(m, vmulq_f64(d, inv));
+            vst1q_f64(mean+i+2*h, mn);
+            vst1q_f64(m2+i+2*h, vaddq_f64(vld1q_f64(m2+i+2*h), vmulq_f64(d, vsubq_f64(x[h], mn))));
+        }
+    }
+    noise_welford_scalar(s+i, ns-i, invN, mean+i, m2+i);
+}
+#endif
+
+using NoiseWelfordFn = void (*)(const uint16_t*, uint32_t, double, double*, double*);
+
+inline NoiseWelfordFn noise_best_welford(const char** name = nullptr){
+#if defined(__x86_64__)
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    if(name) *name = avx2 ? "avx2" : "sse2";
+    return avx2 ? noise_welford_avx2 : noise_welford_sse2;
+#elif defined(__aarch64__)
+    if(name) *name = "neon";
+    return noise_welford_neon;
+#else
+    if(name) *name = "scalar";
+    return noise_welford_scalar;
+#endif
+}
+
+// --- radix-2 real FFT: n real samples -> |X_k|^2, k = 0..n/2 ---
+
+class RealFft {
+public:
+    explicit RealFft(uint32_t n = 0){ plan(n); }
+
+    // n: power of two >= 4
+    void plan(uint32_t n){
+        n_ = n; h_ = n/2;
+        if(n < 4) return;
+        rev_.assign(h_, 0);
+        for(uint32_t i=0, b=0; i<h_; ++i){
+            rev_[i] = b;
+            for(uint32_t m=h_>>1; m && ((b ^= m) & m)==0; m>>=1){}
+        }
+        tw_.resize(h_/2); sp_.resize(h_ + 1);
+        for(uint32_t k=0;k<h_/2;++k){ const double a = -2*M_PI*k/h_; tw_[k] = {std::cos(a), std::sin(a)}; }
+        for(uint32_t k=0;k<=h_;++k){ const double a = -2*M_PI*k/n_; sp_[k] = {std::cos(a), std::sin(a)}; }
+        z_.resize(h_);
+    }
+    uint32_t size() const { return n_; }
+
+    void power(const double* x, double* p){
+        // pack even/odd samples as one complex sequence, bit-reversed
+        for(uint32_t i=0;i<h_;++i) z_[rev_[i]] = {x[2*i], x[2*i+1]};
+        for(uint32_t len=2; len<=h_; len<<=1){
+            const uint32_t half = len/2, step = h_/len;
+            for(uint32_t b=0; b<h_; b+=len)
+                for(uint32_t j=0;j<half;++j){
+                    const C w = tw_[j*step], u = z_[b+j], v = mul(z_[b+j+half], w);
+                    z_[b+j] = {u.re + v.re, u.im + v.im};
+                    z_[b+j+half] = {u.re - v.re, u.im - v.im};
+                }
+        }
+        // split: X_k = (Z_k + conj Z_{h-k})/2 - i e^{-2 pi i k/n} (Z_k - conj Z_{h-k})/2
+        for(uint32_t k=0;k<=h_;++k){
+            const C a = z_[k % h_], b = z_[(h_ - k) % h_];
+            const C e = {(a.re + b.re)/2, (a.im - b.im)/2};
+            const C o = {(a.im + b.im)/2, -(a.re - b.re)/2};
+            const C t = mul(o, sp_[k]);
+            const double re = e.re + t.re, im = e.im + t.im;
+            p[k] = re*re + im*im;
+        }
+    }
+
+private:
+    struct C { double re, im; };
+    static C mul(C a, C b){ return {a.re*b.re - a.im*b.im, a.re*b.im + a.im*b.re}; }
+    uint32_t n_ = 0, h_ = 0;
+    std::vector<uint32_t> rev_;
+    std::vector<C> tw_, sp_, z_;
+};
+
+// --- per-channel accumulators ---
+
+class NoiseAccum {
+public:
+    static constexpr double kFsHz = 500e6;  // x730: 2 ns per sample
+
+    void init(uint32_t recLen, uint32_t chMask){
+        recLen_ = recLen; mask_ = chMask & 0xFF;
+        nfft_ = 4;
+        while(nfft_*2 <= recLen_) nfft_ *= 2;
+        fft_.plan(nfft_);
+        win_.resize(nfft_);
+        wss_ = 0;
+        for(uint32_t i=0;i<nfft_;++i){ win_[i] = 0.5 - 0.5*std::cos(2*M_PI*i/nfft_); wss_ += win_[i]*win_[i]; }
+        x_.resize(nfft_); p_.resize(nfft_/2 + 1);
+        for(int c=0;c<8;++c){
+            const bool on = (mask_>>c)&1;
+            n_[c] = 0;
+            mean_[c].assign(on ? recLen_ : 0, 0.0);
+            m2_[c].assign(on ? recLen_ : 0, 0.0);
+            psd_[c].assign(on ? nfft_/2 + 1 : 0, 0.0);
+        }
+        welford_ = noise_best_welford(&kernel_);
+    }
+
+    // The first record sets the length if the board's differs from the requested one; later
+    // records of another length are skipped (they would bias the per-sample statistics).
+    void add(int c, const uint16_t* s, uint32_t ns){
+        if(c<0 || c>=8 || !((mask_>>c)&1) || ns < 4) return;
+        if(ns != recLen_){
+            for(int k=0;k<8;++k) if(n_[k]) return;
+            init(ns, mask_);
+        }
+        n_[c]++;
+        welford_(s, recLen_, 1.0/n_[c], mean_[c].data(), m2_[c].data());
+        double m = 0;
+        for(uint32_t i=0;i<nfft_;++i) m += s[i];
+        m /= nfft_;
+        for(uint32_t i=0;i<nfft_;++i) x_[i] = (s[i] - m)*win_[i];
+        fft_.power(x_.data(), p_.data());
+        double* acc = psd_[c].data();
+        for(uint32_t k=0;k<=nfft_/2;++k) acc[k] += p_[k];
+    }
+
+    uint32_t mask() const { return mask_; }
+    uint32_t rec_len() const { return recLen_; }
+    uint32_t nfft() const { return nfft_; }
+    uint64_t events(int c) const { return n_[c]; }
+    const char* kernel() const { return kernel_; }
+    double df_hz() const { return kFsHz / nfft_; }
+
+    double mean(int c, uint32_t i) const { return mean_[c][i]; }
+    double var(int c, uint32_t i) const { return n_[c] > 1 ? m2_[c][i]/(n_[c] - 1) : 0.0; }
+    // rms over the record: sqrt of the mean per-sample variance
+    double rms(int c) const {
+        if(n_[c] < 2) return 0.0;
+        double v = 0;
+        for(uint32_t i=0;i<recLen_;++i) v += var(c, i);
+        return std::sqrt(v/recLen_);
+    }
+    // One-sided PSD in ADC^2/Hz at bin k (k*df_hz()); sum of psd*df over all bins = variance.
+    double psd(int c, uint32_t k) const {
+        if(!n_[c]) return 0.0;
+        const double onesided = (k==0 || k==nfft_/2) ? 1.0 : 2.0;
+        return onesided * psd_[c][k] / (n_[c] * kFsHz * wss_);
+    }
+    // rms in [f0, f1) Hz from the PSD
+    double band_rms(int c, double f0, double f1) const {
+        double v = 0;
+        for(uint32_t k=0;k<=nfft_/2;++k){ const double f = k*df_hz(); if(f>=f0 && f<f1) v += psd(c, k); }
+        return std::sqrt(v*df_hz());
+    }
+    // frequency of the largest PSD bin above DC
+    double peak_hz(int c) const {
+        if(!n_[c]) return 0.0;
+        uint32_t best = 1;
+        for(uint32_t k=2;k<=nfft_/2;++k) if(psd_[c][k] > psd_[c][best]) best = k;
+        return best*df_hz();
+    }
+
+private:
+    uint32_t recLen_ = 0, mask_ = 0, nfft_ = 0;
+    uint64_t n_[8] = {};
+    std::vector<double> mean_[8], m2_[8], psd_[8];
+    std::vector<double> win_, x_, p_;
+    double wss_ = 0;                    // sum of the window squared
+    RealFft fft_;
+    NoiseWelfordFn welford_ = noise_welford_scalar;
+    const char* kernel_ = "scalar";
+};
+
+// Accumulates on its own thread; offer() is called by one producer thread.
+class NoiseWorker {
+public:
+    NoiseWorker(uint32_t recLen, uint32_t chMask, uint32_t slots = 64)
+        : free_(slots), full_(slots), recLen_(recLen), mask_(chMask & 0xFF) {
+        acc_.init(recLen, mask_);
+        const uint32_t n = (uint32_t)free_.capacity();
+        buf_.resize((size_t)n * 8 * recLen);
+        ns_.resize((size_t)n * 8);
+        for(uint32_t i=0;i<n;++i) free_.try_push(i);
+        th_ = std::thread([this]{ run_(); });
+    }
+    ~NoiseWorker(){ finish(); }
+
+    // Copies the event's channels in the mask; false (dropped) when the pool is full. Samples past
+    // the constructor's recLen are dropped, so construct it with the record length the board
+    // reads back (daq_threshold does), not the requested one.
+    bool offer(const uint16_t* const wave[8], const uint32_t ns[8]){
+        uint32_t slot;
+        if(!free_.try_pop(slot)){ dropped_++; return false; }
+        uint16_t* b = &buf_[(size_t)slot * 8 * recLen_];
+        uint32_t* n = &ns_[(size_t)slot * 8];
+        for(int c=0;c<8;++c){
+            n[c] = ((mask_>>c)&1) && wave[c] ? std::min(ns[c], recLen_) : 0;
+            if(n[c]) std::memcpy(b + (size_t)c*recLen_, wave[c], n[c]*sizeof(uint16_t));
+        }
+        full_.try_push(slot);
+        offered_++;
+        return true;
+    }
+
+    // Drains the queue and stops the thread.
+    void finish(){
+        if(!th_.joinable()) return;
+        stop_ = true;
+        th_.join();
+    }
+
+    // fn(const NoiseAccum&) with the accumulators consistent (between two events).
+    template <class Fn>
+    void read(Fn&& fn){
+        std::lock_guard<std::mutex> lk(m_);
+        fn(static_cast<const NoiseAccum&>(acc_));
+    }
+    uint64_t offered() const { return offered_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    void run_(){
+        Backoff bo;
+        for(;;){
+            uint32_t slot;
+            if(!full_.try_pop(slot)){
+                if(stop_.load() && full_.size()==0) return;
+                bo.wait(); continue;
+            }
+            bo.reset();
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                for(int c=0;c<8;++c){
+                    const uint32_t n = ns_[(size_t)slot*8 + c];
+                    if(n) acc_.add(c, &buf_[((size_t)slot*8 + c) * recLen_], n);
+                }
+            }
+            free_.try_push(slot);
+        }
+    }
+    SpscRing<uint32_t> free_, full_;
+    uint32_t recLen_, mask_;
+    std::vector<uint16_t> buf_;
+    std::vector<uint32_t> ns_;
+    NoiseAccum acc_;
+    std::mutex m_;
+    std::atomic<bool> stop_{false};
+    uint64_t offered_ = 0, dropped_ = 0;   // producer-owned
+    std::thread th_;
+};
@@ -0,0 +1,240 @@
+// Pedestal and noise calibration: M software-triggered events on all 8 channels, per-channel mean
+// and RMS accumulated straight from the packed X730 words (no unpacking; SSE2/AVX2/NEON kernels,
+// scalar fallback). Events whose mean or RMS on a channel stands out from the median event (a
+// pulse in the window) are left out for that channel, so one noisy event cannot move the pedestal.
+// Results are cached per board serial, DC offset and temperature bucket:
+//   <dir>/ped_<serial>_<dcoffset hex>_t<bucket>.cal
+
+#pragma once
+#include <CAENDigitizer.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "common/board_config.h"
+#include "common/x730.h"
+
+struct PedestalCal {
+    uint32_t serial = 0, dcOffset = 0;
+    int32_t  tempBucket = -1;           // -1: temperatures unavailable
+    uint32_t events = 0;                // events read
+    uint32_t used[8] = {};              // events kept per channel
+    uint64_t wallNs = 0;                // when it was measured (CLOCK_REALTIME)
+    float    mean[8] = {}, rms[8] = {};
+};
+
+// --- accumulation: sum and sum of squares of the 2*nwords samples in nwords packed words ---
+
+inline void ped_acc_scalar(const uint32_t* w, uint32_t nwords, uint64_t& sum, uint64_t& sq){
+    uint64_t s = 0, q = 0;
+    for(uint32_t k=0;k<nwords;++k){
+        const uint32_t a = w[k] & 0x3FFF, b = (w[k] >> 16) & 0x3FFF;
+        s += a + b;
+        q += a*a + b*b;
+    }
+    sum += s; sq += q;
+}
+
+#if defined(__x86_64__)
+// madd against 1 gives s0+s1 per 32-bit lane, madd against itself s0^2+s1^2 (< 2^30, 14-bit samples)
+inline void ped_acc_sse2(const uint32_t* w, uint32_t nwords, uint64_t& sum, uint64_t& sq){
+    const __m128i m = _mm_set1_epi32(0x3FFF3FFF), one = _mm_set1_epi16(1), z = _mm_setzero_si128();
+    __m128i s64 = z, q64 = z;
+    uint32_t k = 0;
+    for(; k+4<=nwords; k+=4){
+        const __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w+k)), m);
+        const __m128i s = _mm_madd_epi16(v, one), q = _mm_madd_epi16(v, v);
+        s64 = _mm_add_epi64(s64, _mm_add_epi64(_mm_unpacklo_epi32(s, z), _mm_unpackhi_epi32(s, z)));
+        q64 = _mm_add_epi64(q64, _mm_add_epi64(_mm_unpacklo_epi32(q, z), _mm_unpackhi_epi32(q, z)));
+    }
+    uint64_t a[2], b[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(a), s64);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(b), q64);
+    sum += a[0] + a[1]; sq += b[0] + b[1];
+    ped_acc_scalar(w+k, nwords-k, sum, sq);
+}
+
+__attribute__((target("avx2")))
+inline void ped_acc_avx2(const uint32_t* w, uint32_t nwords, uint64_t& sum, uint64_t& sq){
+    const __m256i m = _mm256_set1_epi32(0x3FFF3FFF), one = _mm256_set1_epi16(1), z = _mm256_setzero_si256();
+    __m256i s64 = z, q64 = z;
+    uint32_t k = 0;
+    for(; k+8<=nwords; k+=8){
+        const __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(w+k)), m);
+        const __m256i s = _mm256_madd_epi16(v, one), q = _mm256_madd_epi16(v, v);
+        s64 = _mm256_add_epi64(s64, _mm256_add_epi64(_mm256_unpacklo_epi32(s, z), _mm256_unpackhi_epi32(s, z)));
+        q64 = _mm256_add_epi64(q64, _mm256_add_epi64(_mm256_unpacklo_epi32(q, z), _mm256_unpackhi_epi32(q, z)));
+    }
+    uint64_t a[4], b[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(a), s64);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(b), q64);
+    sum += a[0] + a[1] + a[2] + a[3]; sq += b[0] + b[1] + b[2] + b[3];
+    ped_acc_scalar(w+k, nwords-k, sum, sq);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+inline void ped_acc_neon(const uint32_t* w, uint32_t nwords, uint64_t& sum, uint64_t& sq){
+    const uint32x4_t m = vdupq_n_u32(0x3FFF3FFFu);
+    uint64x2_t s64 = vdupq_n_u64(0), q64 = vdupq_n_u64(0);
+    uint32_t k = 0;
+    for(; k+4<=nwords; k+=4){
+        const uint16x8_t v = vreinterpretq_u16_u32(vandq_u32(vld1q_u32(w+k), m));
+        uint32x4_t q = vmull_u16(vget_low_u16(v), vget_low_u16(v));
+        q = vmlal_u16(q, vget_high_u16(v), vget_high_u16(v));
+        s64 = vpadalq_u32(s64, vpaddlq_u16(v));
+        q64 = vpadalq_u32(q64, q);
+    }
+    sum += vgetq_lane_u64(s64, 0) + vgetq_lane_u64(s64, 1);
+    sq  += vgetq_lane_u64(q64, 0) + vgetq_lane_u64(q64, 1);
+    ped_acc_scalar(w+k, nwords-k, sum, sq);
+}
+#endif
+
+using PedAccFn = void (*)(const uint32_t*, uint32_t, uint64_t&, uint64_t&);
+
+inline PedAccFn ped_best_acc(const char** name = nullptr){
+#if defined(__x86_64__)
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    if(name) *name = avx2 ? "avx2" : "sse2";
+    return avx2 ? ped_acc_avx2 : ped_acc_sse2;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if(name) *name = "neon";
+    return ped_acc_neon;
+#else
+    if(name) *name = "scalar";
+    return ped_acc_scalar;
+#endif
+}
+
+// --- measurement ---
+
+// Per-event sums of every channel, reduced to mean/RMS with outlier events left out.
+class PedestalAccumulator {
+public:
+    void add(const X730Event& xe){
+        static const PedAccFn acc = ped_best_acc();
+        for(int c=0;c<8;++c){
+            if(!((xe.chMask>>c)&1) || !xe.wordsPerCh) continue;
+            Sums s; s.n = 2*xe.wordsPerCh;
+            acc(x730_channel(xe, c), xe.wordsPerCh, s.sum, s.sq);
+            ev_[c].push_back(s);
+        }
+        events_++;
+    }
+    uint32_t events() const { return events_; }
+
+    // An event is dropped on a channel when its RMS exceeds 1.5x the median event RMS (+0.5 ADC)
+    // or its mean is further than max(1, median RMS) from the median event mean.
+    void finish(PedestalCal& cal) const {
+        cal.events = events_;
+        for(int c=0;c<8;++c){
+            const auto& v = ev_[c];
+            cal.mean[c] = cal.rms[c] = 0; cal.used[c] = 0;
+            if(v.empty()) continue;
+            std::vector<double> m(v.size()), r(v.size());
+            for(size_t i=0;i<v.size();++i){ m[i] = mean_(v[i]); r[i] = rms_(v[i]); }
+            const double mMed = median_(m), rMed = median_(r);
+            const double rMax = 1.5*rMed + 0.5, mTol = std::max(1.0, rMed);
+            uint64_t n = 0, sum = 0, sq = 0;
+            for(size_t i=0;i<v.size();++i){
+                if(rms_(v[i]) > rMax || std::fabs(mean_(v[i]) - mMed) > mTol) continue;
+                n += v[i].n; sum += v[i].sum; sq += v[i].sq; cal.used[c]++;
+            }
+            if(!n) continue;
+            const double mean = double(sum)/n;
+            cal.mean[c] = (float)mean;
+            cal.rms[c]  = (float)std::sqrt(std::max(0.0, double(sq)/n - mean*mean));
+        }
+    }
+
+private:
+    struct Sums { uint64_t sum = 0, sq = 0; uint32_t n = 0; };
+    static double mean_(const Sums& s){ return s.n ? double(s.sum)/s.n : 0.0; }
+    static double rms_(const Sums& s){ const double m = mean_(s); return s.n ? std::sqrt(std::max(0.0, double(s.sq)/s.n - m*m)) : 0.0; }
+    static double median_(std::vector<double> v){
+        std::nth_element(v.begin(), v.begin()+v.size()/2, v.end());
+        return v[v.size()/2];
+    }
+    std::vector<Sums> ev_[8];
+    uint32_t events_ = 0;
+};
+
+// Measures with only the SW trigger armed (self/external triggers must be off): all 8 channels
+// are enabled for the duration, triggers go out in bursts and are read back until 'events' are
+// in or timeoutMs passes, then the enable mask is restored. The SW trigger is left in ACQ_ONLY.
+inline CAEN_DGTZ_ErrorCode calibrate_pedestals(int handle, BoardWriter& bw, uint32_t enMask, uint32_t events,
+                                               PedestalCal& cal, uint32_t timeoutMs = 2000){
+    CAEN_DGTZ_ErrorCode ec;
+    char* buf = nullptr; uint32_t cap = 0;
+    if((ec = bw.enable_mask(0xFF)) != CAEN_DGTZ_Success) return ec;
+    if((ec = bw.sw_trigger(CAEN_DGTZ_TRGMODE_ACQ_ONLY)) != CAEN_DGTZ_Success) return ec;
+    if((ec = CAEN_DGTZ_MallocReadoutBuffer(handle, &buf, &cap)) != CAEN_DGTZ_Success) return ec;
+    PedestalAccumulator acc;
+    ec = CAEN_DGTZ_ClearData(handle);
+    if(ec == CAEN_DGTZ_Success) ec = CAEN_DGTZ_SWStartAcquisition(handle);
+    const auto t0 = std::chrono::steady_clock::now();
+    while(ec == CAEN_DGTZ_Success && acc.events() < events){
+        if(std::chrono::steady_clock::now() - t0 > std::chrono::milliseconds(timeoutMs)) break;
+        const uint32_t burst = std::min<uint32_t>(32, events - acc.events());
+        for(uint32_t i=0;i<burst && ec==CAEN_DGTZ_Success;++i) ec = CAEN_DGTZ_SendSWtrigger(handle);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        uint32_t bsz = 0;
+        if(ec == CAEN_DGTZ_Success) ec = CAEN_DGTZ_ReadData(handle, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT, buf, &bsz);
+        if(ec == CAEN_DGTZ_Success)
+            x730_for_each(buf, bsz, [&](const X730Event& xe){ if(acc.events() < events) acc.add(xe); });
+    }
+    const CAEN_DGTZ_ErrorCode stop = CAEN_DGTZ_SWStopAcquisition(handle);
+    if(ec == CAEN_DGTZ_Success) ec = stop;
+    if(ec == CAEN_DGTZ_Success) ec = CAEN_DGTZ_ClearData(handle);
+    CAEN_DGTZ_FreeReadoutBuffer(&buf);
+    if(ec == CAEN_DGTZ_Success) ec = bw.enable_mask(enMask);
+    acc.finish(cal);
+    return ec;
+}
+
+// --- cache ---
+constexpr uint32_t kPedCacheMagic = 0x44455058; // "XPED"
+constexpr uint32_t kPedCacheVersion = 1;
+struct PedCacheHeader { uint32_t magic = kPedCacheMagic, version = kPedCacheVersion, size = sizeof(PedestalCal), reserved = 0; };
+
+// Temperature bucket: hottest readable channel (C) / step; -1 when none reads.
+inline int32_t ped_temp_bucket(const std::vector<uint32_t>& temps, uint32_t stepC){
+    int64_t hot = -1;
+    for(uint32_t t : temps) if(t < 200) hot = std::max<int64_t>(hot, t);
+    return hot < 0 ? -1 : (int32_t)(hot / std::max<uint32_t>(1, stepC));
+}
+
+inline std::string pedestal_cache_path(const std::string& dir, uint32_t serial, uint32_t dcOffset, int32_t bucket){
+    char name[96];
+    snprintf(name, sizeof(name), "/ped_%u_%04x_t%d.cal", serial, dcOffset, bucket);
+    return dir + name;
+}
+
+inline bool load_pedestal_cache(const std::string& path, PedestalCal& cal){
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+    PedCacheHeader h;
+    const bool okRead = fread(&h, sizeof(h), 1, f)==1 && fread(&cal, sizeof(cal), 1, f)==1;
+    fclose(f);
+    return okRead && h.magic==kPedCacheMagic && h.version==kPedCacheVersion && h.size==sizeof(PedestalCal);
+}
+
+// Temp file + rename, as for the board config cache.
+inline bool save_pedestal_cache(const std::string& path, const PedestalCal& cal){
+    const std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f) return false;
+    PedCacheHeader h;
+    bool okWrite = fwrite(&h, sizeof(h), 1, f)==1 && fwrite(&cal, sizeof(cal), 1, f)==1;
+    okWrite = (fclose(f)==0) && okWrite;
+    if(!okWrite || rename(tmp.c_str(), path.c_str())!=0){ unlink(tmp.c_str()); return false; }
+    return true;
+}
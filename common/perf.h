@@ -0,0 +1,99 @@
+// Low-overhead instrumentation for the acquisition hot path.
+// LogHist is an HDR-style log-linear histogram: exact below 16, then 16 sub-buckets per power
+// of two (<= 6.25% relative error), so recording is a clz and an increment and percentiles of
+// latencies from ns to minutes (or sizes from bytes to GB) come from one fixed 8 KB array.
+// Each histogram is recorded by one thread and read only after that thread has joined.
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+inline uint64_t perf_now_ns(){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class alignas(64) LogHist { // own cache lines: histograms of different threads sit side by side
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr int kSub     = 1 << kSubBits;
+    static constexpr int kBins    = (64 - kSubBits + 1) * kSub;
+
+    static int bin(uint64_t v){
+        if(v < (uint64_t)kSub) return (int)v;
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - kSubBits;
+        return (shift + 1) * kSub + (int)((v >> shift) & (kSub - 1));
+    }
+    static uint64_t bin_low(int i){
+        if(i < kSub) return (uint64_t)i;
+        const int shift = i / kSub - 1;
+        return (uint64_t)(kSub + i % kSub) << shift;
+    }
+    static uint64_t bin_high(int i){ return i < kSub ? (uint64_t)i : bin_low(i) + (1ull << (i / kSub - 1)) - 1; }
+
+    void record(uint64_t v){
+        counts_[bin(v)]++;
+        n_++; sum_ += v;
+        if(v < min_) min_ = v;
+        if(v > max_) max_ = v;
+    }
+
+    uint64_t count() const { return n_; }
+    uint64_t min() const { return n_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double   mean() const { return n_ ? double(sum_) / n_ : 0.0; }
+    // Value at quantile q (0..1): midpoint of the bin holding it, clamped to the observed range.
+    double percentile(double q) const {
+        if(!n_) return 0.0;
+        const uint64_t rank = (uint64_t)std::max(1.0, q * n_ + 0.5);
+        uint64_t seen = 0;
+        for(int i=0;i<kBins;++i){
+            seen += counts_[i];
+            if(seen >= rank){
+                const double mid = 0.5 * (double(bin_low(i)) + double(bin_high(i)));
+                return std::min(std::max(mid, double(min_)), double(max_));
+            }
+        }
+        return double(max_);
+    }
+
+private:
+    uint64_t counts_[kBins] = {};
+    uint64_t n_ = 0, sum_ = 0, min_ = UINT64_MAX, max_ = 0;
+};
+
+// Summary of one histogram, laid out for a TTree branch with kPerfLeaves.
+struct PerfRow { double count=0, mean=0, p50=0, p90=0, p99=0, p999=0, max=0; };
+constexpr const char* kPerfLeaves = "count/D:mean/D:p50/D:p90/D:p99/D:p999/D:max/D";
+inline PerfRow perf_row(const LogHist& h){
+    PerfRow r;
+    r.count = double(h.count()); r.mean = h.mean();
+    r.p50 = h.percentile(0.5); r.p90 = h.percentile(0.9); r.p99 = h.percentile(0.99); r.p999 = h.percentile(0.999);
+    r.max = double(h.max());
+    return r;
+}
+
+// Scoped timer: records the elapsed ns into a histogram when it goes out of scope.
+struct ScopedNs {
+    LogHist& h;
+    uint64_t t0 = perf_now_ns();
+    ~ScopedNs(){ h.record(perf_now_ns() - t0); }
+};
+
+// Tag values and measurement names escape ',', ' ' and '=' in line protocol.
+inline std::string lp_escape(const std::string& v){
+    std::string r;
+    for(char c : v){ if(c==',' || c==' ' || c=='=') r += '\\'; r += c; }
+    return r;
+}
+
+// Appends ",name=value" fields to an Influx line-protocol record (same layout as read_temp_influx).
+inline void lp_field(std::string& fields, const char* name, double v){
+    char b[96];
+    snprintf(b, sizeof(b), "%s%s=%.6g", fields.empty() ? "" : ",", name, v);
+    fields += b;
+}
@@ -0,0 +1,179 @@
+// Append-only raw dump of undecoded readout blocks (--raw).
+// Layout: RawFileHeader, then per CAEN_DGTZ_ReadData call a RawBlockHeader followed by
+// exactly 'bytes' bytes of the block as returned by the board. Blocks from several
+// runs can follow each other; each run starts with its own RawFileHeader.
+
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+constexpr uint32_t kRawFileMagic  = 0x57523758; // "X7RW"
+constexpr uint32_t kRawBlockMagic = 0xB10CB10C;
+constexpr uint32_t kRawVersion    = 1;
+
+#pragma pack(push, 1)
+struct RawFileHeader {
+    uint32_t magic = kRawFileMagic;
+    uint32_t version = kRawVersion;
+    uint32_t headerBytes = sizeof(RawFileHeader);
+    uint32_t serial = 0;
+    uint32_t modelId = 0;      // CAEN_DGTZ_BoardInfo_t::Model
+    char     model[12] = {};
+    char     rocFw[20] = {};
+    char     amcFw[40] = {};
+    uint32_t channels = 0;
+    uint32_t adcBits = 0;
+    // acquisition parameters (mirrors runinfo)
+    int32_t  N = 0, ch = 0, recLen = 0, post = 0;
+    uint32_t delta = 0, ped = 0, thrAbs = 0, pairMask = 0, enMask = 0, saveMask = 0;
+    uint32_t reserved = 0;
+    char     trig[8] = {};
+    char     tag[32] = {};
+    uint64_t startWallNs = 0;
+};
+
+struct RawBlockHeader {
+    uint32_t magic = kRawBlockMagic;
+    uint32_t bytes = 0;        // payload length
+    uint64_t wallNs = 0;       // CLOCK_REALTIME when ReadData returned
+    uint32_t seq = 0;          // block number within the run
+    uint32_t nev = 0;          // events in the block
+    uint32_t serial = 0;       // board serial (CAEN_DGTZ_BoardInfo_t::SerialNumber)
+    uint16_t model = 0;        // CAEN_DGTZ_BoardInfo_t::Model
+    uint8_t  channels = 0;
+    uint8_t  adcBits = 0;
+};
+#pragma pack(pop)
+static_assert(sizeof(RawBlockHeader) == 32, "raw block header layout");
+static_assert(sizeof(RawFileHeader) % 8 == 0, "keeps block payloads 32-bit aligned");
+
+inline uint64_t wall_ns(){
+    timespec ts{}; clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Writes header + block with one writev straight from the readout buffer (no staging copy).
+class RawWriter {
+public:
+    ~RawWriter(){ close(); }
+
+    bool open(const std::string& path, const RawFileHeader& fh){
+        fd_ = ::open(path.c_str(), O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+        if(fd_ < 0){ fprintf(stderr,"[warn] cannot open raw file '%s' (errno=%d)\n", path.c_str(), errno); return false; }
+        hdr_.serial = fh.serial;
+        hdr_.model = (uint16_t)fh.modelId;
+        hdr_.channels = (uint8_t)fh.channels;
+        hdr_.adcBits = (uint8_t)fh.adcBits;
+        return write_all_(&fh, sizeof(fh), nullptr, 0);
+    }
+
+    bool append(const char* buf, uint32_t bytes, uint32_t nev){
+        if(fd_ < 0) return false;
+        hdr_.bytes = bytes;
+        hdr_.wallNs = wall_ns();
+        hdr_.nev = nev;
+        bool ok = write_all_(&hdr_, sizeof(hdr_), buf, bytes);
+        hdr_.seq++;
+        written_ += sizeof(hdr_) + bytes;
+        // Start writeback early so dirty pages do not pile up and stall a later write.
+        if(written_ - flushed_ >= (64u<<20)){
+            sync_file_range(fd_, (off64_t)flushed_, 0, SYNC_FILE_RANGE_WRITE);
+            flushed_ = written_;
+        }
+        return ok;
+    }
+
+    void close(){
+        if(fd_ < 0) return;
+        fsync(fd_);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    uint64_t bytes_written() const { return written_; }
+
+private:
+    bool write_all_(const void* a, size_t na, const void* b, size_t nb){
+        iovec iov[2] = {{const_cast<void*>(a), na}, {const_cast<void*>(b), nb}};
+        int cnt = nb ? 2 : 1;
+        iovec* v = iov;
+        while(cnt > 0){
+            ssize_t w = ::writev(fd_, v, cnt);
+            if(w < 0){
+                if(errno == EINTR) continue;
+                fprintf(stderr,"[warn] raw write failed (errno=%d)\n", errno);
+                return false;
+            }
+            while(cnt > 0 && (size_t)w >= v->iov_len){ w -= (ssize_t)v->iov_len; ++v; --cnt; }
+            if(cnt > 0){ v->iov_base = (char*)v->iov_base + w; v->iov_len -= (size_t)w; }
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    RawBlockHeader hdr_;
+    uint64_t written_ = 0, flushed_ = 0;
+};
+
+// Read-only mmap of a raw file.
+class RawMap {
+public:
+    ~RawMap(){ if(base_) munmap(base_, size_); }
+
+    bool open(const std::string& path){
+        int fd = ::open(path.c_str(), O_RDONLY|O_CLOEXEC);
+        if(fd < 0) return false;
+        struct stat st{};
+        if(fstat(fd, &st) != 0 || st.st_size == 0){ ::close(fd); return false; }
+        size_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) return false;
+        madvise(p, size_, MADV_SEQUENTIAL);
+        base_ = (char*)p;
+        return true;
+    }
+
+    // Calls onRun(const RawFileHeader&) at each run header and
+    // onBlock(const RawBlockHeader&, const char* payload) for each block.
+    // Returns false if the file is truncated or corrupt (records up to that point are delivered).
+    template <class OnRun, class OnBlock>
+    bool walk(OnRun&& onRun, OnBlock&& onBlock) const {
+        size_t off = 0;
+        while(off + sizeof(uint32_t) <= size_){
+            uint32_t magic; std::memcpy(&magic, base_+off, sizeof(magic));
+            if(magic == kRawFileMagic){
+                if(off + sizeof(RawFileHeader) > size_) return false;
+                RawFileHeader fh; std::memcpy(&fh, base_+off, sizeof(fh));
+                onRun(fh);
+                off += fh.headerBytes ? fh.headerBytes : sizeof(fh);
+            } else if(magic == kRawBlockMagic){
+                if(off + sizeof(RawBlockHeader) > size_) return false;
+                RawBlockHeader bh; std::memcpy(&bh, base_+off, sizeof(bh));
+                off += sizeof(bh);
+                if(off + bh.bytes > size_) return false;
+                onBlock(bh, base_+off);
+                off += bh.bytes;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    char*  base_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,64 @@
+// Per-run trigger clock: 64-bit event times from the X730 trigger time tag (8 ns ticks, 31 bits,
+// rollover every 17.18 s) and the live-time bookkeeping that follows from them.
+//
+// Events are fed in readout order with their EventCounter. The board counts every trigger
+// (Acquisition Control bit 3), so a counter gap is triggers lost while busy. Over the span
+// between the first and last stored event:
+//   trigger rate = triggers / span,   live = span * stored / triggers,   dead = span - live
+// Inter-arrival times of the stored events go into a log-binned histogram, kIaPerDecade bins
+// per decade from 1 ns; the last bin also takes everything above 10 s.
+
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+#include "common/x730.h"
+
+struct RunClock {
+    static constexpr int kIaPerDecade = 10;
+    static constexpr int kIaBins      = 10 * kIaPerDecade;   // 1 ns .. 10 s
+
+    X730TimeUnwrap unwrap;
+    uint64_t events = 0, gaps = 0;
+    uint64_t firstNs = 0, lastNs = 0;
+    uint64_t iaMinNs = 0;
+    uint32_t lastCnt = 0;
+    uint32_t ia[kIaBins] = {};
+
+    // Returns the event time in ns since the board's acquisition start. hintNs: a monotonic
+    // clock at readout (e.g. perf_now_ns()) so quiet periods longer than one rollover still unwrap.
+    uint64_t add(uint32_t counter, uint32_t ttt, uint64_t hintNs = 0){
+        return add_ns(counter, unwrap.ns(ttt, hintNs));
+    }
+    // Same bookkeeping for an event whose time is already unwrapped (e.g. one output file's share of a run).
+    uint64_t add_ns(uint32_t counter, uint64_t t){
+        if(events){
+            gaps += (counter - lastCnt - 1) & 0xFFFFFFu;       // 24-bit counter
+            const uint64_t dt = t > lastNs ? t - lastNs : 0;
+            ia[ia_bin(dt)]++;
+            if(events==1 || dt < iaMinNs) iaMinNs = dt;
+        } else firstNs = t;
+        lastNs = t; lastCnt = counter;
+        events++;
+        return t;
+    }
+
+    static int ia_bin(uint64_t dtNs){
+        if(dtNs <= 1) return 0;
+        const int b = (int)(kIaPerDecade * std::log10((double)dtNs));
+        return b < kIaBins ? b : kIaBins-1;
+    }
+    // lower edge of bin b in ns
+    static double ia_edge(int b){ return std::pow(10.0, double(b)/kIaPerDecade); }
+
+    uint64_t triggers()   const { return events + gaps; }
+    uint32_t wraps()      const { return (uint32_t)unwrap.wraps; }
+    double span_s()       const { return events>1 ? (lastNs - firstNs)*1e-9 : 0.0; }
+    double dead_frac()    const { return triggers() ? double(gaps)/triggers() : 0.0; }
+    double live_s()       const { return span_s() * (1.0 - dead_frac()); }
+    double dead_s()       const { return span_s() - live_s(); }
+    // rates over the span: the first event opens it, so it is not counted
+    double trigger_rate() const { return span_s()>0 ? (triggers()-1)/span_s() : 0.0; }
+    double stored_rate()  const { return span_s()>0 ? (events-1)/span_s() : 0.0; }
+    double ia_mean_ns()   const { return events>1 ? double(lastNs - firstNs)/(events-1) : 0.0; }
+};
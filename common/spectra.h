@@ -0,0 +1,160 @@
+// Online charge and pulse-shape (PSD) spectra for negative pulses.
+//   gates   : start 'pre' samples before the peak; short = [start, start+shortLen),
+//             long = [start, start+longLen); integrals of (baseline - sample) in ADC x samples
+//   psd     : tail/total = (Qlong - Qshort) / Qlong
+// Histograms are counter arrays owned by one filling thread each (SpectraShard, cache-line
+// aligned and padded so shards never share a line). The owner increments with a relaxed load +
+// store (a plain add, no lock prefix); anyone may read with relaxed loads, so snapshots are taken
+// while the owner keeps filling and shards are merged without locks. Bin 0 / n+1 are under- and
+// overflow, as in ROOT.
+// Figure of merit per channel from the merged PSD projection above a charge cut: Otsu's
+// threshold splits it in two populations, FOM = |m2 - m1| / (2.355 (s1 + s2)).
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct PsdGates { uint32_t pre = 8, shortLen = 20, longLen = 100; };
+
+inline void psd_integrals(const uint16_t* s, uint32_t ns, float baseline, uint32_t peak, const PsdGates& g,
+                          float& qShort, float& qLong){
+    const uint32_t start = peak > g.pre ? peak - g.pre : 0;
+    const uint32_t endS = std::min(ns, start + g.shortLen), endL = std::min(ns, start + g.longLen);
+    uint64_t sumS = 0, sumL = 0;
+    for(uint32_t i=start;i<endS;++i) sumS += s[i];
+    sumL = sumS;
+    for(uint32_t i=endS;i<endL;++i) sumL += s[i];
+    qShort = (float)(double(baseline)*(endS > start ? endS - start : 0) - double(sumS));
+    qLong  = (float)(double(baseline)*(endL > start ? endL - start : 0) - double(sumL));
+}
+
+struct SpectraAxes {
+    int    qBins = 1024;      // 1D charge spectrum
+    double qMax  = 100000;    // ADC x samples (long gate)
+    int    q2Bins = 256;      // charge axis of the 2D PSD histogram
+    int    psdBins = 128;     // tail/total over [0, 1)
+};
+
+class SpectraShard {
+public:
+    SpectraShard(const SpectraAxes& ax, uint32_t chMask) : ax_(ax) {
+        n1_ = ax.qBins + 2; n2_ = (ax.q2Bins + 2) * (ax.psdBins + 2);
+        for(int c=0;c<8;++c) if((chMask>>c)&1){ off1_[c] = (int64_t)words_; words_ += n1_; off2_[c] = (int64_t)words_; words_ += n2_; }
+        lines_.reset(new Line[(words_ + kPerLine - 1) / kPerLine]()); // zeroed, 64-byte aligned
+    }
+
+    void fill(int ch, float qLong, float qShort){
+        if(off1_[ch] < 0) return;
+        const int b1 = bin_(qLong, ax_.qMax, ax_.qBins);
+        const int bq = bin_(qLong, ax_.qMax, ax_.q2Bins);
+        const int bp = bin_(qLong > 0 ? (qLong - qShort) / qLong : -1.0, 1.0, ax_.psdBins);
+        inc_(off1_[ch] + b1);
+        inc_(off2_[ch] + (int64_t)bp * (ax_.q2Bins + 2) + bq);
+    }
+
+    uint32_t get(int64_t i) const { return lines_[i / kPerLine].c[i % kPerLine].load(std::memory_order_relaxed); }
+    int64_t off1(int ch) const { return off1_[ch]; }
+    int64_t off2(int ch) const { return off2_[ch]; }
+
+private:
+    static constexpr int kPerLine = 16;
+    struct alignas(64) Line { std::atomic<uint32_t> c[kPerLine]; };
+
+    static int bin_(double v, double max, int n){
+        if(v < 0) return 0;
+        if(v >= max) return n + 1;
+        return 1 + (int)(v / max * n);
+    }
+    void inc_(int64_t i){
+        auto& a = lines_[i / kPerLine].c[i % kPerLine];
+        a.store(a.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    SpectraAxes ax_;
+    int64_t off1_[8] = {-1,-1,-1,-1,-1,-1,-1,-1}, off2_[8] = {-1,-1,-1,-1,-1,-1,-1,-1};
+    size_t words_ = 0, n1_ = 0, n2_ = 0;
+    std::unique_ptr<Line[]> lines_;
+};
+
+struct PsdFom { double fom = 0, cut = 0, m1 = 0, s1 = 0, m2 = 0, s2 = 0; uint64_t n1 = 0, n2 = 0; };
+
+// All shards of a run; snapshot() sums them (relaxed loads) into plain per-channel arrays.
+class Spectra {
+public:
+    Spectra(const SpectraAxes& ax, uint32_t chMask, int threads) : ax_(ax), mask_(chMask & 0xFF) {
+        for(int t=0;t<threads;++t) shards_.emplace_back(new SpectraShard(ax, mask_));
+        for(int c=0;c<8;++c) if((mask_>>c)&1){ q_[c].assign(ax.qBins + 2, 0); psd_[c].assign((ax.q2Bins + 2) * (ax.psdBins + 2), 0); }
+    }
+    SpectraShard& shard(int t){ return *shards_[t]; }
+    const SpectraAxes& axes() const { return ax_; }
+    uint32_t mask() const { return mask_; }
+
+    void snapshot(){
+        for(int c=0;c<8;++c){
+            if(!((mask_>>c)&1)) continue;
+            for(size_t i=0;i<q_[c].size();++i){
+                uint64_t v = 0;
+                for(auto& s : shards_) v += s->get(s->off1(c) + (int64_t)i);
+                q_[c][i] = v;
+            }
+            for(size_t i=0;i<psd_[c].size();++i){
+                uint64_t v = 0;
+                for(auto& s : shards_) v += s->get(s->off2(c) + (int64_t)i);
+                psd_[c][i] = v;
+            }
+        }
+    }
+    // From the last snapshot; bins include under/overflow (index 0 and n+1).
+    const std::vector<uint64_t>& charge(int ch) const { return q_[ch]; }
+    uint64_t psd_bin(int ch, int qb, int pb) const { return psd_[ch][(size_t)pb * (ax_.q2Bins + 2) + qb]; }
+
+    // PSD figure of merit of channel ch over long-gate charges >= qMin (last snapshot).
+    PsdFom fom(int ch, double qMin) const {
+        PsdFom r;
+        if(!((mask_>>ch)&1)) return r;
+        const int nq = ax_.q2Bins, np = ax_.psdBins;
+        const int q0 = std::max(1, 1 + (int)(qMin / ax_.qMax * nq));
+        std::vector<double> proj(np, 0.0);
+        double tot = 0, sumAll = 0;
+        for(int pb=1;pb<=np;++pb){
+            double v = 0;
+            for(int qb=q0;qb<=nq;++qb) v += (double)psd_bin(ch, qb, pb);
+            proj[pb-1] = v; tot += v; sumAll += v * center_(pb-1);
+        }
+        if(tot < 20) return r;
+        // Otsu: the split that maximises the between-class variance
+        double w1 = 0, sum1 = 0, best = -1; int cut = 0;
+        for(int k=0;k<np-1;++k){
+            w1 += proj[k]; sum1 += proj[k] * center_(k);
+            const double w2 = tot - w1;
+            if(w1 <= 0 || w2 <= 0) continue;
+            const double d = sum1/w1 - (sumAll - sum1)/w2;
+            const double between = w1 * w2 * d * d;
+            if(between > best){ best = between; cut = k; }
+        }
+        auto moments = [&](int lo, int hi, double& m, double& s, uint64_t& n){
+            double w = 0, a = 0, b = 0;
+            for(int k=lo;k<=hi;++k){ const double x = center_(k); w += proj[k]; a += proj[k]*x; b += proj[k]*x*x; }
+            n = (uint64_t)w;
+            if(w <= 0) return;
+            const double bw = 1.0 / ax_.psdBins;    // + binning variance, so one-bin peaks stay finite
+            m = a/w; s = std::sqrt(std::max(0.0, b/w - m*m) + bw*bw/12);
+        };
+        moments(0, cut, r.m1, r.s1, r.n1);
+        moments(cut+1, np-1, r.m2, r.s2, r.n2);
+        r.cut = (cut + 1.0) / np;
+        if(r.n1 >= 10 && r.n2 >= 10 && r.s1 + r.s2 > 0) r.fom = std::fabs(r.m2 - r.m1) / (2.355 * (r.s1 + r.s2));
+        return r;
+    }
+
+private:
+    double center_(int k) const { return (k + 0.5) / ax_.psdBins; }
+    SpectraAxes ax_;
+    uint32_t mask_;
+    std::vector<std::unique_ptr<SpectraShard>> shards_;
+    std::vector<uint64_t> q_[8], psd_[8];
+};
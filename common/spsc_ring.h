@@ -0,0 +1,68 @@
+// Bounded lock-free single-producer/single-consumer ring.
+// Capacity is rounded up to a power of two; one thread may push, one may pop.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity){
+        size_t c = 1;
+        while(c < capacity) c <<= 1;
+        slots_.resize(c);
+        mask_ = c - 1;
+    }
+
+    bool try_push(const T& v){
+        const size_t h = head_.load(std::memory_order_relaxed);
+        if(h - tail_cache_ > mask_){
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if(h - tail_cache_ > mask_) return false;
+        }
+        slots_[h & mask_] = v;
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& v){
+        const size_t t = tail_.load(std::memory_order_relaxed);
+        if(t == head_cache_){
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if(t == head_cache_) return false;
+        }
+        v = slots_[t & mask_];
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate; exact only when called from producer or consumer with the other idle.
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0;                  // producer-side copy of tail_
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0;                  // consumer-side copy of head_
+};
+
+// Spin briefly, then yield, then sleep: for stages waiting on an empty/full ring.
+struct Backoff {
+    unsigned n = 0;
+    void wait(){
+        if(n < 64)       { ++n; }
+        else if(n < 128) { ++n; std::this_thread::yield(); }
+        else             { std::this_thread::sleep_for(std::chrono::microseconds(50)); }
+    }
+    void reset(){ n = 0; }
+};
@@ -0,0 +1,204 @@
+// Text waveform output (--txt / --txtdir) off the write path.
+// The caller copies each event's samples into a pooled binary batch (a memcpy); a background
+// thread formats full batches with std::to_chars into one large buffer and hands it to the
+// kernel in big write() calls. Output is byte-identical to the old per-sample ofstream code:
+//   # Event <idx>  tag=<tag>  trig=<trig>  ch=<c>  size=<n>  cnt=<cnt>  ttag=<ttt>
+//   <sample>      (n lines)
+//   <empty line>
+// --txtdir writes waveform_<idx>.txt per event, or with eventsPerFile>1 one file per chunk of
+// events, waveform_<first>-<last>.txt. Files are opened in append mode as before.
+
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "common/spsc_ring.h"
+
+class TextWriter {
+public:
+    static constexpr size_t kBatchBytes = 1u << 20;  // binary samples per hand-off
+    static constexpr int    kBatches    = 4;
+    static constexpr size_t kTextBytes  = 4u << 20;  // formatted text per write()
+
+    TextWriter() : free_(kBatches), full_(kBatches) {}
+    ~TextWriter(){ close(); }
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator=(const TextWriter&) = delete;
+
+    // file: single file (append); dir: one file per event/chunk. Exactly one of them non-empty.
+    bool open(const std::string& file, const std::string& dir, uint32_t eventsPerFile,
+              const std::string& tag, const std::string& trig){
+        dir_ = dir;
+        perFile_ = eventsPerFile ? eventsPerFile : 1;
+        mid_ = "  tag=" + tag + "  trig=" + trig + "  ch=";
+        if(!file.empty()){
+            fd_ = ::open(file.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if(fd_<0){ fprintf(stderr,"[warn] could not open --txt='%s' for append\n", file.c_str()); return false; }
+        }
+        batches_.resize(kBatches);
+        for(int i=0;i<kBatches;++i){ batches_[i].data.resize(kBatchBytes); free_.try_push(i); }
+        text_.resize(kTextBytes);
+        cur_ = take_();
+        done_ = false;
+        th_ = std::thread([this]{ run_(); });
+        open_ = true;
+        return true;
+    }
+
+    // Copies one event (channels with ns[c]>0) into the current batch; blocks only if all
+    // batches are waiting to be formatted.
+    void add(uint64_t idx, uint32_t cnt, uint32_t ttt, const uint16_t* const wave[8], const uint32_t ns[8]){
+        if(!open_) return;
+        for(int c=0;c<8;++c){
+            if(!ns[c]) continue;
+            const size_t need = sizeof(Rec) + ns[c]*sizeof(uint16_t);
+            Batch* b = &batches_[cur_];
+            if(b->used + need > b->data.size()){
+                if(b->used){ full_push_(cur_); cur_ = take_(); b = &batches_[cur_]; }
+                if(need > b->data.size()) b->data.resize(need); // record longer than a batch: grow once
+            }
+            Rec r{idx, cnt, ttt, (uint32_t)c, ns[c]};
+            std::memcpy(b->data.data()+b->used, &r, sizeof(r));
+            std::memcpy(b->data.data()+b->used+sizeof(r), wave[c], ns[c]*sizeof(uint16_t));
+            b->used += need;
+        }
+    }
+
+    // Flushes everything, joins the thread and closes the files.
+    void close(){
+        if(!open_) return;
+        if(batches_[cur_].used) full_push_(cur_);
+        done_ = true;
+        th_.join();
+        flush_();
+        if(fd_>=0) ::close(fd_);
+        fd_ = -1;
+        open_ = false;
+    }
+
+    uint64_t bytes_written() const { return written_; }
+    uint64_t files_opened() const { return files_; }
+
+private:
+    struct Rec { uint64_t idx; uint32_t cnt, ttt, ch, ns; };
+    struct Batch { std::vector<char> data; size_t used = 0; };
+
+    uint32_t take_(){
+        uint32_t i;
+        Backoff bo;
+        while(!free_.try_pop(i)) bo.wait();
+        batches_[i].used = 0;
+        return i;
+    }
+    void full_push_(uint32_t i){ full_.try_push(i); } // cannot fail: ring holds every batch
+
+    void run_(){
+        Backoff bo;
+        for(;;){
+            uint32_t i;
+            if(!full_.try_pop(i)){
+                if(done_ && full_.size()==0) break;
+                bo.wait(); continue;
+            }
+            bo.reset();
+            format_(batches_[i]);
+            free_.try_push(i);
+        }
+    }
+
+    void format_(const Batch& b){
+        size_t off = 0;
+        while(off < b.used){
+            Rec r;
+            std::memcpy(&r, b.data.data()+off, sizeof(r));
+            const uint16_t* s = (const uint16_t*)(b.data.data()+off+sizeof(r));
+            off += sizeof(r) + r.ns*sizeof(uint16_t);
+            if(!dir_.empty()) select_file_(r.idx);
+            if(fd_<0) continue;
+            const size_t worst = 192 + mid_.size() + (size_t)r.ns*6 + 1;
+            if(tlen_ + worst > text_.size()){
+                flush_();
+                if(worst > text_.size()) text_.resize(worst);
+            }
+            char* p = text_.data() + tlen_;
+            char* const end = text_.data() + text_.size();
+            p = put_("# Event ", p);
+            p = std::to_chars(p, end, r.idx).ptr;
+            p = put_(mid_, p);
+            p = std::to_chars(p, end, r.ch).ptr;
+            p = put_("  size=", p);
+            p = std::to_chars(p, end, r.ns).ptr;
+            p = put_("  cnt=", p);
+            p = std::to_chars(p, end, r.cnt).ptr;
+            p = put_("  ttag=", p);
+            p = std::to_chars(p, end, r.ttt).ptr;
+            *p++ = '\n';
+            for(uint32_t k=0;k<r.ns;++k){
+                p = std::to_chars(p, end, s[k]).ptr;
+                *p++ = '\n';
+            }
+            *p++ = '\n';
+            tlen_ = (size_t)(p - text_.data());
+        }
+        if(tlen_ >= text_.size()/2) flush_();
+    }
+
+    static char* put_(const char* lit, char* p){ const size_t n = std::strlen(lit); std::memcpy(p, lit, n); return p+n; }
+    static char* put_(const std::string& s, char* p){ std::memcpy(p, s.data(), s.size()); return p+s.size(); }
+
+    // --txtdir: switch files when the event leaves the current chunk (events arrive in order).
+    void select_file_(uint64_t idx){
+        const uint64_t key = idx / perFile_;
+        if(key==fileKey_ && (fd_>=0 || failedKey_)) return;
+        flush_();
+        if(fd_>=0) ::close(fd_);
+        fileKey_ = key; failedKey_ = false;
+        char path[512];
+        if(perFile_==1) snprintf(path, sizeof(path), "%s/waveform_%llu.txt", dir_.c_str(), (unsigned long long)idx);
+        else snprintf(path, sizeof(path), "%s/waveform_%llu-%llu.txt", dir_.c_str(),
+                      (unsigned long long)(key*perFile_), (unsigned long long)(key*perFile_ + perFile_ - 1));
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if(fd_<0){ fprintf(stderr,"[warn] cannot write '%s'\n", path); failedKey_ = true; }
+        else files_++;
+    }
+
+    void flush_(){
+        size_t off = 0;
+        while(fd_>=0 && off < tlen_){
+            const ssize_t w = ::write(fd_, text_.data()+off, tlen_-off);
+            if(w<0){
+                if(errno==EINTR) continue;
+                if(!writeErr_) fprintf(stderr,"[warn] text output write failed: %s\n", strerror(errno));
+                writeErr_ = true;
+                break;
+            }
+            off += (size_t)w;
+            written_ += (uint64_t)w;
+        }
+        tlen_ = 0;
+    }
+
+    std::string dir_, mid_;
+    uint32_t perFile_ = 1;
+    int fd_ = -1;
+    uint64_t fileKey_ = UINT64_MAX;
+    bool failedKey_ = false, writeErr_ = false, open_ = false;
+    std::vector<Batch> batches_;
+    SpscRing<uint32_t> free_, full_;
+    uint32_t cur_ = 0;
+    std::vector<char> text_;
+    size_t tlen_ = 0;
+    std::atomic<bool> done_{false};
+    std::thread th_;
+    uint64_t written_ = 0, files_ = 0;
+};
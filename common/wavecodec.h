@@ -0,0 +1,319 @@
+// Lossless codec for uint16 sample arrays (14-bit ADC waveforms on a flat baseline).
+//   delta   : d[i] = s[i] - s[i-1] (mod 2^16), d[0] = 0
+//   zigzag  : z = (d << 1) ^ (d >> 15), so small +/- steps become small unsigned values
+//   packing : blocks of 128 z values, each with its own bit width b = bits of the largest z
+// Stream: s[0] as 2 bytes, then per block 1 width byte and 16*b bytes. The block is laid out
+// vertically (BP128-style): lane j (0..7) holds z[j], z[8+j], ... z[120+j], packed LSB-first
+// into b uint16 words at positions j, 8+j, 16+j, ... so one 128-bit register packs or unpacks
+// a row of 8 consecutive samples at a time. The last block is padded with zero deltas.
+// The sample count is not stored: the container (branch, record length) knows it.
+// Kernels below give byte-identical streams; wc_encode/wc_decode pick the best one once.
+// Assumes a little-endian host (x86, ARM).
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+constexpr uint32_t kWcBlock = 128;
+
+// Upper bound of the encoded size of n samples.
+inline size_t wc_max_bytes(uint32_t n){
+    return n ? 2 + (size_t)((n + kWcBlock - 1) / kWcBlock) * (1 + 2*kWcBlock) : 0;
+}
+
+inline uint32_t wc_width(uint16_t orAll){ return orAll ? 32 - (uint32_t)__builtin_clz(orAll) : 0; }
+
+// ---- scalar ----
+// Block payloads start at odd offsets (after the width byte): words go through memcpy.
+inline uint16_t wc_ld16(const uint8_t* p){ uint16_t v; std::memcpy(&v, p, 2); return v; }
+inline void wc_st16(uint8_t* p, uint16_t v){ std::memcpy(p, &v, 2); }
+
+// z[0..127] -> b words per lane; returns bytes written.
+inline size_t wc_pack_block_scalar(const uint16_t* z, uint32_t b, uint8_t* out){
+    for(int j=0;j<8;++j){
+        uint32_t acc = 0, shift = 0, k = 0;
+        for(int r=0;r<16;++r){
+            acc |= (uint32_t)z[r*8+j] << shift;
+            shift += b;
+            if(shift >= 16){ wc_st16(out + 2*(k++*8+j), (uint16_t)acc); acc >>= 16; shift -= 16; }
+        }
+    }
+    return 16*(size_t)b;
+}
+
+inline void wc_unpack_block_scalar(const uint8_t* in, uint32_t b, uint16_t* z){
+    const uint32_t mask = (1u << b) - 1;
+    for(int j=0;j<8;++j){
+        uint32_t acc = 0, have = 0, k = 0;
+        for(int r=0;r<16;++r){
+            if(have < b){ acc |= (uint32_t)wc_ld16(in + 2*(k++*8+j)) << have; have += 16; }
+            z[r*8+j] = (uint16_t)(acc & mask);
+            acc >>= b; have -= b;
+        }
+    }
+}
+
+// Zigzag deltas of one block (prev = last sample of the previous block); returns the OR of all z.
+inline uint16_t wc_delta_block_scalar(const uint16_t* s, uint16_t prev, uint16_t* z){
+    uint16_t o = 0;
+    for(uint32_t i=0;i<kWcBlock;++i){
+        const int16_t d = (int16_t)(uint16_t)(s[i] - prev);
+        z[i] = (uint16_t)(((uint16_t)d << 1) ^ (uint16_t)(d >> 15));
+        o |= z[i]; prev = s[i];
+    }
+    return o;
+}
+
+inline uint16_t wc_undelta_block_scalar(const uint16_t* z, uint16_t prev, uint16_t* s){
+    for(uint32_t i=0;i<kWcBlock;++i){
+        const uint16_t d = (uint16_t)((z[i] >> 1) ^ (uint16_t)-(z[i] & 1));
+        prev = (uint16_t)(prev + d);
+        s[i] = prev;
+    }
+    return prev;
+}
+
+// ---- SSE2 ----
+#if defined(__x86_64__)
+inline uint16_t wc_delta_block_sse2(const uint16_t* s, uint16_t prev, uint16_t* z){
+    __m128i p = _mm_cvtsi32_si128(prev), o = _mm_setzero_si128();
+    for(uint32_t i=0;i<kWcBlock;i+=8){
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s+i));
+        const __m128i d = _mm_sub_epi16(v, _mm_or_si128(_mm_slli_si128(v, 2), p));
+        const __m128i zz = _mm_xor_si128(_mm_slli_epi16(d, 1), _mm_srai_epi16(d, 15));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(z+i), zz);
+        o = _mm_or_si128(o, zz);
+        p = _mm_srli_si128(v, 14);
+    }
+    o = _mm_or_si128(o, _mm_srli_si128(o, 8));
+    o = _mm_or_si128(o, _mm_srli_si128(o, 4));
+    o = _mm_or_si128(o, _mm_srli_si128(o, 2));
+    return (uint16_t)_mm_cvtsi128_si32(o);
+}
+
+inline uint16_t wc_undelta_block_sse2(const uint16_t* z, uint16_t prev, uint16_t* s){
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i p = _mm_set1_epi16((short)prev);
+    for(uint32_t i=0;i<kWcBlock;i+=8){
+        const __m128i zz = _mm_loadu_si128(reinterpret_cast<const __m128i*>(z+i));
+        __m128i x = _mm_xor_si128(_mm_srli_epi16(zz, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(zz, one)));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 2));     // prefix sum over the 8 lanes
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi16(x, p);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s+i), x);
+        p = _mm_shufflehi_epi16(x, 0xFF);                // broadcast lane 7
+        p = _mm_unpackhi_epi64(p, p);
+    }
+    return (uint16_t)_mm_extract_epi16(p, 0);
+}
+
+template <uint32_t B>
+inline void wc_pack_rows_sse2(const uint16_t* z, uint8_t* out){
+    __m128i* w = reinterpret_cast<__m128i*>(out);
+    __m128i acc = _mm_setzero_si128();
+    uint32_t shift = 0;
+    for(int r=0;r<16;++r){
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(z + r*8));
+        acc = _mm_or_si128(acc, _mm_sll_epi16(v, _mm_cvtsi32_si128((int)shift)));
+        shift += B;
+        if(shift >= 16){
+            _mm_storeu_si128(w++, acc);
+            shift -= 16;
+            acc = shift ? _mm_srl_epi16(v, _mm_cvtsi32_si128((int)(B - shift))) : _mm_setzero_si128();
+        }
+    }
+}
+
+template <uint32_t B>
+inline void wc_unpack_rows_sse2(const uint8_t* in, uint16_t* z){
+    const __m128i* w = reinterpret_cast<const __m128i*>(in);
+    const __m128i mask = _mm_set1_epi16((short)((1u << B) - 1));
+    __m128i cur = _mm_loadu_si128(w);
+    uint32_t shift = 0;
+    for(int r=0;r<16;++r){
+        __m128i v = _mm_srl_epi16(cur, _mm_cvtsi32_si128((int)shift));
+        shift += B;
+        if(shift >= 16){
+            shift -= 16;
+            if(r < 15 || shift) cur = _mm_loadu_si128(++w);
+            if(shift) v = _mm_or_si128(v, _mm_sll_epi16(cur, _mm_cvtsi32_si128((int)(B - shift))));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(z + r*8), _mm_and_si128(v, mask));
+    }
+}
+
+template <uint32_t... B> struct WcSse2Table {
+    static size_t pack(const uint16_t* z, uint32_t b, uint8_t* out){
+        using Fn = void (*)(const uint16_t*, uint8_t*);
+        static constexpr Fn fn[] = { wc_pack_rows_sse2<B>... };
+        fn[b-1](z, out);
+        return 16*(size_t)b;
+    }
+    static void unpack(const uint8_t* in, uint32_t b, uint16_t* z){
+        using Fn = void (*)(const uint8_t*, uint16_t*);
+        static constexpr Fn fn[] = { wc_unpack_rows_sse2<B>... };
+        fn[b-1](in, z);
+    }
+};
+using WcSse2 = WcSse2Table<1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16>;
+
+inline size_t wc_pack_block_sse2(const uint16_t* z, uint32_t b, uint8_t* out){ return b ? WcSse2::pack(z, b, out) : 0; }
+inline void wc_unpack_block_sse2(const uint8_t* in, uint32_t b, uint16_t* z){
+    if(b) WcSse2::unpack(in, b, z); else std::memset(z, 0, kWcBlock*sizeof(uint16_t));
+}
+#endif
+
+// ---- NEON ----
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+inline uint16_t wc_delta_block_neon(const uint16_t* s, uint16_t prev, uint16_t* z){
+    uint16x8_t p = vdupq_n_u16(prev), o = vdupq_n_u16(0);
+    for(uint32_t i=0;i<kWcBlock;i+=8){
+        const uint16x8_t v = vld1q_u16(s+i);
+        const int16x8_t d = vreinterpretq_s16_u16(vsubq_u16(v, vextq_u16(p, v, 7)));
+        const uint16x8_t zz = veorq_u16(vreinterpretq_u16_s16(vshlq_n_s16(d, 1)), vreinterpretq_u16_s16(vshrq_n_s16(d, 15)));
+        vst1q_u16(z+i, zz);
+        o = vorrq_u16(o, zz);
+        p = v;
+    }
+    uint16x4_t h = vorr_u16(vget_low_u16(o), vget_high_u16(o));
+    h = vorr_u16(h, vext_u16(h, h, 2));
+    h = vorr_u16(h, vext_u16(h, h, 1));
+    return vget_lane_u16(h, 0);
+}
+
+inline uint16_t wc_undelta_block_neon(const uint16_t* z, uint16_t prev, uint16_t* s){
+    const uint16x8_t zero = vdupq_n_u16(0), one = vdupq_n_u16(1);
+    uint16x8_t p = vdupq_n_u16(prev);
+    for(uint32_t i=0;i<kWcBlock;i+=8){
+        const uint16x8_t zz = vld1q_u16(z+i);
+        uint16x8_t x = veorq_u16(vshrq_n_u16(zz, 1), vsubq_u16(zero, vandq_u16(zz, one)));
+        x = vaddq_u16(x, vextq_u16(zero, x, 7));       // prefix sum over the 8 lanes
+        x = vaddq_u16(x, vextq_u16(zero, x, 6));
+        x = vaddq_u16(x, vextq_u16(zero, x, 4));
+        x = vaddq_u16(x, p);
+        vst1q_u16(s+i, x);
+        p = vdupq_n_u16(vgetq_lane_u16(x, 7));
+    }
+    return vgetq_lane_u16(p, 0);
+}
+
+inline size_t wc_pack_block_neon(const uint16_t* z, uint32_t b, uint8_t* out){
+    uint16x8_t acc = vdupq_n_u16(0);
+    uint32_t shift = 0;
+    uint8_t* w = out;
+    for(int r=0;r<16 && b;++r){
+        const uint16x8_t v = vld1q_u16(z + r*8);
+        acc = vorrq_u16(acc, vshlq_u16(v, vdupq_n_s16((int16_t)shift)));
+        shift += b;
+        if(shift >= 16){
+            vst1q_u8(w, vreinterpretq_u8_u16(acc)); w += 16;
+            shift -= 16;
+            acc = shift ? vshlq_u16(v, vdupq_n_s16(-(int16_t)(b - shift))) : vdupq_n_u16(0);
+        }
+    }
+    return 16*(size_t)b;
+}
+
+inline void wc_unpack_block_neon(const uint8_t* in, uint32_t b, uint16_t* z){
+    if(!b){ std::memset(z, 0, kWcBlock*sizeof(uint16_t)); return; }
+    const uint8_t* w = in;
+    const uint16x8_t mask = vdupq_n_u16((uint16_t)((1u << b) - 1));
+    uint16x8_t cur = vreinterpretq_u16_u8(vld1q_u8(w));
+    uint32_t shift = 0;
+    for(int r=0;r<16;++r){
+        uint16x8_t v = vshlq_u16(cur, vdupq_n_s16(-(int16_t)shift));
+        shift += b;
+        if(shift >= 16){
+            shift -= 16;
+            if(r < 15 || shift){ w += 16; cur = vreinterpretq_u16_u8(vld1q_u8(w)); }
+            if(shift) v = vorrq_u16(v, vshlq_u16(cur, vdupq_n_s16((int16_t)(b - shift))));
+        }
+        vst1q_u16(z + r*8, vandq_u16(v, mask));
+    }
+}
+#endif
+
+struct WcKernels {
+    const char* name;
+    uint16_t (*delta)(const uint16_t*, uint16_t, uint16_t*);
+    uint16_t (*undelta)(const uint16_t*, uint16_t, uint16_t*);
+    size_t   (*pack)(const uint16_t*, uint32_t, uint8_t*);
+    void     (*unpack)(const uint8_t*, uint32_t, uint16_t*);
+};
+
+inline WcKernels wc_scalar_kernels(){
+    return {"scalar", wc_delta_block_scalar, wc_undelta_block_scalar, wc_pack_block_scalar, wc_unpack_block_scalar};
+}
+
+// Best kernels for this host.
+inline WcKernels wc_best_kernels(){
+#if defined(__x86_64__)
+    return {"sse2", wc_delta_block_sse2, wc_undelta_block_sse2, wc_pack_block_sse2, wc_unpack_block_sse2};
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return {"neon", wc_delta_block_neon, wc_undelta_block_neon, wc_pack_block_neon, wc_unpack_block_neon};
+#else
+    return wc_scalar_kernels();
+#endif
+}
+
+// Encode n samples into out (at least wc_max_bytes(n) bytes); returns the bytes written.
+inline size_t wc_encode_with(const WcKernels& k, const uint16_t* s, uint32_t n, uint8_t* out){
+    if(!n) return 0;
+    alignas(16) uint16_t z[kWcBlock], tail[kWcBlock];
+    std::memcpy(out, &s[0], 2);
+    size_t pos = 2;
+    uint16_t prev = s[0];
+    for(uint32_t i=0;i<n;i+=kWcBlock){
+        const uint16_t* blk = s + i;
+        if(n - i < kWcBlock){                         // pad with the last sample: zero deltas
+            std::memcpy(tail, blk, (n - i)*sizeof(uint16_t));
+            for(uint32_t j=n-i;j<kWcBlock;++j) tail[j] = s[n-1];
+            blk = tail;
+        }
+        const uint32_t b = wc_width(k.delta(blk, prev, z));
+        prev = blk[kWcBlock-1];
+        out[pos++] = (uint8_t)b;
+        pos += k.pack(z, b, out + pos);
+    }
+    return pos;
+}
+
+// Decode n samples; returns the bytes consumed, 0 on a truncated or corrupt stream.
+inline size_t wc_decode_with(const WcKernels& k, const uint8_t* in, size_t bytes, uint16_t* out, uint32_t n){
+    if(!n) return 0;
+    if(bytes < 2) return 0;
+    alignas(16) uint16_t z[kWcBlock], tail[kWcBlock];
+    uint16_t prev;
+    std::memcpy(&prev, in, 2);
+    size_t pos = 2;
+    for(uint32_t i=0;i<n;i+=kWcBlock){
+        if(pos >= bytes) return 0;
+        const uint32_t b = in[pos++];
+        if(b > 16 || pos + 16*(size_t)b > bytes) return 0;
+        k.unpack(in + pos, b, z);
+        pos += 16*(size_t)b;
+        if(n - i >= kWcBlock) prev = k.undelta(z, prev, out + i);
+        else {
+            prev = k.undelta(z, prev, tail);
+            std::memcpy(out + i, tail, (n - i)*sizeof(uint16_t));
+        }
+    }
+    return pos;
+}
+
+inline size_t wc_encode(const uint16_t* s, uint32_t n, uint8_t* out){
+    static const WcKernels k = wc_best_kernels();
+    return wc_encode_with(k, s, n, out);
+}
+
+inline size_t wc_decode(const uint8_t* in, size_t bytes, uint16_t* out, uint32_t n){
+    static const WcKernels k = wc_best_kernels();
+    return wc_decode_with(k, in, bytes, out, n);
+}
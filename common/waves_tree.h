@@ -0,0 +1,270 @@
+// Columnar waveform output: one "waves" TTree per tag directory, one entry per event.
+// Branches: EventCounter/i, TriggerTimeTag/i, t_ns/l (rollover-corrected trigger time, ns since
+// acquisition start), ChannelMask/i and, per saved channel, wave_ch<N>[recLen]/s (fixed-length
+// uint16 samples).
+// Packed layout (packed=true): per saved channel zbytes_ch<N>/i and z_ch<N>[zbytes_ch<N>]/b, the
+// recLen samples encoded with common/wavecodec.h.
+// ZLE layout (zle=true, common/zle.h): per saved channel nseg_ch<N>/i, seg_start_ch<N>[nseg]/i,
+// seg_len_ch<N>[nseg]/i, nroi_ch<N>/i and the regions' samples back to back, roi_ch<N>[nroi]/s
+// (or z_ch<N> when also packed).
+// open()/get() read any layout back into wave[]; recLen of a packed or ZLE tree comes from runinfo.
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <TDirectory.h>
+#include <TLeaf.h>
+#include <TTree.h>
+
+#include "common/wavecodec.h"
+#include "common/zle.h"
+
+// "zstd:5" / "lz4" / "zlib:1" / "lzma:9" -> ROOT compression setting (100*algorithm + level).
+// Returns -1 on an unknown algorithm.
+inline int parse_root_compression(const std::string& spec){
+    std::string alg = spec, lvl;
+    auto colon = spec.find(':');
+    if(colon!=std::string::npos){ alg = spec.substr(0,colon); lvl = spec.substr(colon+1); }
+    int a = -1;
+    if(alg=="zlib") a = 1;
+    else if(alg=="lzma") a = 2;
+    else if(alg=="lz4")  a = 4;
+    else if(alg=="zstd") a = 5;
+    else if(alg=="none") return 0;
+    if(a<0) return -1;
+    int l = lvl.empty() ? (a==4 ? 4 : 5) : std::atoi(lvl.c_str());
+    if(l<0) l=0;
+    if(l>9) l=9;
+    return a*100 + l;
+}
+
+struct WavesTree {
+    static constexpr uint32_t kMaxSeg = 64;   // ZLE regions per channel and event
+
+    TTree*   tree = nullptr;
+    uint32_t recLen = 0;
+    uint32_t saveMask = 0;
+    uint32_t EventCounter = 0, TriggerTimeTag = 0, ChannelMask = 0;
+    unsigned long long TimeNs = 0;
+    std::vector<uint16_t> wave[8];
+    bool     packed = false;                  // samples through common/wavecodec.h
+    bool     zle = false;                     // regions of interest only (common/zle.h)
+    uint32_t zbytes[8] = {};
+    std::vector<uint8_t> z[8];
+    uint32_t nseg[8] = {}, nroi[8] = {};
+    std::vector<uint32_t> segStart[8], segLen[8];
+    std::vector<uint16_t> roi[8];             // the regions' samples, back to back
+    uint16_t fillValue[8] = {};               // ZLE read-back: samples outside the regions (e.g. runinfo ped_mean)
+    uint64_t rawBytes = 0, packedBytes = 0;   // sample bytes in/out of the codec (packed mode)
+    uint64_t recSamples = 0, roiSamples = 0;  // samples offered / kept (ZLE mode)
+
+    // Reuse the tag's existing tree (same layout, same saved channels and, for wave_ch<N>, same
+    // record length) or create a new one. basket<=0 / compress<0 keep ROOT defaults.
+    bool attach(TDirectory* dir, uint32_t recLen_, uint32_t saveMask_, int basket, int compress,
+                bool packed_ = false, bool zle_ = false){
+        recLen = recLen_; saveMask = saveMask_ & 0xFF; packed = packed_; zle = zle_;
+        alloc_();
+        dir->cd();
+        tree = (TTree*)dir->Get("waves");
+        if(tree){
+            for(int c=0;c<8;++c){
+                if(!((saveMask>>c)&1)){
+                    // a channel this run does not save would be filled from a stale address every entry
+                    for(const auto& b : branches_(c)){
+                        if(!tree->GetBranch(b.name.c_str())) continue;
+                        fprintf(stderr,"[warn] existing '%s/waves' also stores ch%d (branch %s), this run saves 0x%02x; not writing the tree\n",
+                                dir->GetName(), c, b.name.c_str(), saveMask);
+                        tree = nullptr;
+                        return false;
+                    }
+                    continue;
+                }
+                for(const auto& b : branches_(c)){
+                    if(!tree->GetBranch(b.name.c_str())){
+                        fprintf(stderr,"[warn] existing '%s/waves' has no branch %s (other layout?); not writing the tree\n",
+                                dir->GetName(), b.name.c_str());
+                        tree = nullptr;
+                        return false;
+                    }
+                    // fixed-length samples: a longer leaf would make Fill read past wave[c], a shorter one truncate
+                    if(packed || zle) continue;
+                    const TLeaf* lf = tree->GetLeaf(b.name.c_str());
+                    if(lf && lf->GetLenStatic() != (int)recLen){
+                        fprintf(stderr,"[warn] existing '%s/waves' stores %d samples per channel, this run %u; not writing the tree\n",
+                                dir->GetName(), lf->GetLenStatic(), recLen);
+                        tree = nullptr;
+                        return false;
+                    }
+                }
+            }
+            bind_(tree);
+            return true;
+        }
+        tree = new TTree("waves", zle ? "waveforms (regions of interest)" : packed ? "waveforms (wavecodec-packed uint16 samples)"
+                                                                          : "waveforms (uint16 samples)");
+        const int bs = basket>0 ? basket : 32000;
+        auto comp = [&](TBranch* br){ if(br && compress>=0) br->SetCompressionSettings(compress); };
+        comp(tree->Branch("EventCounter",   &EventCounter,   "EventCounter/i",   bs));
+        comp(tree->Branch("TriggerTimeTag", &TriggerTimeTag, "TriggerTimeTag/i", bs));
+        comp(tree->Branch("t_ns",           &TimeNs,         "t_ns/l",           bs));
+        comp(tree->Branch("ChannelMask",    &ChannelMask,    "ChannelMask/i",    bs));
+        for(int c=0;c<8;++c){
+            if(!((saveMask>>c)&1)) continue;
+            for(const auto& b : branches_(c)) comp(tree->Branch(b.name.c_str(), b.addr, b.leaf.c_str(), bs));
+        }
+        return true;
+    }
+
+    // Copy ns samples of channel c into the branch buffer (zero-padded to recLen).
+    // ZLE mode keeps the whole record as one region.
+    void set(int c, const uint16_t* s, uint32_t ns){
+        auto& w = wave[c];
+        if(w.empty()) return;
+        const uint32_t n = ns < recLen ? ns : recLen;
+        if(zle){ const ZleSeg all{0, n}; set_roi(c, s, n, &all, n ? 1 : 0); return; }
+        std::memcpy(w.data(), s, n*sizeof(uint16_t));
+        if(n<recLen) std::memset(w.data()+n, 0, (recLen-n)*sizeof(uint16_t));
+    }
+
+    // ZLE mode: store the regions seg[0..n) of the ns samples of channel c (at most kMaxSeg).
+    void set_roi(int c, const uint16_t* s, uint32_t ns, const ZleSeg* seg, uint32_t n){
+        if(wave[c].empty()) return;
+        if(ns > recLen) ns = recLen;
+        uint32_t k = 0, m = 0;
+        for(uint32_t i=0;i<n && k<kMaxSeg;++i){
+            if(seg[i].start >= ns) break;
+            const uint32_t len = seg[i].len < ns - seg[i].start ? seg[i].len : ns - seg[i].start;
+            std::memcpy(roi[c].data() + m, s + seg[i].start, len*sizeof(uint16_t));
+            segStart[c][k] = seg[i].start; segLen[c][k] = len;
+            m += len; k++;
+        }
+        nseg[c] = k; nroi[c] = m;
+        recSamples += ns; roiSamples += m;
+    }
+
+    // Read back an existing tree of any layout (recLen from runinfo). Returns false if the
+    // tree has none of the saveMask channels.
+    bool open(TTree* t, uint32_t recLen_, uint32_t saveMask_ = 0xFF){
+        tree = t; recLen = recLen_;
+        char name[32];
+        packed = zle = false;
+        saveMask = 0;
+        for(int c=0;c<8;++c){
+            if(!((saveMask_>>c)&1)) continue;
+            snprintf(name, sizeof(name), "seg_start_ch%d", c);
+            if(t->GetBranch(name)) zle = true;
+            snprintf(name, sizeof(name), "z_ch%d", c);
+            if(t->GetBranch(name)) packed = true;
+            snprintf(name, sizeof(name), zle ? "nseg_ch%d" : packed ? "z_ch%d" : "wave_ch%d", c);
+            if(t->GetBranch(name)) saveMask |= 1u<<c;
+        }
+        alloc_();
+        bind_(t);
+        return saveMask != 0;
+    }
+
+    // Load entry i into wave[] (decoded if packed, rebuilt around fillValue if ZLE). False on a
+    // read error or a corrupt entry.
+    bool get(long long i){
+        if(!tree || tree->GetEntry(i) <= 0) return false;
+        for(int c=0;c<8;++c){
+            if(!((saveMask>>c)&1)) continue;
+            const uint32_t n = zle ? nroi[c] : recLen;
+            if(zle && (nseg[c] > kMaxSeg || n > recLen)) return false;
+            if(packed && n && !wc_decode(z[c].data(), zbytes[c], zle ? roi[c].data() : wave[c].data(), n)) return false;
+            if(!zle) continue;
+            std::fill(wave[c].begin(), wave[c].end(), fillValue[c]);
+            uint32_t m = 0;
+            for(uint32_t k=0;k<nseg[c];++k){
+                if(segStart[c][k] > recLen || segLen[c][k] > recLen - segStart[c][k] || m + segLen[c][k] > n) return false;
+                std::memcpy(wave[c].data() + segStart[c][k], roi[c].data() + m, segLen[c][k]*sizeof(uint16_t));
+                m += segLen[c][k];
+            }
+        }
+        return true;
+    }
+
+    // Packed mode encodes the saved channels here.
+    void fill(){
+        if(!tree) return;
+        if(packed)
+            for(int c=0;c<8;++c){
+                if(!((saveMask>>c)&1)) continue;
+                const uint32_t n = zle ? nroi[c] : recLen;
+                zbytes[c] = (uint32_t)wc_encode(zle ? roi[c].data() : wave[c].data(), n, z[c].data());
+                rawBytes += 2ull*n; packedBytes += zbytes[c];
+            }
+        tree->Fill();
+    }
+
+    double pack_ratio() const { return packedBytes ? double(rawBytes)/packedBytes : 0.0; }
+    double zle_reduction() const { return roiSamples ? double(recSamples)/roiSamples : 0.0; }
+
+    void write(){
+        if(!tree) return;
+        TDirectory* d = tree->GetDirectory();
+        if(d) d->cd();
+        tree->Write("", TObject::kOverwrite);
+    }
+
+private:
+    struct Br { std::string name; void* addr; std::string leaf; };
+
+    // Per-channel branches of the layout; counters come before the arrays they size.
+    std::vector<Br> branches_(int c){
+        char b[8][48];
+        std::vector<Br> v;
+        if(zle){
+            snprintf(b[0], sizeof(b[0]), "nseg_ch%d", c);
+            snprintf(b[1], sizeof(b[1]), "seg_start_ch%d", c);
+            snprintf(b[2], sizeof(b[2]), "seg_len_ch%d", c);
+            snprintf(b[3], sizeof(b[3]), "nroi_ch%d", c);
+            v.push_back({b[0], &nseg[c],             std::string(b[0]) + "/i"});
+            v.push_back({b[1], segStart[c].data(),   std::string(b[1]) + "[" + b[0] + "]/i"});
+            v.push_back({b[2], segLen[c].data(),     std::string(b[2]) + "[" + b[0] + "]/i"});
+            v.push_back({b[3], &nroi[c],             std::string(b[3]) + "/i"});
+        }
+        if(packed){
+            snprintf(b[4], sizeof(b[4]), "zbytes_ch%d", c);
+            snprintf(b[5], sizeof(b[5]), "z_ch%d", c);
+            v.push_back({b[4], &zbytes[c],           std::string(b[4]) + "/i"});
+            v.push_back({b[5], z[c].data(),          std::string(b[5]) + "[" + b[4] + "]/b"});
+        } else if(zle){
+            snprintf(b[6], sizeof(b[6]), "roi_ch%d", c);
+            v.push_back({b[6], roi[c].data(),        std::string(b[6]) + "[" + b[3] + "]/s"});
+        } else {
+            snprintf(b[7], sizeof(b[7]), "wave_ch%d", c);
+            v.push_back({b[7], wave[c].data(),       std::string(b[7]) + "[" + std::to_string(recLen) + "]/s"});
+        }
+        return v;
+    }
+
+    void bind_(TTree* t){
+        t->SetBranchAddress("EventCounter",   &EventCounter);
+        t->SetBranchAddress("TriggerTimeTag", &TriggerTimeTag);
+        t->SetBranchAddress("ChannelMask",    &ChannelMask);
+        if(t->GetBranch("t_ns")) t->SetBranchAddress("t_ns", &TimeNs); // absent in older files
+        for(int c=0;c<8;++c){
+            if(!((saveMask>>c)&1)) continue;
+            for(const auto& b : branches_(c)) t->SetBranchAddress(b.name.c_str(), b.addr);
+        }
+    }
+
+    void alloc_(){
+        for(int c=0;c<8;++c){
+            const bool on = (saveMask>>c)&1;
+            wave[c].assign(on ? recLen : 0, 0);
+            z[c].assign(on && packed ? wc_max_bytes(recLen) : 0, 0);
+            roi[c].assign(on && zle ? recLen : 0, 0);
+            segStart[c].assign(on && zle ? kMaxSeg : 0, 0);
+            segLen[c].assign(on && zle ? kMaxSeg : 0, 0);
+            zbytes[c] = nseg[c] = nroi[c] = 0;
+        }
+    }
+};
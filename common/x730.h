@@ -0,0 +1,178 @@
+// X730 (DT5730/V1730) standard-firmware event format, decoded without the CAEN library.
+//   word 0: [31:28]=0xA, [27:0] event size in 32-bit words (header included)
+//   word 1: [31:27] board id, [26] board fail, [23:8] pattern, [7:0] channel mask
+//   word 2: [31:24] channel mask [15:8], [23:0] event counter
+//   word 3: trigger time tag
+// then, for every channel set in the mask, ChSize/2 words with two 14-bit samples each
+// (sample 2k in bits [13:0], sample 2k+1 in bits [29:16]).
+// Assumes a little-endian host (x86, ARM).
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+struct X730Event {
+    uint32_t sizeWords = 0;
+    uint32_t boardId = 0;
+    uint32_t pattern = 0;
+    uint32_t chMask = 0;
+    uint32_t counter = 0;
+    uint32_t ttt = 0;
+    uint32_t wordsPerCh = 0;        // samples per channel = 2*wordsPerCh
+    const uint32_t* payload = nullptr;
+};
+
+// Parse the event at p (pointing at word 0). Returns false on a malformed header.
+inline bool x730_parse(const uint32_t* p, const uint32_t* end, X730Event& ev){
+    if(end - p < 4 || (p[0] >> 28) != 0xA) return false;
+    const uint32_t sz = p[0] & 0x0FFFFFFFu;
+    if(sz < 4 || (size_t)(end - p) < sz) return false;
+    ev.sizeWords = sz;
+    ev.boardId   = p[1] >> 27;
+    ev.pattern   = (p[1] >> 8) & 0xFFFF;
+    ev.chMask    = (p[1] & 0xFF) | ((p[2] >> 16) & 0xFF00);
+    ev.counter   = p[2] & 0x00FFFFFFu;
+    ev.ttt       = p[3];
+    const uint32_t nch = (uint32_t)__builtin_popcount(ev.chMask);
+    ev.wordsPerCh = nch ? (sz - 4) / nch : 0;
+    ev.payload   = p + 4;
+    return true;
+}
+
+// Walk a readout block: calls fn(const X730Event&) for each event, returns the event count.
+template <class Fn>
+inline uint32_t x730_for_each(const char* buf, uint32_t bytes, Fn&& fn){
+    const uint32_t* p   = reinterpret_cast<const uint32_t*>(buf);
+    const uint32_t* end = p + bytes/4;
+    uint32_t n = 0;
+    X730Event ev;
+    while(p < end && x730_parse(p, end, ev)){
+        fn(ev);
+        p += ev.sizeWords;
+        ++n;
+    }
+    return n;
+}
+
+// Payload of channel ch (must be set in ev.chMask).
+inline const uint32_t* x730_channel(const X730Event& ev, int ch){
+    const uint32_t below = ev.chMask & ((1u << ch) - 1);
+    return ev.payload + (size_t)__builtin_popcount(below) * ev.wordsPerCh;
+}
+
+// Unpacking: on a little-endian host each packed word already holds (sample 2k, sample 2k+1)
+// as two uint16 halves, so unpacking is an AND with 0x3FFF3FFF (clearing the two spare bits
+// per sample) and a store. Kernels below do that 4/8 words at a time; all give identical output.
+
+inline void x730_unpack_scalar(const uint32_t* w, uint32_t nwords, uint16_t* out){
+    for(uint32_t k=0; k<nwords; ++k){
+        const uint32_t v = w[k] & 0x3FFF3FFFu;
+        out[2*k]   = (uint16_t)(v & 0xFFFF);
+        out[2*k+1] = (uint16_t)(v >> 16);
+    }
+}
+
+#if defined(__x86_64__)
+inline void x730_unpack_sse2(const uint32_t* w, uint32_t nwords, uint16_t* out){
+    const __m128i m = _mm_set1_epi32(0x3FFF3FFF);
+    uint32_t k = 0;
+    for(; k+4<=nwords; k+=4){
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(w+k));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out+2*k), _mm_and_si128(v, m));
+    }
+    x730_unpack_scalar(w+k, nwords-k, out+2*k);
+}
+
+__attribute__((target("avx2")))
+inline void x730_unpack_avx2(const uint32_t* w, uint32_t nwords, uint16_t* out){
+    const __m256i m = _mm256_set1_epi32(0x3FFF3FFF);
+    uint32_t k = 0;
+    for(; k+16<=nwords; k+=16){
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w+k));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w+k+8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out+2*k),    _mm256_and_si256(a, m));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out+2*k+16), _mm256_and_si256(b, m));
+    }
+    for(; k+8<=nwords; k+=8){
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w+k));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out+2*k), _mm256_and_si256(a, m));
+    }
+    x730_unpack_scalar(w+k, nwords-k, out+2*k);
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+inline void x730_unpack_neon(const uint32_t* w, uint32_t nwords, uint16_t* out){
+    const uint32x4_t m = vdupq_n_u32(0x3FFF3FFFu);
+    uint32_t k = 0;
+    for(; k+8<=nwords; k+=8){
+        uint32x4_t a = vandq_u32(vld1q_u32(w+k),   m);
+        uint32x4_t b = vandq_u32(vld1q_u32(w+k+4), m);
+        vst1q_u16(out+2*k,   vreinterpretq_u16_u32(a));
+        vst1q_u16(out+2*k+8, vreinterpretq_u16_u32(b));
+    }
+    x730_unpack_scalar(w+k, nwords-k, out+2*k);
+}
+#endif
+
+using X730UnpackFn = void (*)(const uint32_t*, uint32_t, uint16_t*);
+
+// Best kernel for this host (checked once).
+inline X730UnpackFn x730_best_unpack(const char** name = nullptr){
+#if defined(__x86_64__)
+    const bool avx2 = __builtin_cpu_supports("avx2");
+    if(name) *name = avx2 ? "avx2" : "sse2";
+    return avx2 ? x730_unpack_avx2 : x730_unpack_sse2;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if(name) *name = "neon";
+    return x730_unpack_neon;
+#else
+    if(name) *name = "scalar";
+    return x730_unpack_scalar;
+#endif
+}
+
+// Unpack nwords packed words into 2*nwords samples.
+inline void x730_unpack(const uint32_t* w, uint32_t nwords, uint16_t* out){
+    static const X730UnpackFn fn = x730_best_unpack();
+    fn(w, nwords, out);
+}
+
+// Trigger time tag: 31-bit counter of 8 ns ticks (DT5730), wrapping every 2^31 * 8 ns = 17.18 s.
+constexpr uint32_t kX730TttMask = 0x7FFFFFFFu;
+constexpr uint64_t kX730TttWrap = 1ull << 31;
+constexpr uint32_t kX730TickNs  = 8;
+
+// Extends a board's trigger time tags to 64-bit ticks since the start of the run. Consecutive
+// events are assumed less than one wrap apart unless a wall-clock hint (ns of the readout) says
+// more wraps went by, as after a quiet period longer than 17 s.
+struct X730TimeUnwrap {
+    uint64_t wraps = 0;
+    uint32_t last = 0;
+    uint64_t lastWallNs = 0;
+    bool     have = false;
+
+    uint64_t ticks(uint32_t ttt, uint64_t wallNs = 0){
+        ttt &= kX730TttMask;
+        if(have){
+            if(ttt < last) wraps++;
+            if(wallNs && lastWallNs && wallNs > lastWallNs){
+                // whole wraps the tick difference cannot show
+                const double seen = double(ttt < last ? ttt + kX730TttWrap - last : ttt - last);
+                const double wall = double(wallNs - lastWallNs) / kX730TickNs;
+                const double extra = std::floor((wall - seen) / double(kX730TttWrap) + 0.5);
+                if(extra > 0) wraps += (uint64_t)extra;
+            }
+        }
+        last = ttt; have = true;
+        if(wallNs) lastWallNs = wallNs;
+        return wraps * kX730TttWrap + ttt;
+    }
+    uint64_t ns(uint32_t ttt, uint64_t wallNs = 0){ return ticks(ttt, wallNs) * kX730TickNs; }
+};
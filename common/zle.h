@@ -0,0 +1,133 @@
+// Software zero-length encoding: keep only the regions of a record around samples that leave the
+// band [lo, hi] (pedestal -/+ threshold), widened by 'pre' samples before and 'post' after.
+// Overlapping or touching regions merge. Two passes:
+//   mask    : one bit per sample outside the band (SIMD compare + movemask, 64 samples per word)
+//   segments: walk the set bits with ctz, growing the current region or opening a new one
+// A record with more than maxSeg regions gets its last region extended to the end of the record,
+// so nothing above threshold is ever dropped.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+struct ZleSeg { uint32_t start = 0, len = 0; };
+
+struct ZleCut {
+    uint16_t lo = 0, hi = 0xFFFF;       // samples < lo or > hi are signal
+    uint32_t pre = 0, post = 0;
+};
+
+// Negative pulses (and optionally positive excursions) thr counts away from the pedestal.
+inline ZleCut zle_cut(uint32_t ped, uint32_t thr, uint32_t pre, uint32_t post, bool bipolar){
+    ZleCut c;
+    c.lo = (uint16_t)(ped > thr ? ped - thr : 0);
+    c.hi = bipolar ? (uint16_t)(ped + thr < 0xFFFF ? ped + thr : 0xFFFF) : 0xFFFF;
+    c.pre = pre; c.post = post;
+    return c;
+}
+
+inline size_t zle_mask_words(uint32_t n){ return (n + 63) / 64; }
+
+inline void zle_mask_scalar(const uint16_t* s, uint32_t n, uint16_t lo, uint16_t hi, uint64_t* bits){
+    for(size_t w=0; w<zle_mask_words(n); ++w) bits[w] = 0;
+    for(uint32_t i=0;i<n;++i)
+        if(s[i] < lo || s[i] > hi) bits[i>>6] |= 1ull << (i & 63);
+}
+
+#if defined(__x86_64__)
+inline void zle_mask_sse2(const uint16_t* s, uint32_t n, uint16_t lo, uint16_t hi, uint64_t* bits){
+    // unsigned compares as signed ones on x ^ 0x8000
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i vlo = _mm_set1_epi16((short)(lo ^ 0x8000)), vhi = _mm_set1_epi16((short)(hi ^ 0x8000));
+    auto out16 = [&](const uint16_t* p)->uint64_t{
+        const __m128i a = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),   bias);
+        const __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+8)), bias);
+        const __m128i ma = _mm_or_si128(_mm_cmplt_epi16(a, vlo), _mm_cmpgt_epi16(a, vhi));
+        const __m128i mb = _mm_or_si128(_mm_cmplt_epi16(b, vlo), _mm_cmpgt_epi16(b, vhi));
+        return (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_packs_epi16(ma, mb));
+    };
+    uint32_t i = 0;
+    for(; i+64<=n; i+=64)
+        bits[i>>6] = out16(s+i) | out16(s+i+16) << 16 | out16(s+i+32) << 32 | out16(s+i+48) << 48;
+    if(i < n){
+        uint64_t m = 0;
+        for(uint32_t k=i;k<n;++k) if(s[k] < lo || s[k] > hi) m |= 1ull << (k - i);
+        bits[i>>6] = m;
+    }
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+inline void zle_mask_neon(const uint16_t* s, uint32_t n, uint16_t lo, uint16_t hi, uint64_t* bits){
+    const uint16x8_t vlo = vdupq_n_u16(lo), vhi = vdupq_n_u16(hi);
+    static const uint16_t kw[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint16x8_t weight = vld1q_u16(kw);
+    auto out8 = [&](const uint16_t* p)->uint64_t{
+        const uint16x8_t v = vld1q_u16(p);
+        const uint16x8_t m = vandq_u16(vorrq_u16(vcltq_u16(v, vlo), vcgtq_u16(v, vhi)), weight);
+        const uint64x2_t t = vpaddlq_u32(vpaddlq_u16(m));
+        return vgetq_lane_u64(t, 0) + vgetq_lane_u64(t, 1);
+    };
+    uint32_t i = 0;
+    for(; i+64<=n; i+=64){
+        uint64_t m = 0;
+        for(int k=0;k<8;++k) m |= out8(s+i+8*k) << (8*k);
+        bits[i>>6] = m;
+    }
+    if(i < n){
+        uint64_t m = 0;
+        for(uint32_t k=i;k<n;++k) if(s[k] < lo || s[k] > hi) m |= 1ull << (k - i);
+        bits[i>>6] = m;
+    }
+}
+#endif
+
+using ZleMaskFn = void (*)(const uint16_t*, uint32_t, uint16_t, uint16_t, uint64_t*);
+
+inline ZleMaskFn zle_best_mask(const char** name = nullptr){
+#if defined(__x86_64__)
+    if(name) *name = "sse2";
+    return zle_mask_sse2;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if(name) *name = "neon";
+    return zle_mask_neon;
+#else
+    if(name) *name = "scalar";
+    return zle_mask_scalar;
+#endif
+}
+
+// Regions of s[0..n) for the cut; bits is scratch of zle_mask_words(n) words. Returns the count.
+inline uint32_t zle_find_with(ZleMaskFn maskFn, const uint16_t* s, uint32_t n, const ZleCut& cut,
+                              uint64_t* bits, ZleSeg* seg, uint32_t maxSeg){
+    if(!n || !maxSeg) return 0;
+    maskFn(s, n, cut.lo, cut.hi, bits);
+    uint32_t nseg = 0, end = 0;          // current region is [seg[nseg-1].start, end)
+    for(size_t w=0; w<zle_mask_words(n); ++w){
+        uint64_t m = bits[w];
+        while(m){
+            const uint32_t p = (uint32_t)(w*64) + (uint32_t)__builtin_ctzll(m);
+            m &= m - 1;
+            const uint32_t a = p > cut.pre ? p - cut.pre : 0;
+            const uint32_t e = p + cut.post + 1 < n ? p + cut.post + 1 : n;
+            if(nseg && a <= end){ if(e > end) end = e; continue; }
+            if(nseg == maxSeg){ end = n; break; }
+            if(nseg) seg[nseg-1].len = end - seg[nseg-1].start;
+            seg[nseg++].start = a;
+            end = e;
+        }
+        if(end == n && nseg) break;
+    }
+    if(nseg) seg[nseg-1].len = end - seg[nseg-1].start;
+    return nseg;
+}
+
+inline uint32_t zle_find(const uint16_t* s, uint32_t n, const ZleCut& cut, uint64_t* bits, ZleSeg* seg, uint32_t maxSeg){
+    static const ZleMaskFn fn = zle_best_mask();
+    return zle_find_with(fn, s, n, cut, bits, seg, maxSeg);
+}
@@ -0,0 +1,497 @@
+// Multi-board acquisition for X730 boards (DT5730S): one readout thread per board, a k-way merge of
+// the boards' 64-bit trigger times into global events within a coincidence window, one output stream.
+// Build: g++ -O2 -std=c++17 -I. daq_multi.cpp -o daq_multi $(root-config --cflags --libs) -lCAENDigitizer -pthread
+// Sim:   g++ -O2 -std=c++17 -I. -Isim daq_multi.cpp -o daq_multi_sim $(root-config --cflags --libs) -pthread
+
+/*
+
+# 1) Two boards on USB links 0 and 1, common external trigger, 200 ns window
+./daq_multi -b usb:0 -b usb:1 -n 10000 -m ext --window 200 --root multi.root
+
+# 2) Four boards daisy-chained on optical link 0, self-trigger, keep only 2+ board coincidences
+./daq_multi -b opt:0:0 -b opt:0:1 -b opt:0:2 -b opt:0:3 -n 10000 -m self -t 50 --min-hits 2 --root multi.root
+
+# 3) Measure clock offsets with a wide window (dt vs board 0 is printed), then correct them
+./daq_multi -b usb:0 -b usb:1 -n 2000 -m ext --window 100000
+./daq_multi -b usb:0 -b usb:1 -n 10000 -m ext --window 200 --offset-ns 0,1200
+
+# 4) Simulated boards sharing one pulse train, with known clock offsets
+DGTZ_SIM_SHARED=1 DGTZ_SIM_CLOCK_OFFSET_NS=0,1000,2500,4000 \
+  ./daq_multi_sim -b usb:0 -b usb:1 -b usb:2 -b usb:3 -n 20000 -m ext --offset-ns 0,1000,2500,4000
+
+*/
+
+#include <CAENDigitizer.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+
+// ROOT
+#include <TFile.h>
+#include <TDirectory.h>
+#include <TLeaf.h>
+#include <TTree.h>
+
+#include "common/spsc_ring.h"
+#include "common/waves_tree.h"
+#include "common/x730.h"
+#include "common/board_config.h"
+#include "common/event_builder.h"
+#include "common/perf.h"
+#include "common/pedestal.h"
+
+static void die(const char* where, CAEN_DGTZ_ErrorCode ec){
+    fprintf(stderr,"[ERR] %s failed (code=%d)\n", where, ec);
+    std::exit(1);
+}
+static void ok(const char* where, CAEN_DGTZ_ErrorCode ec){
+    if(ec!=CAEN_DGTZ_Success) die(where,ec);
+}
+
+static double thread_cpu_sec(){
+    timespec ts{}; clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+struct BoardSpec { CAEN_DGTZ_ConnectionType type = CAEN_DGTZ_USB; int link = 0, node = 0; std::string text; };
+
+// usb:LINK | opt:LINK:NODE (CONET daisy chain)
+static bool parse_board(const std::string& s, BoardSpec& b){
+    b.text = s;
+    if(s.rfind("usb:",0)==0){ b.type = CAEN_DGTZ_USB; b.link = std::atoi(s.c_str()+4); return true; }
+    if(s.rfind("opt:",0)==0){
+        b.type = CAEN_DGTZ_OpticalLink;
+        const char* p = s.c_str()+4;
+        b.link = std::atoi(p);
+        const char* colon = std::strchr(p, ':');
+        b.node = colon ? std::atoi(colon+1) : 0;
+        return true;
+    }
+    return false;
+}
+
+struct Board {
+    explicit Board(size_t nevt) : freeSlots(nevt), stream(nevt) {}
+    BoardSpec spec;
+    int handle = -1;
+    CAEN_DGTZ_BoardInfo_t info{};
+    BoardConfig cfg;
+    uint32_t ped = 0, thr = 0;
+    float pedRms = 0;
+    int64_t offsetNs = 0;
+    char* buf = nullptr; uint32_t cap = 0;
+    std::vector<uint16_t> arena;          // nevt slots of nSave*recLen samples
+    SpscRing<uint32_t> freeSlots;         // writer -> board thread
+    BoardStream stream;                   // board thread -> builder
+    // owned by the board thread, read after the join
+    uint64_t reads = 0, bytes = 0, hits = 0, gaps = 0;
+    uint64_t stallNs = 0;
+    double cpuSec = 0;
+    LogHist readNs;
+};
+
+static void usage(const char* prog){
+    printf("Usage: %s -b usb:L|opt:L:N [-b ...] [-n N] [-m self|ext] [-c ch] [-r recLen] [--post %%] [-t delta]\n"
+           "            [--save-mask 0xMM] [--window ns] [--offset-ns o0,o1,...] [--min-hits k]\n"
+           "            [--root file.root] [--tag name] [--compress alg[:level]] [--nevt n] [--ped-events M]\n", prog);
+}
+
+int main(int argc, char** argv){
+    const std::vector<std::string> args(argv+1, argv+argc);
+    std::vector<BoardSpec> specs;
+    int N=1000;
+    std::string trig="ext";       // self | ext
+    int ch=0;
+    int recLen=1024;
+    int post=50;                  // %
+    uint32_t delta=120;           // self: threshold below each board's pedestal (ADC)
+    uint32_t saveMask=0;          // channels stored per board; 0 = just -c ch
+    double windowNs=100;          // coincidence window
+    std::vector<int64_t> offsets; // per board, subtracted from its time (ns)
+    int minHits=1;                // keep global events with at least this many boards
+    std::string rootOut="", tag="", compress="";
+    int nevt=1024;                // event slots per board
+    int pedEvents=32;             // events averaged by each board's pedestal calibration
+
+    bool badArgs=false;
+    auto need = [&](const char* o, size_t& i)->const char*{
+        if(i+1>=args.size()){ fprintf(stderr,"missing after %s\n",o); badArgs=true; return "0"; }
+        return args[++i].c_str();
+    };
+    for(size_t i=0;i<args.size();++i){
+        const std::string& a=args[i];
+        if(a=="-h"||a=="--help"){ usage(argv[0]); return 0; }
+        else if(a=="-b"){
+            BoardSpec b;
+            const char* v = need("-b",i);
+            if(!parse_board(v, b)){ fprintf(stderr,"[ERR] bad board '%s' (usb:L or opt:L:N)\n", v); return 2; }
+            specs.push_back(b);
+        }
+        else if(a=="-n") N=std::atoi(need("-n",i));
+        else if(a=="-m"||a=="--trigger") trig=need("-m",i);
+        else if(a=="-c") ch=std::atoi(need("-c",i));
+        else if(a=="-r") recLen=std::atoi(need("-r",i));
+        else if(a=="--post") post=std::atoi(need("--post",i));
+        else if(a=="-t") delta=(uint32_t)std::atoi(need("-t",i));
+        else if(a=="--save-mask") saveMask=(uint32_t)std::strtoul(need("--save-mask",i), nullptr, 0) & 0xFF;
+        else if(a=="--window") windowNs=std::atof(need("--window",i));
+        else if(a=="--offset-ns"){
+            for(const char* p = need("--offset-ns",i); *p; ){
+                char* end=nullptr;
+                offsets.push_back(std::strtoll(p, &end, 10));
+                if(end==p) break;
+                p = (*end==',') ? end+1 : end;
+            }
+        }
+        else if(a=="--min-hits") minHits=std::max(1, std::atoi(need("--min-hits",i)));
+        else if(a=="--root") rootOut=need("--root",i);
+        else if(a=="--tag") tag=need("--tag",i);
+        else if(a=="--compress") compress=need("--compress",i);
+        else if(a=="--nevt") nevt=std::max(16, std::atoi(need("--nevt",i)));
+        else if(a=="--ped-events") pedEvents=std::max(1, std::min(1000, std::atoi(need("--ped-events",i))));
+        else { fprintf(stderr,"[ERR] unknown option '%s'\n", a.c_str()); return 2; }
+    }
+    if(badArgs) return 2;
+    const int K = (int)specs.size();
+    if(K<1 || K>kMaxBuildBoards){ fprintf(stderr,"[ERR] need 1..%d boards (-b)\n", kMaxBuildBoards); return 2; }
+    if(trig!="self" && trig!="ext"){ fprintf(stderr,"[ERR] -m must be self or ext\n"); return 2; }
+    if(ch<0 || ch>=8){ fprintf(stderr,"[ERR] -c must be 0..7\n"); return 2; }
+    if(!offsets.empty() && (int)offsets.size()!=K){ fprintf(stderr,"[ERR] --offset-ns needs %d values\n", K); return 2; }
+    const int compSetting = compress.empty() ? -1 : parse_root_compression(compress);
+    if(!compress.empty() && compSetting<0){ fprintf(stderr,"[ERR] unknown --compress '%s'\n", compress.c_str()); return 2; }
+    if(tag.empty()) tag = trig;
+    if(saveMask==0) saveMask = 1u<<ch;
+    const int pair_base = (ch % 2 == 0) ? ch : (ch-1);
+    const uint32_t pair_mask = (1u << pair_base) | (1u << (pair_base+1));
+    const uint32_t enMask = saveMask | (1u<<ch) | (trig=="self" ? pair_mask : 0u);
+    const int nSave = __builtin_popcount(saveMask);
+    const uint32_t slotSamples = (uint32_t)nSave * (uint32_t)recLen;
+    const uint64_t window = (uint64_t)std::max(0.0, windowNs);
+
+    printf("[info] boards=%d, N=%d, trig=%s, ch=%d, recLen=%d, post=%d%%, delta=%u, save=0x%02x, window=%llu ns, min-hits=%d\n",
+           K, N, trig.c_str(), ch, recLen, post, delta, saveMask, (unsigned long long)window, minHits);
+
+    // Open and program every board; the DC-offset settle is shared.
+    std::vector<std::unique_ptr<Board>> boards;
+    for(int k=0;k<K;++k){
+        boards.emplace_back(new Board((size_t)nevt));
+        Board& B = *boards.back();
+        B.spec = specs[k];
+        B.offsetNs = offsets.empty() ? 0 : offsets[k];
+        ok("OpenDigitizer", CAEN_DGTZ_OpenDigitizer(B.spec.type, B.spec.link, B.spec.node, 0, &B.handle));
+        ok("GetInfo", CAEN_DGTZ_GetInfo(B.handle, &B.info));
+        printf("[board] #%d %s  Model=%s  serial=%u  ROC=%s  AMC=%s  offset=%lld ns\n", k, B.spec.text.c_str(),
+               B.info.ModelName, B.info.SerialNumber, B.info.ROC_FirmwareRel, B.info.AMC_FirmwareRel, (long long)B.offsetNs);
+        ok("Reset", CAEN_DGTZ_Reset(B.handle));
+        BoardWriter bw(B.handle, B.cfg, false);
+        ok("SetAcqMode", bw.acq_mode(CAEN_DGTZ_SW_CONTROLLED));
+        ok("SetChannelEnableMask", bw.enable_mask(enMask));
+        ok("SetRecordLength", bw.record_length(recLen));
+        ok("SetPostTriggerSize", bw.post_trigger(post));
+        ok("SetMaxNumEventsBLT", bw.max_blt(1023));
+        ok("CountAllTriggers", bw.count_all_triggers(true));
+        for(int i=0;i<8;++i){
+            ok("SetPulsePolarity", bw.pulse_polarity(i, CAEN_DGTZ_PulsePolarityNegative));
+            ok("SetTrigPolarity",  bw.trigger_polarity(i, CAEN_DGTZ_TriggerOnFallingEdge));
+            ok("SetChannelDCOffset", bw.dc_offset(i, 0x3333));
+        }
+        ok("MallocReadoutBuffer", CAEN_DGTZ_MallocReadoutBuffer(B.handle, &B.buf, &B.cap));
+        B.arena.resize((size_t)nevt * slotSamples);
+        for(int i=0;i<nevt;++i) B.freeSlots.try_push((uint32_t)i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    for(auto& bp : boards){
+        Board& B = *bp;
+        BoardWriter bw(B.handle, B.cfg, true);
+        ok("SetChannelSelfTrigger(DIS)", bw.self_trigger(0));
+        ok("SetExt(DIS)", bw.ext_trigger(CAEN_DGTZ_TRGMODE_DISABLED));
+        PedestalCal cal;
+        ok("CalibratePedestals", calibrate_pedestals(B.handle, bw, enMask, (uint32_t)pedEvents, cal));
+        if(cal.used[ch]) B.ped = (uint32_t)std::lround(cal.mean[ch]);
+        else { B.ped = 0x8000; fprintf(stderr,"[warn] %s pedestal: no usable data, using midscale\n", B.spec.text.c_str()); }
+        B.pedRms = cal.rms[ch];
+        ok("SetSWTriggerMode(DIS)", bw.sw_trigger(CAEN_DGTZ_TRGMODE_DISABLED));
+        if(trig=="ext"){
+            ok("SetExt(ACQ)", bw.ext_trigger(CAEN_DGTZ_TRGMODE_ACQ_ONLY));
+        } else {
+            B.thr = B.ped > delta ? B.ped - delta : 0u;
+            ok("SetThr(pair_base)",   bw.threshold(pair_base,   B.thr));
+            ok("SetThr(pair_base+1)", bw.threshold(pair_base+1, B.thr));
+            ok("SetChannelSelfTrigger(ACQ_ONLY, pair)", bw.self_trigger(pair_mask));
+        }
+        printf("[auto] %s ped(ch%d)=%u rms=%.2f thr_abs=%u\n", B.spec.text.c_str(), ch, B.ped, B.pedRms, B.thr);
+        ok("ClearData", CAEN_DGTZ_ClearData(B.handle));
+    }
+
+    // Output: one 'built' tree per tag, one entry per global event, hits ordered by board index
+    TFile* rfile = nullptr;
+    TTree* tree = nullptr;
+    unsigned long long o_t = 0;
+    uint32_t o_n = 0, o_mask = 0;
+    uint8_t  o_board[kMaxBuildBoards] = {};
+    int32_t  o_dt[kMaxBuildBoards] = {};
+    uint32_t o_cnt[kMaxBuildBoards] = {};
+    unsigned long long o_ticks[kMaxBuildBoards] = {};
+    std::vector<uint16_t> o_wave((size_t)kMaxBuildBoards * slotSamples);
+    if(!rootOut.empty()){
+        rfile = TFile::Open(rootOut.c_str(), "UPDATE");
+        if(!rfile || rfile->IsZombie()){
+            rfile = TFile::Open(rootOut.c_str(), "RECREATE");
+            if(rfile && !rfile->IsZombie() && compSetting>=0) rfile->SetCompressionSettings(compSetting);
+        }
+        if(!rfile || rfile->IsZombie()){ fprintf(stderr,"[ERR] cannot open ROOT file '%s'\n", rootOut.c_str()); return 1; }
+        TDirectory* dtag = (TDirectory*)rfile->Get(tag.c_str());
+        if(!dtag) dtag = rfile->mkdir(tag.c_str());
+        dtag->cd();
+        char waveLeaf[64];
+        snprintf(waveLeaf, sizeof(waveLeaf), "wave[nhits][%u]/s", slotSamples);
+        struct { const char* name; void* addr; const char* leaf; } tb[] = {
+            {"t_ns",       &o_t,          "t_ns/l"},
+            {"nhits",      &o_n,          "nhits/i"},
+            {"board_mask", &o_mask,       "board_mask/i"},
+            {"hit_board",  o_board,       "hit_board[nhits]/b"},
+            {"hit_dt",     o_dt,          "hit_dt[nhits]/I"},
+            {"hit_cnt",    o_cnt,         "hit_cnt[nhits]/i"},
+            {"hit_ticks",  o_ticks,       "hit_ticks[nhits]/l"},
+            {"wave",       o_wave.data(), waveLeaf},
+        };
+        if((tree = (TTree*)dtag->Get("built"))){
+            // samples per hit are fixed by -r and --save-mask: another length would make Fill read
+            // past o_wave (longer) or store shifted waveforms (shorter)
+            const TLeaf* lw = tree->GetLeaf("wave");
+            if(!lw || lw->GetLenStatic() != (int)slotSamples){
+                fprintf(stderr,"[ERR] existing '%s/built' stores %d samples per hit, this run %u (-r/--save-mask differ); use another --tag or file\n",
+                        tag.c_str(), lw ? lw->GetLenStatic() : 0, slotSamples);
+                rfile->Close(); delete rfile;
+                return 1;
+            }
+            for(auto& b : tb) tree->SetBranchAddress(b.name, b.addr);
+        } else {
+            tree = new TTree("built", "global events: time of the first hit (ns), per hit board/dt/counter/ticks, "
+                                      "waveforms of the saved channels concatenated per hit");
+            for(auto& b : tb){
+                TBranch* br = tree->Branch(b.name, b.addr, b.leaf);
+                if(br && compSetting>=0) br->SetCompressionSettings(compSetting);
+            }
+        }
+        rfile->cd();
+    }
+
+    // Pipeline: board threads (read + unpack + unwrap) -> builder (k-way merge) -> writer (main)
+    std::vector<BuiltEvent> built((size_t)nevt);
+    SpscRing<uint32_t> builtFree((size_t)nevt), builtReady((size_t)nevt);
+    for(int i=0;i<nevt;++i) builtFree.try_push((uint32_t)i);
+    std::atomic<bool> stop{false}, buildDone{false};
+
+    for(auto& bp : boards) ok("SWStartAcquisition", CAEN_DGTZ_SWStartAcquisition(bp->handle));
+    const auto tAcq0 = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> readers;
+    for(auto& bp : boards){
+        readers.emplace_back([&, B = bp.get()]{
+            X730TimeUnwrap unwrap;
+            bool haveCnt = false;
+            uint32_t lastCnt = 0;
+            uint32_t pollUs = 20;
+            const uint32_t words = (uint32_t)recLen/2;
+            while(!stop.load(std::memory_order_relaxed)){
+                uint32_t bsz = 0;
+                const uint64_t t0 = perf_now_ns();
+                ok("ReadData", CAEN_DGTZ_ReadData(B->handle, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT, B->buf, &bsz));
+                const uint64_t t1 = perf_now_ns();
+                B->readNs.record(t1 - t0);
+                if(bsz){
+                    B->reads++; B->bytes += bsz; pollUs = 20;
+                    x730_for_each(B->buf, bsz, [&](const X730Event& xe){
+                        uint32_t slot;
+                        if(!B->freeSlots.try_pop(slot)){
+                            const uint64_t s0 = perf_now_ns();
+                            Backoff bo;
+                            while(!B->freeSlots.try_pop(slot)) bo.wait();
+                            B->stallNs += perf_now_ns() - s0;
+                        }
+                        uint16_t* dst = B->arena.data() + (size_t)slot*slotSamples;
+                        const uint32_t w = std::min(xe.wordsPerCh, words);
+                        for(int c=0;c<8;++c){
+                            if(!((saveMask>>c)&1)) continue;
+                            if((xe.chMask>>c)&1){ x730_unpack(x730_channel(xe, c), w, dst); if(2*w<(uint32_t)recLen) std::memset(dst+2*w, 0, (recLen-2*w)*2); }
+                            else std::memset(dst, 0, (size_t)recLen*2);
+                            dst += recLen;
+                        }
+                        BoardHit h;
+                        h.ticks = unwrap.ticks(xe.ttt, t1);
+                        const int64_t t = (int64_t)(h.ticks * kX730TickNs) - B->offsetNs;
+                        h.tNs = t > 0 ? (uint64_t)t : 0;
+                        h.readNs = t1;
+                        h.counter = xe.counter;
+                        h.slot = slot;
+                        if(haveCnt) B->gaps += (xe.counter - lastCnt - 1) & 0xFFFFFFu;
+                        lastCnt = xe.counter; haveCnt = true;
+                        B->hits++;
+                        B->stream.q.try_push(h); // cannot fail: ring holds every slot
+                    });
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(pollUs));
+                    pollUs = std::min<uint32_t>(pollUs*2, 1000);
+                }
+                B->stream.drainedNs.store(t0, std::memory_order_release);
+            }
+            B->cpuSec = thread_cpu_sec();
+            B->stream.done.store(true, std::memory_order_release);
+        });
+    }
+
+    uint64_t nBuilt = 0, nKept = 0;
+    double buildCpu = 0;
+    std::thread builder([&]{
+        std::vector<BoardStream*> streams;
+        for(auto& bp : boards) streams.push_back(&bp->stream);
+        EventBuilder eb(streams, window);
+        Backoff bo;
+        for(;;){
+            const int r = eb.step([&](const BuiltEvent& be){
+                uint32_t bi;
+                if(!builtFree.try_pop(bi)) return false;
+                built[bi] = be;
+                builtReady.try_push(bi);
+                nBuilt++;
+                if(be.n >= minHits && ++nKept >= (uint64_t)N) stop = true;
+                return true;
+            });
+            if(r<0) break;
+            if(r==0) bo.wait(); else bo.reset();
+        }
+        buildCpu = thread_cpu_sec();
+        buildDone = true;
+    });
+
+    // Writer: stats, ROOT, and the slots go back to their boards
+    uint64_t written = 0;
+    std::vector<uint64_t> mult(K+1, 0);
+    std::vector<uint64_t> coinc(K, 0);
+    std::vector<double> dtSum(K, 0.0), dtSum2(K, 0.0);
+    {
+        Backoff bo;
+        for(;;){
+            uint32_t bi;
+            if(!builtReady.try_pop(bi)){
+                if(buildDone && builtReady.size()==0) break;
+                bo.wait(); continue;
+            }
+            bo.reset();
+            const BuiltEvent& be = built[bi];
+            mult[be.n]++;
+            if(be.board[0]==0){ // dt of every other board against board 0
+                for(int i=1;i<be.n;++i){
+                    const double dt = double(be.hit[i].tNs) - double(be.hit[0].tNs);
+                    const int b = be.board[i];
+                    coinc[b]++; dtSum[b] += dt; dtSum2[b] += dt*dt;
+                }
+            }
+            if(be.n >= minHits && written < (uint64_t)N){
+                if(tree){
+                    o_t = be.tNs; o_n = (uint32_t)be.n; o_mask = 0;
+                    for(int i=0;i<be.n;++i){
+                        const int b = be.board[i];
+                        const BoardHit& h = be.hit[i];
+                        o_mask |= 1u<<b;
+                        o_board[i] = (uint8_t)b;
+                        o_dt[i] = (int32_t)(h.tNs - be.tNs);
+                        o_cnt[i] = h.counter;
+                        o_ticks[i] = h.ticks;
+                        std::memcpy(o_wave.data() + (size_t)i*slotSamples,
+                                    boards[b]->arena.data() + (size_t)h.slot*slotSamples, slotSamples*sizeof(uint16_t));
+                    }
+                    tree->Fill();
+                }
+                written++;
+            }
+            for(int i=0;i<be.n;++i) boards[be.board[i]]->freeSlots.try_push(be.hit[i].slot);
+            builtFree.try_push(bi);
+        }
+    }
+    for(auto& t : readers) t.join();
+    builder.join();
+    const double acqSec = std::chrono::duration<double>(std::chrono::steady_clock::now()-tAcq0).count();
+    for(auto& bp : boards) ok("SWStopAcquisition", CAEN_DGTZ_SWStopAcquisition(bp->handle));
+
+    // Summary
+    for(int k=0;k<K;++k){
+        const Board& B = *boards[k];
+        const uint64_t trg = B.hits + B.gaps;
+        printf("[board] #%d %s  %llu hits (%.1f Hz)  %.2f MB/s  dead %.2f%%  ReadData p50 %.1f us p99 %.1f us  cpu %.1f%%  waited %.1f ms for slots",
+               k, B.spec.text.c_str(), (unsigned long long)B.hits, acqSec>0 ? B.hits/acqSec : 0.0,
+               acqSec>0 ? B.bytes/acqSec/1e6 : 0.0, trg ? 100.0*B.gaps/trg : 0.0,
+               B.readNs.percentile(0.5)/1e3, B.readNs.percentile(0.99)/1e3, acqSec>0 ? 100*B.cpuSec/acqSec : 0.0, B.stallNs/1e6);
+        if(k>0 && coinc[k]){
+            const double m = dtSum[k]/coinc[k];
+            printf("  dt vs #0 %.1f +- %.1f ns (%llu)", m, std::sqrt(std::max(0.0, dtSum2[k]/coinc[k] - m*m)), (unsigned long long)coinc[k]);
+        }
+        printf("\n");
+    }
+    printf("[build] %llu global events (%.1f /s), %llu written;  multiplicity:", (unsigned long long)nBuilt,
+           acqSec>0 ? nBuilt/acqSec : 0.0, (unsigned long long)written);
+    for(int m=1;m<=K;++m) printf(" %d:%llu", m, (unsigned long long)mult[m]);
+    printf(";  builder cpu %.1f%%\n", acqSec>0 ? 100*buildCpu/acqSec : 0.0);
+
+    if(rfile){
+        // per-run build parameters and board statistics (top level, one entry per run)
+        char i_tag[64]; snprintf(i_tag, sizeof(i_tag), "%s", tag.c_str());
+        int32_t i_nb = K, i_min = minHits;
+        double i_win = (double)window, i_acq = acqSec;
+        uint32_t i_serial[kMaxBuildBoards] = {};
+        long long i_off[kMaxBuildBoards] = {};
+        unsigned long long i_hits[kMaxBuildBoards] = {}, i_gaps[kMaxBuildBoards] = {}, i_coinc[kMaxBuildBoards] = {};
+        double i_dt[kMaxBuildBoards] = {};
+        for(int k=0;k<K;++k){
+            i_serial[k] = boards[k]->info.SerialNumber; i_off[k] = boards[k]->offsetNs;
+            i_hits[k] = boards[k]->hits; i_gaps[k] = boards[k]->gaps; i_coinc[k] = coinc[k];
+            i_dt[k] = coinc[k] ? dtSum[k]/coinc[k] : 0.0;
+        }
+        struct { const char* name; void* addr; const char* leaf; } ib[] = {
+            {"tag",        i_tag,    "tag/C"},
+            {"nboards",    &i_nb,    "nboards/I"},
+            {"window_ns",  &i_win,   "window_ns/D"},
+            {"min_hits",   &i_min,   "min_hits/I"},
+            {"acq_s",      &i_acq,   "acq_s/D"},
+            {"serial",     i_serial, "serial[8]/i"},
+            {"offset_ns",  i_off,    "offset_ns[8]/L"},
+            {"hits",       i_hits,   "hits[8]/l"},
+            {"counter_gaps", i_gaps, "counter_gaps[8]/l"},
+            {"coinc_b0",   i_coinc,  "coinc_b0[8]/l"},
+            {"dt_b0_ns",   i_dt,     "dt_b0_ns[8]/D"},
+        };
+        TTree* info = (TTree*)rfile->Get("build_info");
+        if(info){ for(auto& b : ib) info->SetBranchAddress(b.name, b.addr); }
+        else {
+            info = new TTree("build_info", "multi-board runs: boards, offsets, hits, coincidences with board 0");
+            for(auto& b : ib) info->Branch(b.name, b.addr, b.leaf);
+        }
+        info->Fill();
+        if(tree){
+            if(TDirectory* d = tree->GetDirectory()) d->cd();
+            tree->Write("", TObject::kOverwrite);
+        }
+        rfile->cd();
+        info->Write("", TObject::kOverwrite);
+        rfile->Write();
+        rfile->Close();
+        delete rfile;
+    }
+    for(auto& bp : boards){
+        CAEN_DGTZ_FreeReadoutBuffer(&bp->buf);
+        CAEN_DGTZ_CloseDigitizer(bp->handle);
+    }
+    printf("[ok] Collected %llu events.\n", (unsigned long long)written);
+    return 0;
+}
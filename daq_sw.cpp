@@ -6,6 +6,7 @@
 #include <thread>
 #include <chrono>
 #include <csignal>
+#include <cstdio>
 
 #define CHANNEL 0
 #define N_EVENTS 1000
@@ -29,7 +30,7 @@ int main() {
     uint32_t bufferSize;
     void* eventPtr = nullptr;
     CAEN_DGTZ_UINT16_EVENT_t* evt = nullptr;
-    uint32_t bsize, numEvents;
+    uint32_t bsize = 0, numEvents = 0;
 
     // Open digitizer
     ret = CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_USB, 0, 0, 0, &handle);
@@ -49,7 +50,7 @@ int main() {
 
     // Allocate memory
     CAEN_DGTZ_MallocReadoutBuffer(handle, &buffer, &bufferSize);
-    CAEN_DGTZ_AllocateEvent(handle, (void**)&evt);
+    CAEN_DGTZ_AllocateEvent(handle, &eventPtr);  // DecodeEvent fills this one event, no allocation per waveform
 
     // Open ROOT file for output
     TFile* fout = new TFile("waveforms.root", "RECREATE");
@@ -63,6 +64,13 @@ int main() {
     int tried = 0;
     std::cout << "Acquiring " << N_EVENTS << " waveforms and saving to ROOT...\n";
 
+    // One graph, reused for every waveform: the time axis is filled once and only the ADC values,
+    // name and title change per event, so the point arrays are not reallocated per waveform
+    // (Write still creates a key for each).
+    TGraph g(RECORD_LENGTH);
+    for (int s = 0; s < g.GetN(); ++s) g.GetX()[s] = s * SAMPLING_NS;  // time in ns
+    char name[32], title[64];
+
     while (acquired < N_EVENTS && !stop_requested) {
         CAEN_DGTZ_SendSWtrigger(handle);
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -86,17 +94,19 @@ int main() {
 
             int nsamples = evt->ChSize[CHANNEL];
             if (nsamples > 0) {
-                std::vector<double> x(nsamples), y(nsamples);
-                for (int s = 0; s < nsamples; ++s) {
-                    x[s] = s * SAMPLING_NS;                      // time in ns
-                    y[s] = (double)evt->DataChannel[CHANNEL][s]; // ADC value
+                if (nsamples != g.GetN()) {  // record length differs from the request: resize once
+                    g.Set(nsamples);
+                    for (int s = 0; s < nsamples; ++s) g.GetX()[s] = s * SAMPLING_NS;
                 }
+                double* y = g.GetY();
+                for (int s = 0; s < nsamples; ++s)
+                    y[s] = (double)evt->DataChannel[CHANNEL][s]; // ADC value
 
-                TString name = Form("waveform_%03d", acquired);
-                TGraph* g = new TGraph(nsamples, x.data(), y.data());
-                g->SetName(name);
-                g->SetTitle(Form("Waveform %d;Time (ns);ADC", acquired));
-                g->Write();
+                snprintf(name, sizeof(name), "waveform_%03d", acquired);
+                snprintf(title, sizeof(title), "Waveform %d;Time (ns);ADC", acquired);
+                g.SetName(name);
+                g.SetTitle(title);
+                g.Write();
 
                 std::cout << "Saved waveform " << acquired << "\n";
                 acquired++;
@@ -1,6 +1,7 @@
 // DT5730S minimal acquisition – self/ext/sw triggering for X730 family
 // v28: ROOT output with per-run tag subdirectory + start/end ADC temperature tree
-// Build: g++ -O2 -std=c++17 daq_threshold_v28.cpp -o daq_threshold_v28 $(root-config --cflags --libs) -lCAENDigitizer
+// Build: g++ -O2 -std=c++17 -I. daq_threshold_v28.cpp -o daq_threshold_v28 $(root-config --cflags --libs) -lCAENDigitizer -pthread
+// Sim:   g++ -O2 -std=c++17 -I. -Isim daq_threshold_v28.cpp -o daq_threshold_sim $(root-config --cflags --libs) -pthread
 
 /*
 
@@ -15,6 +16,50 @@
 
 # 4) Also dump text alongside ROOT
 ./daq_threshold_v28 -n 50 -m self -t 5 -c 0 --root pulses.root --txtdir txt_out
+#    ... or 1000 events per text file (waveform_0-999.txt, ...)
+./daq_threshold_v28 -n 10000 -m self -t 5 -c 0 --txtdir txt_out --txt-chunk 1000
+
+# 5) Raw dump: undecoded readout blocks only, decode offline with utils/raw2root
+./daq_threshold_v28 -n 10000 -m self -t 5 -c 0 --raw run.x7raw
+
+# 6) Columnar output: one 'waves' TTree per tag instead of one TH1I key per event
+./daq_threshold_v28 -n 10000 -m self -t 5 -c 0 --root run.root --format tree --compress zstd:5
+# ... or with the samples delta/bit-packed (common/wavecodec.h), cheap LZ4 on top
+./daq_threshold_v28 -n 10000 -m self -t 5 -c 0 --root run.root --format packed --compress lz4
+
+# 6b) Software ZLE: store only samples within 16 before / 48 after those 30 counts below the pedestal
+./daq_threshold_v28 -n 100000 -m self -t 5 -c 0 --root run.root --format packed --zle 30 --zle-margin 16,48
+
+# 6c) Live stream: 20 waveforms/s plus rates and temperatures in /dev/shm/daq_live (utils/daqlive reads it)
+./daq_threshold_v28 -n 1000000 -m self -t 5 -c 0 --root run.root --features --keep-frac 0 --live /daq_live
+
+# 6d) ADC temperatures every 10 s during a long run ('temps' tree, t_ns on the event clock)
+./daq_threshold_v28 -n 1000000 -m self -t 5 -c 0 --root run.root --format tree --temp-every 10
+
+# 6e) Continuous: never stop the board, new file every 30 min or 2 GB (run_r<run>_s<subrun>.root); Ctrl-C drains and finalizes
+./daq_threshold_v28 -m self -t 5 -c 0 --continuous --rotate-s 1800 --rotate-mb 2000 --root run.root --format packed
+
+# 7) Trigger on ch0/1, store ch0..3 (only channels in the save mask are read out)
+./daq_threshold_v28 -n 1000 -m self -t 5 -c 0 --save-mask 0x0F --root run.root --format tree
+
+# 8) Online pulse features for every event, full waveforms for 1% of them
+./daq_threshold_v28 -n 100000 -m self -t 5 -c 0 --root run.root --format tree --features --keep-frac 0.01
+
+# 8b) Self trigger plus 20 software triggers/s; baseline events go to tag 'self_baseline' of the same file
+./daq_threshold_v28 -n 100000 -m self -t 5 -c 0 --sw-rate 20 --root run.root --format tree --features
+
+# 8c) Baseline noise of the SW events: per-sample mean/rms and the averaged PSD in 'sw/noise'
+./daq_threshold_v28 -n 2000 -m sw -c 0 --save-mask 0x0F --root run.root --format tree --noise
+
+# 9) SW run with 32 triggers in flight and interrupt-driven readout
+./daq_threshold_v28 -n 1000 -m sw --sw-burst 32 --readout irq --irq-events 16 --root run.root
+
+# 10) Keep the board open and take runs/temperature requests from utils/daqctl
+./daq_threshold_v28 --daemon /home/ANNIE/daq/.daq.sock
+utils/daqctl RUN -n 200 -m sw --root /home/ANNIE/daq/data/run_all.root
+
+# 11) Per-stage latency histograms go to the 'perf' tree; also append them as Influx line protocol
+./daq_threshold_v28 -n 10000 -m self -t 5 -c 0 --root run.root --format tree --perf-lp perf.lp --evt-rate 0
 
 */
 
@@ -28,22 +73,57 @@
 #include <thread>
 #include <chrono>
 #include <algorithm>
-#include <fstream>
 #include <vector>
 #include <limits>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <memory>
+#include <csignal>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
 #include <errno.h>
 
 // ROOT
 #include <TFile.h>
 #include <TDirectory.h>
 #include <TH1I.h>
+#include <TH1D.h>
+#include <TH2F.h>
 #include <TTree.h>
+#include <TROOT.h>
+
+#include "common/spsc_ring.h"
+#include "common/waves_tree.h"
+#include "common/rawfile.h"
+#include "common/x730.h"
+#include "common/features.h"
+#include "common/daq_socket.h"
+#include "common/board_config.h"
+#include "common/perf.h"
+#include "common/text_writer.h"
+#include "common/run_clock.h"
+#include "common/pedestal.h"
+#include "common/spectra.h"
+#include "common/zle.h"
+#include "common/live_shm.h"
+#include "common/noise.h"
+
+// A failed CAEN call aborts the current run (the stage threads stop the others and the
+// output is finalized); the CLI then exits 1, --daemon reports it and keeps serving.
+struct DaqError : std::runtime_error { using std::runtime_error::runtime_error; };
 
 static void die(const char* where, CAEN_DGTZ_ErrorCode ec){
     fprintf(stderr,"[ERR] %s failed (code=%d)\n", where, ec);
-    std::exit(1);
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%s failed (code=%d)", where, ec);
+    throw DaqError(msg);
 }
 static void ok(const char* where, CAEN_DGTZ_ErrorCode ec){
     if(ec!=CAEN_DGTZ_Success) die(where,ec);
@@ -63,45 +143,188 @@ static void ensure_dir_exists(const std::string& dir){
     }
 }
 
-static uint32_t measure_pedestal(int handle, int ch, uint32_t maxSamp=200){
-    char* rbuf=nullptr; uint32_t rsz=0;
-    ok("MallocReadoutBuffer", CAEN_DGTZ_MallocReadoutBuffer(handle,&rbuf,&rsz));
-    void* evt=nullptr; ok("AllocateEvent", CAEN_DGTZ_AllocateEvent(handle,&evt));
+static double thread_cpu_sec(){
+    timespec ts{}; clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
 
-    ok("SetSWTriggerMode", CAEN_DGTZ_SetSWTriggerMode(handle, CAEN_DGTZ_TRGMODE_ACQ_ONLY));
-    ok("SWStartAcquisition", CAEN_DGTZ_SWStartAcquisition(handle));
-    ok("SendSWtrigger", CAEN_DGTZ_SendSWtrigger(handle));
-    std::this_thread::sleep_for(std::chrono::milliseconds(2));
-
-    uint32_t bsz=0; ok("ReadData", CAEN_DGTZ_ReadData(handle, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT, rbuf, &bsz));
-    ok("SWStopAcquisition", CAEN_DGTZ_SWStopAcquisition(handle));
-
-    uint32_t nev=0; ok("GetNumEvents", CAEN_DGTZ_GetNumEvents(handle, rbuf, bsz, &nev));
-    if(nev==0 || bsz==0){
-        fprintf(stderr,"[warn] pedestal: no data, using midscale\n");
-        CAEN_DGTZ_FreeEvent(handle,&evt);
-        CAEN_DGTZ_FreeReadoutBuffer(&rbuf);
-        return 0x8000;
-    }
-    CAEN_DGTZ_EventInfo_t info; char* ep=nullptr;
-    ok("GetEventInfo", CAEN_DGTZ_GetEventInfo(handle, rbuf, bsz, 0, &info, &ep));
-    ok("DecodeEvent", CAEN_DGTZ_DecodeEvent(handle, ep, &evt));
-    auto* e = (CAEN_DGTZ_UINT16_EVENT_t*)evt;
-
-    if(!e || ch<0 || ch>=8 || e->ChSize[ch]==0){
-        fprintf(stderr,"[warn] pedestal: empty channel, midscale\n");
-        CAEN_DGTZ_FreeEvent(handle,&evt);
-        CAEN_DGTZ_FreeReadoutBuffer(&rbuf);
-        return 0x8000;
-    }
-    uint32_t n = std::min<uint32_t>(e->ChSize[ch], maxSamp);
-    uint64_t sum=0;
-    for(uint32_t i=0;i<n;++i) sum += e->DataChannel[ch][i];
-    uint32_t ped = (uint32_t)(sum/(n?n:1));
-
-    CAEN_DGTZ_FreeEvent(handle,&evt);
-    CAEN_DGTZ_FreeReadoutBuffer(&rbuf);
-    return ped;
+// Registers as last programmed on the open board; survives between runs of one daemon.
+struct BoardState { bool known=false; uint32_t serial=0; BoardConfig cfg; BoardSignature sig; };
+static BoardState g_board;
+
+// Default --cfg-cache: <dir of the executable>/state, next to state/run_number.txt.
+static std::string default_state_dir(){
+    char exe[4096];
+    const ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe)-1);
+    if(n<=0) return "state";
+    std::string d(exe, (size_t)n);
+    const size_t slash = d.rfind('/');
+    return (slash==std::string::npos ? std::string(".") : d.substr(0, slash)) + "/state";
+}
+
+// SIGINT/SIGTERM: the running acquisition stops the board, drains what it holds and finalizes its
+// files; an idle --daemon stops serving. A second signal exits at once, without finalizing.
+static std::atomic<int> g_stopSignal{0};
+static std::atomic<int> g_listenFd{-1};
+static void on_stop_signal(int sig){
+    if(g_stopSignal.exchange(sig)){
+        static const char msg[] = "[stop] second signal: exiting without finalizing\n";
+        if(write(2, msg, sizeof(msg)-1) < 0){}
+        _exit(128+sig);
+    }
+    const int fd = g_listenFd.load();
+    if(fd>=0) shutdown(fd, SHUT_RDWR); // wakes accept()
+}
+
+// Next run number from the counter next_run_number.sh keeps (same file, lock and %06d format),
+// so runs numbered by the orchestrator and by --continuous never collide. 0 on failure.
+static uint32_t next_run_number(const std::string& runFile){
+    const size_t slash = runFile.rfind('/');
+    const std::string dir = slash==std::string::npos ? std::string(".") : runFile.substr(0, slash);
+    ensure_dir_exists(dir);
+    const int lk = open((dir + "/run_number.lock").c_str(), O_CREAT|O_RDWR|O_CLOEXEC, 0644);
+    if(lk<0 || flock(lk, LOCK_EX)!=0){ if(lk>=0) close(lk); return 0; }
+    unsigned long cur = 0;
+    if(FILE* f = fopen(runFile.c_str(), "r")){
+        char b[32] = {};
+        if(fgets(b, sizeof(b), f)) cur = std::strtoul(b, nullptr, 10);
+        fclose(f);
+    }
+    const uint32_t next = (uint32_t)cur + 1;
+    FILE* f = fopen(runFile.c_str(), "w");
+    const bool good = f && fprintf(f, "%06u\n", next) > 0;
+    if(f) fclose(f);
+    close(lk); // releases the lock
+    return good ? next : 0;
+}
+
+static bool fsync_path(const std::string& path){
+    const int fd = open(path.c_str(), O_RDONLY|O_CLOEXEC);
+    if(fd<0) return false;
+    const bool good = fsync(fd)==0;
+    close(fd);
+    return good;
+}
+
+// --rotate-*: a finished file is written out, closed and fsync'ed on this thread while the write
+// stage fills the next one. One file in flight: a rotation that finds the previous close still
+// running waits for it (the disk is not keeping up anyway) and the wait is reported.
+struct FileCloser {
+    struct Job { TFile* file=nullptr; std::vector<TTree*> trees; std::string path; uint32_t subrun=0; uint64_t events=0; };
+
+    ~FileCloser(){ stop(); }
+    void submit(Job j){
+        if(!th.joinable()) th = std::thread([this]{ run_(); });
+        std::unique_lock<std::mutex> lk(m);
+        const uint64_t t0 = perf_now_ns();
+        cv.wait(lk, [&]{ return !busy; });
+        waitMs += (perf_now_ns() - t0)*1e-6;
+        job = std::move(j); busy = true;
+        cv.notify_all();
+    }
+    // Finishes the file in flight.
+    void stop(){
+        if(!th.joinable()) return;
+        { std::lock_guard<std::mutex> lk(m); quit = true; }
+        cv.notify_all();
+        th.join();
+    }
+    uint32_t closed = 0;
+    double waitMs = 0, closeMs = 0;
+
+private:
+    void run_(){
+        for(;;){
+            Job j;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                cv.wait(lk, [&]{ return busy || quit; });
+                if(!busy) return;
+                j = std::move(job);
+            }
+            const uint64_t t0 = perf_now_ns();
+            for(TTree* t : j.trees){
+                if(!t) continue;
+                if(TDirectory* d = t->GetDirectory()) d->cd();
+                t->Write("", TObject::kOverwrite);
+            }
+            j.file->cd();
+            j.file->Write();
+            j.file->Close();
+            delete j.file;
+            const bool synced = fsync_path(j.path);
+            const double ms = (perf_now_ns() - t0)*1e-6;
+            printf("[rotate] closed subrun %u: %llu events -> %s (%.1f ms%s)\n", j.subrun, (unsigned long long)j.events,
+                   j.path.c_str(), ms, synced ? ", fsync'ed" : ", fsync failed");
+            fflush(stdout);
+            std::lock_guard<std::mutex> lk(m);
+            busy = false; closed++; closeMs += ms;
+            cv.notify_all();
+        }
+    }
+    std::mutex m;
+    std::condition_variable cv;
+    bool busy = false, quit = false;
+    Job job;
+    std::thread th;
+};
+
+// Spectra snapshot as TH1D q_ch<c> (long-gate charge) and TH2F psd_ch<c> (charge vs tail/total),
+// overwriting the previous snapshot in dir.
+static void write_spectra(const Spectra& sp, TDirectory* dir){
+    const SpectraAxes& ax = sp.axes();
+    dir->cd();
+    for(int c=0;c<8;++c){
+        if(!((sp.mask()>>c)&1)) continue;
+        char name[32], title[128];
+        snprintf(name, sizeof(name), "q_ch%d", c);
+        snprintf(title, sizeof(title), "ch %d long-gate charge;Q_{long} (ADC x samples);events", c);
+        TH1D hq(name, title, ax.qBins, 0.0, ax.qMax);
+        const std::vector<uint64_t>& q = sp.charge(c);
+        double n = 0;
+        for(int b=0;b<=ax.qBins+1;++b){ hq.SetBinContent(b, (double)q[b]); n += (double)q[b]; }
+        hq.SetEntries(n);
+        hq.Write("", TObject::kOverwrite);
+        snprintf(name, sizeof(name), "psd_ch%d", c);
+        snprintf(title, sizeof(title), "ch %d PSD;Q_{long} (ADC x samples);(Q_{long}-Q_{short})/Q_{long}", c);
+        TH2F hp(name, title, ax.q2Bins, 0.0, ax.qMax, ax.psdBins, 0.0, 1.0);
+        for(int pb=0;pb<=ax.psdBins+1;++pb)
+            for(int qb=0;qb<=ax.q2Bins+1;++qb) hp.SetBinContent(qb, pb, (double)sp.psd_bin(c, qb, pb));
+        hp.SetEntries(n);
+        hp.Write("", TObject::kOverwrite);
+    }
+}
+
+// Noise snapshot as TH1D noise_mean_ch<c> (per-sample mean, error = rms), noise_rms_ch<c> and
+// noise_psd_ch<c> (one-sided PSD in ADC^2/Hz vs MHz), overwriting the previous one in dir.
+static void write_noise(const NoiseAccum& na, TDirectory* dir){
+    dir->cd();
+    const uint32_t ns = na.rec_len(), nb = na.nfft()/2 + 1;
+    const double df = na.df_hz()*1e-6;
+    for(int c=0;c<8;++c){
+        if(!((na.mask()>>c)&1) || !na.events(c)) continue;
+        char name[32], title[128];
+        snprintf(name, sizeof(name), "noise_mean_ch%d", c);
+        snprintf(title, sizeof(title), "ch %d baseline mean (error: rms), %llu events;sample;ADC", c, (unsigned long long)na.events(c));
+        TH1D hm(name, title, ns, 0.0, ns);
+        snprintf(name, sizeof(name), "noise_rms_ch%d", c);
+        snprintf(title, sizeof(title), "ch %d baseline rms;sample;ADC", c);
+        TH1D hr(name, title, ns, 0.0, ns);
+        for(uint32_t i=0;i<ns;++i){
+            const double r = std::sqrt(na.var(c, i));
+            hm.SetBinContent(i+1, na.mean(c, i)); hm.SetBinError(i+1, r);
+            hr.SetBinContent(i+1, r);
+        }
+        hm.SetEntries((double)na.events(c)); hr.SetEntries((double)na.events(c));
+        snprintf(name, sizeof(name), "noise_psd_ch%d", c);
+        snprintf(title, sizeof(title), "ch %d noise PSD (%u-sample Hann);f (MHz);ADC^{2}/Hz", c, na.nfft());
+        TH1D hp(name, title, nb, -0.5*df, (nb - 0.5)*df);
+        for(uint32_t k=0;k<nb;++k) hp.SetBinContent(k+1, na.psd(c, k));
+        hp.SetEntries((double)na.events(c));
+        hm.Write("", TObject::kOverwrite);
+        hr.Write("", TObject::kOverwrite);
+        hp.Write("", TObject::kOverwrite);
+    }
 }
 
 static void read_temperatures(int handle, std::vector<uint32_t>& temps /*size 8, UINT_MAX on failure*/){
@@ -114,107 +337,441 @@ static void read_temperatures(int handle, std::vector<uint32_t>& temps /*size 8,
     }
 }
 
-int main(int argc,char**argv){
+// Temperature requests that arrive while a run owns the board (--daemon TEMP) are served by
+// the readout thread between two ReadData calls, so they never contend for the handle.
+struct TempService {
+    std::mutex m;
+    std::condition_variable cv;
+    std::atomic<bool> pending{false};
+    uint64_t served = 0;
+    std::vector<uint32_t> last;
+
+    void poll(int handle){
+        if(!pending.load(std::memory_order_relaxed)) return;
+        std::vector<uint32_t> t;
+        read_temperatures(handle, t);
+        std::lock_guard<std::mutex> lk(m);
+        last = t; served++; pending = false;
+        cv.notify_all();
+    }
+    bool request(std::vector<uint32_t>& out, std::chrono::milliseconds timeout){
+        std::unique_lock<std::mutex> lk(m);
+        const uint64_t before = served;
+        pending = true;
+        if(!cv.wait_for(lk, timeout, [&]{ return served!=before; })) return false;
+        out = last;
+        return true;
+    }
+};
+static TempService g_temps;
+
+// In-run temperature samples (--temp-every s). The readout thread reads one channel at a time and
+// only right after a ReadData that found the board empty, where the poller would sleep anyway, so
+// the 8 serial register reads never sit in front of a ReadData with data waiting. A board that is
+// not once empty for two intervals gets one channel read after each ReadData instead.
+// t_ns is the host's steady clock since SWStartAcquisition, the origin of the events' t_ns.
+struct TempSample { uint64_t tNs = 0, wallNs = 0; uint32_t temp[8]; };
+struct TempSampler {
+    uint64_t everyNs = 0, acq0Ns = 0, dueNs = 0;
+    int ch = -1;                    // next channel of the sample being taken (-1 = none due)
+    TempSample cur;
+    uint64_t forced = 0;            // channel reads that could not wait for an empty board
+    std::mutex m;
+    std::vector<TempSample> done;   // appended by the readout thread, drained by the write stage
+    std::atomic<size_t> ndone{0};
+
+    void start(double everyS, uint64_t acq0){
+        everyNs = everyS>0 ? (uint64_t)(everyS*1e9) : 0;
+        acq0Ns = acq0; dueNs = acq0 + everyNs; ch = -1; forced = 0;
+        std::lock_guard<std::mutex> lk(m);
+        done.clear(); ndone = 0;
+    }
+    // idle: the last ReadData returned nothing
+    void step(int handle, bool idle){
+        if(!everyNs) return;
+        const uint64_t now = perf_now_ns();
+        if(now < dueNs) return;
+        if(!idle){
+            if(now < dueNs + 2*everyNs) return;
+            forced++;
+        }
+        if(ch < 0){ ch = 0; cur.tNs = now - acq0Ns; cur.wallNs = wall_ns(); }
+        uint32_t t = 0;
+        cur.temp[ch] = CAEN_DGTZ_ReadTemperature(handle, ch, &t)==CAEN_DGTZ_Success ? t : std::numeric_limits<uint32_t>::max();
+        if(++ch < 8) return;
+        ch = -1;
+        dueNs = std::max(dueNs + everyNs, now);
+        std::lock_guard<std::mutex> lk(m);
+        done.push_back(cur);
+        ndone.store(done.size(), std::memory_order_release);
+    }
+    // Samples [from, ndone) for the write stage.
+    void take(size_t from, std::vector<TempSample>& out){
+        std::lock_guard<std::mutex> lk(m);
+        out.assign(done.begin() + std::min(from, done.size()), done.end());
+    }
+};
+
+// Per-event trigger source (features 'trig_src'), CAEN's bit order.
+enum TrigSrc : uint8_t { kSrcSelf = 1, kSrcSw = 2, kSrcExt = 4 };
+
+// --sw-rate: software triggers run alongside the self trigger. The board ORs the sources and does
+// not report which one fired, so an event counts as self-triggered when a channel of the trigger
+// pair reaches its threshold within kTrigWin samples of the trigger point; otherwise it is a
+// software (baseline) event. A software trigger that lands on a pulse is a self trigger.
+constexpr uint32_t kTrigWin = 64;
+static bool crosses_packed(const uint32_t* w, uint32_t nwords, uint32_t from, uint32_t to, uint32_t thr){
+    for(uint32_t k=from/2; k<nwords && 2*k<to; ++k)
+        if((w[k] & 0x3FFF) <= thr || ((w[k]>>16) & 0x3FFF) <= thr) return true;
+    return false;
+}
+static bool crosses(const uint16_t* s, uint32_t ns, uint32_t from, uint32_t to, uint32_t thr){
+    for(uint32_t i=from; i<ns && i<to; ++i) if(s[i] <= thr) return true;
+    return false;
+}
+
+static void usage(const char* prog){
+    printf("Usage: %s [-n N] [-m sw|self|ext] [-c ch] [-r recLen] [--post %%] [-t delta] [--link n]\n"
+           "            [--txt file] [--txtdir dir] [--txt-chunk n] [--root file.root] [--tag name]\n"
+           "            [--nbuf n] [--nevt n] [--stages r|rd|rdw]\n"
+           "            [--format th1|tree|packed] [--basket bytes] [--compress alg[:level]]\n"
+           "            [--raw file] [--save-mask 0xMM] [--decoder native|caen]\n"
+           "            [--features] [--keep-frac f] [--cfd-frac f]\n"
+           "            [--spectra] [--gates pre,short,long] [--q-max q] [--fom-qmin q] [--spectra-snap s]\n"
+           "            [--zle thr] [--zle-margin pre,post] [--zle-bipolar]\n"
+           "            [--live /name] [--live-hz f] [--live-slots n] [--temp-every s]\n"
+           "            [--readout poll|irq] [--irq-events n] [--irq-timeout ms] [--sw-burst n]\n"
+           "            [--sw-rate hz] [--baseline-tag name] [--noise]\n"
+           "            [--cfg-cache dir|none] [--evt-rate hz] [--perf-lp file|-]\n"
+           "            [--ped-events M] [--ped-temp-step C] [--ped-max-age s]\n"
+           "            [--continuous] [--rotate-events n] [--rotate-mb m] [--rotate-s s] [--run-number n] [--run-file f]\n"
+           "       %s --daemon socket [--link n]   (keep the board open; runs come from utils/daqctl)\n", prog, prog);
+}
+
+struct RunSummary { int events=0; double setupMs=0, acqSec=0; };
+
+// One acquisition on an already opened board. 'args' are the command-line options (or the
+// tokens of a daemon RUN request). Returns 0 on success, 2 on bad options, 1 on failure.
+static int run_acquisition(int handle, const CAEN_DGTZ_BoardInfo_t& bi, const std::vector<std::string>& args,
+                           RunSummary* summary=nullptr){
+    const auto tSetup0 = std::chrono::steady_clock::now();
     int N=10;
     std::string trig="self"; // sw | self | ext
-    int link=0;
     int ch=0;
     int recLen=1024;
     int post=50;                  // %
     uint32_t delta=120;           // relative threshold (ADC) below pedestal for negative pulses
     std::string txt = "";         // single text file (append)
     std::string txtdir = "";      // directory of one file per event
+    int txtChunk = 1;             // --txtdir: events per file
     std::string rootOut = "";     // root output file
     std::string tag = "";         // subdirectory in ROOT; defaults to trigger mode
+    int nbuf=4;                   // readout buffers in flight between readout and decode
+    int nevt=1024;                // decoded events in flight between decode and write
+    std::string stages = "rdw";   // r=readout, d=decode, w=write (benchmarking: drop d/w)
+    std::string format = "th1";   // th1 = one TH1I key per event | tree = 'waves' TTree per tag | packed = tree, codec samples
+    int basket = 0;               // TTree basket size in bytes (0 = ROOT default)
+    std::string compress = "";    // e.g. zstd:5, lz4:4, zlib:1, lzma:6 (empty = ROOT default)
+    std::string rawOut = "";      // append undecoded readout blocks here (no decode/ROOT waveforms)
+    uint32_t saveMask = 0;        // channels to store; 0 = just -c ch
+    std::string decoder = "native"; // native = common/x730.h block walker | caen = GetEventInfo/DecodeEvent
+    bool features = false;        // per-event pulse features into a 'features' tree
+    double keepFrac = 1.0;        // fraction of events whose full waveforms are stored
+    float cfdFrac = 0.2f;         // constant fraction for the CFD timestamp
+    bool spectra = false;         // online charge and PSD histograms (common/spectra.h)
+    PsdGates gates;               // --gates pre,short,long (samples)
+    SpectraAxes axes;             // --q-max sets the charge range
+    double fomQMin = 2000;        // long-gate charge above which the PSD FOM is computed
+    double spectraSnap = 60;      // s between spectra snapshots into the ROOT file (0 = end only)
+    uint32_t zleThr = 0;          // software ZLE: counts below the pedestal that open a region (0 = off)
+    uint32_t zlePre = 16, zlePost = 48; // samples kept before/after the samples over threshold
+    bool zleBipolar = false;      // ZLE also on excursions above the pedestal
+    std::string liveName = "";    // POSIX shm name of the live monitoring stream (empty = off)
+    double liveHz = 20;           // waveforms per second published to it
+    int liveSlots = 64;           // records kept in its ring
+    double tempEvery = 60;        // in-run temperature sample interval in s (0 = start and end only)
+    std::string readoutMode = "poll"; // poll = adaptive poller | irq = IRQWait on event count
+    int irqEvents = 1;            // interrupt when this many events are ready
+    uint32_t irqTimeoutMs = 100;  // IRQWait timeout; ReadData runs anyway after it
+    int swBurst = 1;              // SW mode: triggers kept in flight
+    double swRate = 0;            // self mode: software (baseline) triggers per second alongside (0 = off)
+    std::string baseTag = "";     // their tag directory; defaults to <tag>_baseline
+    bool noise = false;           // online noise mean/rms/PSD of the software-triggered events (common/noise.h)
+    std::string cfgCache = default_state_dir(); // board config cache dir | none = always Reset + full programming
+    double evtRate = 1.0;         // [evt] lines per second (the first event always prints; 0 = none)
+    std::string perfLp = "";      // append the run's perf summary as Influx line protocol ('-' = stdout)
+    int pedEvents = 32;           // events averaged by the pedestal/noise calibration
+    uint32_t pedTempStep = 2;     // C per temperature bucket of the pedestal cache
+    double pedMaxAge = 86400;     // s a cached pedestal stays valid (0 = measure every run)
+    bool continuous = false;      // ignore -n: acquire until SIGINT/SIGTERM
+    uint64_t rotateEvents = 0;    // start a new ROOT file after this many events (0 = off)
+    double rotateMB = 0;          // ... or once this many MB were written to it
+    double rotateS = 0;           // ... or after this many s with events in it
+    uint32_t runNumber = 0;       // 0 = next from --run-file when rotating or continuous
+    std::string runFile = default_state_dir() + "/run_number.txt";
 
-    auto need = [&](const char*o, int& i)->char*{
-        if(i+1>=argc){ fprintf(stderr,"missing after %s\n",o); std::exit(2); }
-        return argv[++i];
+    bool badArgs = false;
+    auto need = [&](const char*o, size_t& i)->const char*{
+        if(i+1>=args.size()){ fprintf(stderr,"missing after %s\n",o); badArgs=true; return "0"; }
+        return args[++i].c_str();
     };
 
-    for(int i=1;i<argc;++i){
-        std::string a=argv[i];
+    for(size_t i=0;i<args.size();++i){
+        const std::string& a=args[i];
         if(a=="-n") N=std::atoi(need("-n",i));
         else if(a=="-m"||a=="--trigger") trig=need("-m",i);
-        else if(a=="--link") link=std::atoi(need("--link",i));
+        else if(a=="--link" || a=="--daemon") need(a.c_str(),i); // handled by main()
         else if(a=="-c") ch=std::atoi(need("-c",i));
         else if(a=="-r") recLen=std::atoi(need("-r",i));
         else if(a=="--post") post=std::atoi(need("--post",i));
         else if(a=="-t") delta=(uint32_t)std::atoi(need("-t",i));
         else if(a=="--txt") txt = need("--txt",i);
         else if(a=="--txtdir") txtdir = need("--txtdir",i);
+        else if(a=="--txt-chunk") txtChunk = std::max(1, std::atoi(need("--txt-chunk",i)));
         else if(a=="--root") rootOut = need("--root",i);
         else if(a=="--tag") tag = need("--tag",i);
-        else if(a=="-h"||a=="--help"){
-            printf("Usage: %s [-n N] [-m sw|self|ext] [-c ch] [-r recLen] [--post %%] [-t delta]\n"
-                   "            [--txt file] [--txtdir dir] [--root file.root] [--tag name]\n", argv[0]);
-            return 0;
+        else if(a=="--nbuf") nbuf = std::max(1, std::atoi(need("--nbuf",i)));
+        else if(a=="--nevt") nevt = std::max(1, std::atoi(need("--nevt",i)));
+        else if(a=="--stages") stages = need("--stages",i);
+        else if(a=="--format") format = need("--format",i);
+        else if(a=="--basket") basket = std::atoi(need("--basket",i));
+        else if(a=="--compress") compress = need("--compress",i);
+        else if(a=="--raw") rawOut = need("--raw",i);
+        else if(a=="--decoder") decoder = need("--decoder",i);
+        else if(a=="--features") features = true;
+        else if(a=="--keep-frac") keepFrac = std::atof(need("--keep-frac",i));
+        else if(a=="--cfd-frac") cfdFrac = (float)std::atof(need("--cfd-frac",i));
+        else if(a=="--spectra") spectra = true;
+        else if(a=="--gates"){
+            unsigned g0=0, g1=0, g2=0;
+            if(std::sscanf(need("--gates",i), "%u,%u,%u", &g0, &g1, &g2)!=3 || g1==0 || g2<g1){
+                fprintf(stderr,"[ERR] --gates needs pre,short,long with 0 < short <= long\n"); return 2;
+            }
+            gates.pre = g0; gates.shortLen = g1; gates.longLen = g2;
+        }
+        else if(a=="--q-max") axes.qMax = std::max(1.0, std::atof(need("--q-max",i)));
+        else if(a=="--fom-qmin") fomQMin = std::atof(need("--fom-qmin",i));
+        else if(a=="--spectra-snap") spectraSnap = std::atof(need("--spectra-snap",i));
+        else if(a=="--zle") zleThr = (uint32_t)std::max(0, std::atoi(need("--zle",i)));
+        else if(a=="--zle-margin"){
+            if(std::sscanf(need("--zle-margin",i), "%u,%u", &zlePre, &zlePost)!=2){
+                fprintf(stderr,"[ERR] --zle-margin needs pre,post (samples)\n"); return 2;
+            }
         }
+        else if(a=="--zle-bipolar") zleBipolar = true;
+        else if(a=="--live") liveName = need("--live",i);
+        else if(a=="--live-hz") liveHz = std::atof(need("--live-hz",i));
+        else if(a=="--live-slots") liveSlots = std::max(2, std::min(65536, std::atoi(need("--live-slots",i))));
+        else if(a=="--temp-every") tempEvery = std::max(0.0, std::atof(need("--temp-every",i)));
+        else if(a=="--readout") readoutMode = need("--readout",i);
+        else if(a=="--irq-events") irqEvents = std::max(1, std::min(1023, std::atoi(need("--irq-events",i))));
+        else if(a=="--irq-timeout") irqTimeoutMs = (uint32_t)std::max(1, std::atoi(need("--irq-timeout",i)));
+        else if(a=="--sw-rate") swRate = std::max(0.0, std::atof(need("--sw-rate",i)));
+        else if(a=="--baseline-tag") baseTag = need("--baseline-tag",i);
+        else if(a=="--noise") noise = true;
+        else if(a=="--sw-burst") swBurst = std::max(1, std::min(1023, std::atoi(need("--sw-burst",i))));
+        else if(a=="--cfg-cache") cfgCache = need("--cfg-cache",i);
+        else if(a=="--evt-rate") evtRate = std::atof(need("--evt-rate",i));
+        else if(a=="--perf-lp") perfLp = need("--perf-lp",i);
+        else if(a=="--ped-events") pedEvents = std::max(1, std::min(1000, std::atoi(need("--ped-events",i))));
+        else if(a=="--ped-temp-step") pedTempStep = (uint32_t)std::max(1, std::atoi(need("--ped-temp-step",i)));
+        else if(a=="--ped-max-age") pedMaxAge = std::atof(need("--ped-max-age",i));
+        else if(a=="--continuous") continuous = true;
+        else if(a=="--rotate-events") rotateEvents = std::strtoull(need("--rotate-events",i), nullptr, 10);
+        else if(a=="--rotate-mb") rotateMB = std::max(0.0, std::atof(need("--rotate-mb",i)));
+        else if(a=="--rotate-s") rotateS = std::max(0.0, std::atof(need("--rotate-s",i)));
+        else if(a=="--run-number") runNumber = (uint32_t)std::strtoul(need("--run-number",i), nullptr, 10);
+        else if(a=="--run-file") runFile = need("--run-file",i);
+        else if(a=="--save-mask") saveMask = (uint32_t)std::strtoul(need("--save-mask",i), nullptr, 0) & 0xFF;
     }
+    if(badArgs) return 2;
     if(tag.empty()) tag = trig;
+    if(baseTag.empty()) baseTag = tag + "_baseline";
+    keepFrac = std::min(1.0, std::max(0.0, keepFrac));
+    if(ch<0 || ch>=8){ fprintf(stderr,"[ERR] -c must be 0..7\n"); return 2; }
+    if(saveMask==0) saveMask = 1u<<ch;
 
-    printf("[info] N=%d, trig=%s, link=%d, ch=%d, recLen=%d, post=%d%%, delta=%u\n",
-           N, trig.c_str(), link, ch, recLen, post, delta);
-    if(!txt.empty())    printf("[info] txt='%s'\n", txt.c_str());
-    if(!txtdir.empty()){ printf("[info] txtdir='%s'\n", txtdir.c_str()); ensure_dir_exists(txtdir); }
-    if(!rootOut.empty()) printf("[info] root='%s' tag='%s'\n", rootOut.c_str(), tag.c_str());
+    // WaveDump-style pair arming (0–1,2–3,...)
+    const int pair_base = (ch % 2 == 0) ? ch : (ch-1);
+    const uint32_t pair_mask = (1u << pair_base) | (1u << (pair_base+1));
 
-    // Open & reset
-    int handle=-1;
-    ok("OpenDigitizer", CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_USB, link, 0, 0, &handle));
-    ok("Reset", CAEN_DGTZ_Reset(handle));
+    // Only enabled channels travel over the link: saved channels, the pedestal channel,
+    // and in self mode the trigger pair (a disabled x730 channel does not self-trigger).
+    const uint32_t enMask = saveMask | (1u<<ch) | (trig=="self" ? pair_mask : 0u);
+    const int nSave = __builtin_popcount(saveMask);
+    if(trig!="sw" && trig!="self" && trig!="ext"){ fprintf(stderr,"[ERR] unknown trigger mode\n"); return 2; }
+    if(readoutMode!="poll" && readoutMode!="irq"){ fprintf(stderr,"[ERR] unknown --readout '%s'\n", readoutMode.c_str()); return 2; }
+    if(decoder!="native" && decoder!="caen"){ fprintf(stderr,"[ERR] unknown --decoder '%s'\n", decoder.c_str()); return 2; }
+    if(format!="th1" && format!="tree" && format!="packed"){ fprintf(stderr,"[ERR] unknown --format '%s'\n", format.c_str()); return 2; }
+    const bool mixed = swRate>0;
+    if(mixed && trig!="self"){ fprintf(stderr,"[ERR] --sw-rate needs -m self\n"); return 2; }
+    if(mixed && !rawOut.empty()){ fprintf(stderr,"[ERR] --sw-rate needs decoding; not with --raw\n"); return 2; }
+    if(zleThr && format=="th1"){ fprintf(stderr,"[ERR] --zle needs --format tree or packed\n"); return 2; }
+    const int compSetting = compress.empty() ? -1 : parse_root_compression(compress);
+    if(!compress.empty() && compSetting<0){ fprintf(stderr,"[ERR] unknown --compress '%s'\n", compress.c_str()); return 2; }
+    const bool rotating = rotateEvents || rotateMB>0 || rotateS>0;
+    if(rotating && rootOut.empty()){ fprintf(stderr,"[ERR] --rotate-* needs --root\n"); return 2; }
+    if(rotating && !rawOut.empty()){ fprintf(stderr,"[ERR] --rotate-* does not apply to --raw\n"); return 2; }
+    const uint64_t maxEv = continuous ? std::numeric_limits<uint64_t>::max() : (uint64_t)std::max(0, N);
+    if(!runNumber && (rotating || continuous)){
+        if(!(runNumber = next_run_number(runFile))){ fprintf(stderr,"[ERR] cannot allocate a run number from '%s'\n", runFile.c_str()); return 1; }
+    }
+    // Rotated files: <stem>_r<run>_s<subrun>.root next to --root
+    auto subrunPath = [&](uint32_t sub){
+        if(!rotating) return rootOut;
+        const size_t dot = rootOut.rfind('.');
+        const bool ext = dot!=std::string::npos && rootOut.find('/', dot)==std::string::npos;
+        char b[32];
+        snprintf(b, sizeof(b), "_r%06u_s%04u", runNumber, sub);
+        return (ext ? rootOut.substr(0, dot) : rootOut) + b + (ext ? rootOut.substr(dot) : std::string(".root"));
+    };
 
-    CAEN_DGTZ_BoardInfo_t bi{}; ok("GetInfo", CAEN_DGTZ_GetInfo(handle, &bi));
-    printf("[board] Model=%s  ROC=%s  AMC=%s  Ch=%u\n", bi.ModelName, bi.ROC_FirmwareRel, bi.AMC_FirmwareRel, bi.Channels);
+    if(continuous) printf("[info] continuous: until SIGINT/SIGTERM (-n ignored)\n");
+    if(runNumber)  printf("[info] run %06u\n", runNumber);
+    if(rotating){
+        char when[128] = {};
+        size_t w = 0;
+        if(rotateEvents) w += snprintf(when+w, sizeof(when)-w, "%llu events", (unsigned long long)rotateEvents);
+        if(rotateMB>0)   w += snprintf(when+w, sizeof(when)-w, "%s%.4g MB", w ? " or " : "", rotateMB);
+        if(rotateS>0)    w += snprintf(when+w, sizeof(when)-w, "%s%.4g s", w ? " or " : "", rotateS);
+        printf("[info] new ROOT file every %s: %s, ...\n", when, subrunPath(0).c_str());
+    }
+    printf("[info] N=%d, trig=%s, ch=%d, recLen=%d, post=%d%%, delta=%u, save=0x%02x, enable=0x%02x\n",
+           N, trig.c_str(), ch, recLen, post, delta, saveMask, enMask);
+    if(!txt.empty())    printf("[info] txt='%s'\n", txt.c_str());
+    if(!txtdir.empty()){ printf("[info] txtdir='%s' (%d events per file)\n", txtdir.c_str(), txtChunk); ensure_dir_exists(txtdir); }
+    if(!rootOut.empty()) printf("[info] root='%s' tag='%s' format=%s\n", rootOut.c_str(), tag.c_str(), format.c_str());
+    if(!rawOut.empty())  printf("[info] raw='%s' (waveforms go to the raw file only)\n", rawOut.c_str());
+    if(mixed)            printf("[info] mixed: %.4g software triggers/s alongside the self trigger, baseline events -> '%s'\n",
+                                swRate, baseTag.c_str());
+    if(features)         printf("[info] features on, keeping waveforms of %.4g of events\n", keepFrac);
+    if(zleThr)           printf("[info] zle: %u counts from the pedestal%s, margins %u/%u samples\n",
+                                zleThr, zleBipolar ? " (both sides)" : "", zlePre, zlePost);
+    if(spectra && !rawOut.empty()){ fprintf(stderr,"[warn] --spectra needs decoding; ignored with --raw\n"); spectra = false; }
+    if(noise && !rawOut.empty()){ fprintf(stderr,"[warn] --noise needs decoding; ignored with --raw\n"); noise = false; }
+    if(noise && trig!="sw" && !mixed){ fprintf(stderr,"[warn] --noise uses software-triggered events: -m sw, or --sw-rate with -m self; ignored\n"); noise = false; }
+    if(noise)            printf("[info] noise on: mean/rms/PSD of the %s events -> '%s/noise'\n",
+                                mixed ? "baseline" : "sw", (mixed ? baseTag : tag).c_str());
+    if(spectra)          printf("[info] spectra on: gates pre=%u short=%u long=%u samples, q-max=%.0f, keeping waveforms of %.4g of events\n",
+                                gates.pre, gates.shortLen, gates.longLen, axes.qMax, keepFrac);
+    if(cfgCache!="none") ensure_dir_exists(cfgCache);
+
+    // Program the board. With a trusted cache (common/board_config.h) only registers that differ
+    // are written; Reset and the 80 ms DC-offset settle happen only when the cache cannot be
+    // trusted or a DC offset changes. Each step is timed for the [time] line.
+    auto tStep = std::chrono::steady_clock::now();
+    std::string steps;
+    auto step = [&](const char* name){
+        const auto now = std::chrono::steady_clock::now();
+        char b[64];
+        snprintf(b, sizeof(b), "%s%s %.1f ms", steps.empty() ? "" : ", ", name,
+                 std::chrono::duration<double, std::milli>(now-tStep).count());
+        steps += b;
+        tStep = now;
+    };
+    const std::string cachePath = cfgCache=="none" ? "" : config_cache_path(cfgCache, bi.SerialNumber);
+    if(!g_board.known || g_board.serial!=bi.SerialNumber){
+        g_board.serial = bi.SerialNumber;
+        if(!cachePath.empty() && load_config_cache(cachePath, bi.SerialNumber, g_board.cfg, g_board.sig)){
+            BoardSignature now;
+            g_board.known = read_signature(handle, now)==CAEN_DGTZ_Success && now==g_board.sig;
+            if(!g_board.known) printf("[cfg] board no longer matches %s; full programming\n", cachePath.c_str());
+        }
+        step("cache");
+    }
+    const uint32_t dcOffset = 0x3333;
+    bool full = !g_board.known;
+    for(int i=0;i<8 && !full;++i) full = g_board.cfg.dcOffset[i]!=dcOffset;
+    // Until programming succeeds neither the in-memory shadow nor the cache file is trusted.
+    g_board.known = false;
+    if(!cachePath.empty()) unlink(cachePath.c_str());
+    if(full){
+        ok("Reset", CAEN_DGTZ_Reset(handle));
+        step("reset");
+    }
+    const BoardSignature sigBefore = g_board.sig;
+    const BoardConfig cfgBefore = g_board.cfg;
+    BoardWriter bw(handle, g_board.cfg, !full);
 
     // Program basics
-    ok("SetAcqMode", CAEN_DGTZ_SetAcquisitionMode(handle, CAEN_DGTZ_SW_CONTROLLED));
-    ok("SetChannelEnableMask", CAEN_DGTZ_SetChannelEnableMask(handle, 0xFF)); // enable all
-    ok("SetRecordLength", CAEN_DGTZ_SetRecordLength(handle, recLen));
-    ok("SetPostTriggerSize", CAEN_DGTZ_SetPostTriggerSize(handle, post));
-    ok("SetMaxNumEventsBLT", CAEN_DGTZ_SetMaxNumEventsBLT(handle, 1023));
+    ok("SetAcqMode", bw.acq_mode(CAEN_DGTZ_SW_CONTROLLED));
+    ok("SetChannelEnableMask", bw.enable_mask(enMask));
+    ok("SetRecordLength", bw.record_length(recLen));
+    ok("SetPostTriggerSize", bw.post_trigger(post));
+    ok("SetMaxNumEventsBLT", bw.max_blt(1023));
+    // EventCounter counts every trigger, so gaps between stored events measure dead time
+    ok("CountAllTriggers", bw.count_all_triggers(true));
 
     // Polarity/edge for negative pulses
     for(int i=0;i<8;++i){
-        ok("SetPulsePolarity", CAEN_DGTZ_SetChannelPulsePolarity(handle, i, CAEN_DGTZ_PulsePolarityNegative));
-        ok("SetTrigPolarity",  CAEN_DGTZ_SetTriggerPolarity(handle, i, CAEN_DGTZ_TriggerOnFallingEdge));
+        ok("SetPulsePolarity", bw.pulse_polarity(i, CAEN_DGTZ_PulsePolarityNegative));
+        ok("SetTrigPolarity",  bw.trigger_polarity(i, CAEN_DGTZ_TriggerOnFallingEdge));
     }
 
     // Put baseline high (≈80%)
     for(int i=0;i<8;++i){
-        ok("SetChannelDCOffset", CAEN_DGTZ_SetChannelDCOffset(handle, i, 0x3333));
+        ok("SetChannelDCOffset", bw.dc_offset(i, dcOffset));
+    }
+    step("program");
+    if(full){
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+        step("settle");
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(80));
 
-    // Trigger selection
-    if(trig=="sw"){
-        ok("SetChannelSelfTrigger(DIS)", CAEN_DGTZ_SetChannelSelfTrigger(handle, CAEN_DGTZ_TRGMODE_DISABLED, 0xFF));
-        ok("SetExt(DIS)",                CAEN_DGTZ_SetExtTriggerInputMode(handle, CAEN_DGTZ_TRGMODE_DISABLED));
-        ok("SetSW(ACQ)",                 CAEN_DGTZ_SetSWTriggerMode(handle, CAEN_DGTZ_TRGMODE_ACQ_ONLY));
-        printf("[cfg] software trigger mode\n");
-    } else if(trig=="ext"){
-        ok("SetChannelSelfTrigger(DIS)", CAEN_DGTZ_SetChannelSelfTrigger(handle, CAEN_DGTZ_TRGMODE_DISABLED, 0xFF));
-        ok("SetSW(DIS)",                 CAEN_DGTZ_SetSWTriggerMode(handle, CAEN_DGTZ_TRGMODE_DISABLED));
-        ok("SetExt(ACQ)",                CAEN_DGTZ_SetExtTriggerInputMode(handle, CAEN_DGTZ_TRGMODE_ACQ_ONLY));
-    } else if(trig=="self"){
-        ok("SetSW(DIS)",  CAEN_DGTZ_SetSWTriggerMode(handle, CAEN_DGTZ_TRGMODE_DISABLED));
-        ok("SetExt(DIS)", CAEN_DGTZ_SetExtTriggerInputMode(handle, CAEN_DGTZ_TRGMODE_DISABLED));
+    // Pedestal and noise of all channels first, with self and external triggers off so only the SW
+    // trigger can fire. A cached calibration is reused while serial, DC offset and temperature
+    // bucket match and it is younger than --ped-max-age.
+    ok("SetChannelSelfTrigger(DIS)", bw.self_trigger(0));
+    ok("SetExt(DIS)",                bw.ext_trigger(CAEN_DGTZ_TRGMODE_DISABLED));
+    std::vector<uint32_t> tempStart(8), tempEnd(8);
+    read_temperatures(handle, tempStart);
+    const uint64_t tempStartWallNs = wall_ns();
+    const int32_t tBucket = ped_temp_bucket(tempStart, pedTempStep);
+    const std::string pedPath = cfgCache=="none" ? "" : pedestal_cache_path(cfgCache, bi.SerialNumber, dcOffset, tBucket);
+    PedestalCal pcal;
+    bool pedCached = false;
+    double pedAge = 0;
+    if(!pedPath.empty() && pedMaxAge>0 && load_pedestal_cache(pedPath, pcal)){
+        pedAge = (double(wall_ns()) - double(pcal.wallNs))*1e-9;
+        pedCached = pcal.serial==bi.SerialNumber && pcal.dcOffset==dcOffset && pcal.tempBucket==tBucket
+                 && pcal.used[ch]>0 && pedAge>=0 && pedAge<pedMaxAge;
+    }
+    if(pedCached){
+        ok("SetSWTriggerMode", bw.sw_trigger(CAEN_DGTZ_TRGMODE_ACQ_ONLY));
+        printf("[ped] cached %s (%.1f h old, %u events)\n", pedPath.c_str(), pedAge/3600, pcal.events);
     } else {
-        fprintf(stderr,"[ERR] unknown trigger mode\n"); return 2;
+        pcal = PedestalCal{};
+        ok("CalibratePedestals", calibrate_pedestals(handle, bw, enMask, (uint32_t)pedEvents, pcal));
+        pcal.serial = bi.SerialNumber; pcal.dcOffset = dcOffset; pcal.tempBucket = tBucket; pcal.wallNs = wall_ns();
+        const char* kname = "";
+        ped_best_acc(&kname);
+        printf("[ped] measured %u of %d events (%s)\n", pcal.events, pedEvents, kname);
+        if(!pcal.used[ch]) fprintf(stderr,"[warn] pedestal: no usable data on ch%d, using midscale\n", ch);
+        else if(!pedPath.empty() && !save_pedestal_cache(pedPath, pcal))
+            fprintf(stderr,"[warn] cannot write pedestal cache '%s'\n", pedPath.c_str());
     }
-
-    // Pedestal & absolute threshold
-    const uint32_t ped = measure_pedestal(handle, ch, 200);
+    printf("[ped]");
+    for(int c=0;c<8;++c) printf(" ch%d %.1f+-%.2f%s", c, pcal.mean[c], pcal.rms[c], pcal.used[c]<pcal.events ? "*" : "");
+    printf("  (* = events with pulses left out)\n");
+    auto pedOf = [&](int c)->uint32_t{ return pcal.used[c] ? (uint32_t)std::lround(pcal.mean[c]) : 0x8000u; };
+    const uint32_t ped = pedOf(ch);
     const uint32_t thr_abs = (trig=="self") ? ((ped > delta) ? ped - delta : 0u) : ped; // use ped for sw/ext readback printing
+    step("pedestal");
 
-    // WaveDump-style pair arming (0–1,2–3,...)
-    const int pair_base = (ch % 2 == 0) ? ch : (ch-1);
-    const uint32_t pair_mask = (1u << pair_base) | (1u << (pair_base+1));
+    // Trigger selection (the pedestal left the SW trigger in ACQ_ONLY; only sw and --sw-rate keep it)
+    if(trig=="sw"){
+        printf("[cfg] software trigger mode\n");
+    } else {
+        if(!mixed) ok("SetSWTriggerMode(DIS)", bw.sw_trigger(CAEN_DGTZ_TRGMODE_DISABLED));
+        if(trig=="ext") ok("SetExt(ACQ)", bw.ext_trigger(CAEN_DGTZ_TRGMODE_ACQ_ONLY));
+    }
 
+    // Absolute threshold, each channel of the pair relative to its own pedestal
     if(trig=="self"){
-        ok("SetThr(pair_base)",   CAEN_DGTZ_SetChannelTriggerThreshold(handle, pair_base,   thr_abs));
-        ok("SetThr(pair_base+1)", CAEN_DGTZ_SetChannelTriggerThreshold(handle, pair_base+1, thr_abs));
-        ok("SetChannelSelfTrigger(ACQ_ONLY, pair)", CAEN_DGTZ_SetChannelSelfTrigger(handle, CAEN_DGTZ_TRGMODE_ACQ_ONLY, pair_mask));
+        auto thrOf = [&](int c)->uint32_t{ const uint32_t p = pedOf(c); return p > delta ? p - delta : 0u; };
+        ok("SetThr(pair_base)",   bw.threshold(pair_base,   thrOf(pair_base)));
+        ok("SetThr(pair_base+1)", bw.threshold(pair_base+1, thrOf(pair_base+1)));
+        ok("SetChannelSelfTrigger(ACQ_ONLY, pair)", bw.self_trigger(pair_mask));
         uint32_t thr_rd0=0, thr_rd1=0;
         ok("GetThr0", CAEN_DGTZ_GetChannelTriggerThreshold(handle, pair_base, &thr_rd0));
         ok("GetThr1", CAEN_DGTZ_GetChannelTriggerThreshold(handle, pair_base+1, &thr_rd1));
@@ -223,184 +780,1300 @@ int main(int argc,char**argv){
     } else {
         printf("[auto] ped(ch%d)=%u  (delta=%u; self-trigger not used in this mode)\n", ch, ped, delta);
     }
+    step("trigger");
 
-    // Temperatures at start
-    std::vector<uint32_t> tempStart(8), tempEnd(8);
-    read_temperatures(handle, tempStart);
+    // Remember what the board now holds; the readback signature only changes with its registers.
+    const bool sigStale = full || std::memcmp(&g_board.cfg, &cfgBefore, sizeof(cfgBefore))!=0;
+    if(sigStale) ok("read signature", read_signature(handle, g_board.sig));
+    else g_board.sig = sigBefore;
+    g_board.known = true;
+    if(!cachePath.empty() && !save_config_cache(cachePath, bi.SerialNumber, g_board.cfg, g_board.sig))
+        fprintf(stderr,"[warn] cannot write config cache '%s'\n", cachePath.c_str());
+    step("cache-save");
+    printf("[cfg] %s programming: %u register writes, %u skipped, config hash %016llx\n",
+           full ? "full" : "differential", bw.writes(), bw.skipped(), (unsigned long long)config_hash(g_board.cfg));
+    // The board may round the record length: event slots, waves, noise and live buffers are sized
+    // from what it reads back, so no stage truncates its records.
+    if(g_board.sig.recLen && g_board.sig.recLen != (uint32_t)recLen){
+        printf("[cfg] board record length %u samples (requested %d)\n", g_board.sig.recLen, recLen);
+        recLen = (int)g_board.sig.recLen;
+    }
 
     // Prepare ROOT
     TFile* rfile = nullptr;
     TDirectory* dtag = nullptr;
-    TTree* runinfo = nullptr;
+    TDirectory* btag = nullptr;   // --sw-rate: baseline events' waveforms
     TTree* temps = nullptr;
+    TTree* ftree = nullptr;
+    WavesTree waves, bwaves;
+    // --format th1: one histogram per channel, renamed and refilled for every event's key, so the
+    // write stage does not construct (and heap-allocate the bins of) a TH1I per event
+    std::unique_ptr<TH1I> th1[8];
+    // features tree buffers (one slot per channel; unsaved channels stay 0)
+    uint32_t f_cnt=0, f_ttt=0, f_mask=0;
+    unsigned long long f_tns=0;
+    bool     f_kept=false;
+    uint8_t  f_src=kSrcSelf;
+    float    f_base[8]={}, f_rms[8]={}, f_amp[8]={}, f_int[8]={}, f_cfd[8]={}, f_qs[8]={}, f_ql[8]={};
+    uint16_t f_peak[8]={};
 
-    int    ri_N=N, ri_ch=ch, ri_recLen=recLen, ri_post=post;
-    unsigned ri_delta=delta, ri_ped=ped, ri_thr=thr_abs, ri_pairmask=pair_mask;
-    std::string ri_trig = trig, ri_tag = tag;
-
-    int t_when=0; // 0=start,1=end
+    int t_when=0; // 0=start,1=end,2=during the run (--temp-every)
     uint32_t t_temp[8]; // per-channel temps (UINT_MAX if N/A)
+    unsigned long long t_tns=0, t_wall=0; // ns since acquisition start (start: 0), CLOCK_REALTIME
+    std::string t_tag = tag, *t_tagp = &t_tag;
 
-    if(!rootOut.empty()){
-        rfile = TFile::Open(rootOut.c_str(), "UPDATE");
+    TDirectory* sdir = nullptr;   // spectra snapshots (--spectra)
+    TDirectory* ndir = nullptr;   // noise snapshots (--noise), under the tag of the sw events
+    uint32_t subrun = 0;          // file of the run (--rotate-*)
+    uint64_t fileOpenWallNs = 0;
+    // Opens (or creates) one output file and attaches the per-file trees; the first file of the
+    // run also gets the start temperatures. Rotation calls it again for every new file.
+    auto openRoot = [&](const std::string& path)->bool{
+        temps = ftree = nullptr; dtag = btag = sdir = ndir = nullptr; waves.tree = bwaves.tree = nullptr;
+        rfile = TFile::Open(path.c_str(), "UPDATE");
         if(!rfile || rfile->IsZombie()){
             // try create
-            rfile = TFile::Open(rootOut.c_str(), "RECREATE");
+            rfile = TFile::Open(path.c_str(), "RECREATE");
+            if(rfile && !rfile->IsZombie() && compSetting>=0) rfile->SetCompressionSettings(compSetting);
         }
         if(rfile && !rfile->IsZombie()){
-            // Run info tree (one entry)
-            runinfo = (TTree*)rfile->Get("runinfo");
-            if(!runinfo){
-                runinfo = new TTree("runinfo","acquisition metadata");
-                runinfo->Branch("N",         &ri_N,        "N/I");
-                runinfo->Branch("ch",        &ri_ch,       "ch/I");
-                runinfo->Branch("recLen",    &ri_recLen,   "recLen/I");
-                runinfo->Branch("post",      &ri_post,     "post/I");
-                runinfo->Branch("delta",     &ri_delta,    "delta/i");
-                runinfo->Branch("ped",       &ri_ped,      "ped/i");
-                runinfo->Branch("thr_abs",   &ri_thr,      "thr_abs/i");
-                runinfo->Branch("pair_mask", &ri_pairmask, "pair_mask/i");
-                runinfo->Branch("trig_mode", &ri_trig);
-                runinfo->Branch("tag",       &ri_tag);
-            }
-            runinfo->Fill();
-
-            // Temps tree (two entries per run)
-            temps = (TTree*)rfile->Get("temps");
-            if(!temps){
-                temps = new TTree("temps","ADC temperatures (C)");
-                temps->Branch("when",&t_when,"when/I"); // 0=start,1=end
-                temps->Branch("temp", t_temp, "temp[8]/i");
+            // Temps tree: start and end of each run, and every --temp-every s in between.
+            // Files from before t_ns/wall_ns/tag get those branches zero-filled for their entries.
+            struct { const char* name; void* addr; const char* leaf; } tb[] = {
+                {"when",    &t_when, "when/I"},
+                {"temp",    t_temp,  "temp[8]/i"},
+                {"t_ns",    &t_tns,  "t_ns/l"},
+                {"wall_ns", &t_wall, "wall_ns/l"},
+                {"tag",     &t_tagp, nullptr},
+            };
+            if((temps = (TTree*)rfile->Get("temps"))){
+                const Long64_t prev = temps->GetEntries();
+                for(auto& b : tb){
+                    if(temps->GetBranch(b.name)){ temps->SetBranchAddress(b.name, b.addr); continue; }
+                    TBranch* br = b.leaf ? temps->Branch(b.name, b.addr, b.leaf)
+                                         : temps->Branch(b.name, *(std::string**)b.addr);
+                    if(!br || prev<=0) continue;
+                    std::string empty, *emptyp = &empty;
+                    std::vector<char> zero(64, 0);
+                    br->SetAddress(b.leaf ? (void*)zero.data() : (void*)&emptyp);
+                    for(Long64_t i=0;i<prev;++i) br->Fill();
+                    br->SetAddress(b.addr);
+                }
+            } else {
+                temps = new TTree("temps","ADC temperatures (C); t_ns: ns since acquisition start, as the events' t_ns");
+                for(auto& b : tb){
+                    if(b.leaf) temps->Branch(b.name, b.addr, b.leaf);
+                    else temps->Branch(b.name, *(std::string**)b.addr);
+                }
             }
             // write start temps
-            t_when = 0;
-            for(int i=0;i<8;++i) t_temp[i] = tempStart[i];
-            temps->Fill();
+            if(subrun==0){
+                t_when = 0; t_tns = 0; t_wall = tempStartWallNs;
+                for(int i=0;i<8;++i) t_temp[i] = tempStart[i];
+                temps->Fill();
+            }
 
             // subdirectory for this run’s waveforms
             if(!(dtag = (TDirectory*)rfile->Get(tag.c_str()))){
                 dtag = rfile->mkdir(tag.c_str());
             }
+            if(format!="th1" && dtag && rawOut.empty()){
+                waves.attach(dtag, recLen, saveMask, basket, compSetting, format=="packed", zleThr>0);
+                rfile->cd();
+            }
+            // baseline events of a mixed run: same layout, never ZLE'd (there is nothing to cut around)
+            if(mixed && !(btag = (TDirectory*)rfile->Get(baseTag.c_str()))) btag = rfile->mkdir(baseTag.c_str());
+            if(mixed && btag && format!="th1"){
+                bwaves.attach(btag, recLen, saveMask, basket, compSetting, format=="packed", false);
+                rfile->cd();
+            }
+            if(features && dtag){
+                dtag->cd();
+                struct { const char* name; void* addr; const char* leaf; } fb[] = {
+                    {"EventCounter",   &f_cnt,  "EventCounter/i"},
+                    {"TriggerTimeTag", &f_ttt,  "TriggerTimeTag/i"},
+                    {"t_ns",           &f_tns,  "t_ns/l"},
+                    {"ChannelMask",    &f_mask, "ChannelMask/i"},
+                    {"kept",           &f_kept, "kept/O"},
+                    {"trig_src",       &f_src,  "trig_src/b"},
+                    {"baseline",       f_base,  "baseline[8]/F"},
+                    {"rms",            f_rms,   "rms[8]/F"},
+                    {"amplitude",      f_amp,   "amplitude[8]/F"},
+                    {"peak",           f_peak,  "peak[8]/s"},
+                    {"integral",       f_int,   "integral[8]/F"},
+                    {"t_cfd",          f_cfd,   "t_cfd[8]/F"},
+                    {"q_short",        f_qs,    "q_short[8]/F"},
+                    {"q_long",         f_ql,    "q_long[8]/F"},
+                };
+                if((ftree = (TTree*)dtag->Get("features"))){
+                    for(auto& b : fb) if(ftree->GetBranch(b.name)) ftree->SetBranchAddress(b.name, b.addr); // t_ns is absent in older files
+                } else {
+                    ftree = new TTree("features","pulse features per event (baseline from pre-trigger; t_cfd in samples; "
+                                                 "q_short/q_long: PSD gate integrals, 0 without --spectra; "
+                                                 "trig_src: 1 self, 2 sw, 4 ext)");
+                    for(auto& b : fb){
+                        TBranch* br = ftree->Branch(b.name, b.addr, b.leaf, basket>0 ? basket : 32000);
+                        if(br && compSetting>=0) br->SetCompressionSettings(compSetting);
+                    }
+                }
+                rfile->cd();
+            }
+            if(spectra && dtag && !(sdir = (TDirectory*)dtag->Get("spectra"))) sdir = dtag->mkdir("spectra");
+            if(TDirectory* nt = mixed ? btag : dtag; noise && nt && !(ndir = (TDirectory*)nt->Get("noise"))) ndir = nt->mkdir("noise");
         } else {
-            fprintf(stderr,"[warn] cannot create ROOT file '%s'\n", rootOut.c_str());
+            fprintf(stderr,"[warn] cannot create ROOT file '%s'\n", path.c_str());
             rfile = nullptr;
         }
+        fileOpenWallNs = wall_ns();
+        return rfile!=nullptr;
+    };
+    if(!rootOut.empty()){
+        if(rotating) ROOT::EnableThreadSafety(); // files are closed on their own thread
+        openRoot(subrunPath(0));
+        step("root");
+    }
+    // A return or failed CAEN call before the finalize (e.g. --raw unopenable, ClearData) still
+    // closes the file, so an UPDATE-mode file is never left without its directory
+    struct RootGuard { TFile*& f; ~RootGuard(){ if(f){ f->Close(); delete f; } } } rootGuard{rfile};
+
+    // Acquire: readout -> decode -> write, each on its own thread.
+    //   readout: only ReadData into a free pooled buffer, hand it to decode
+    //   decode : walk the block once (or GetEventInfo/DecodeEvent with --decoder caen) and
+    //            unpack the saved channels into a pooled Event
+    //   write  : printf, text and ROOT output, recycle the Event
+    // Pools are handed around through SPSC rings, so the stages' own buffers are not allocated per
+    // block/event (ROOT's keys and basket flushes still are).
+    struct Block { char* buf=nullptr; uint32_t cap=0; uint32_t bsz=0; uint32_t nev=0; uint64_t readNs=0; };
+    // Structure-of-arrays: one contiguous sample arena per event, wave[c] points at channel c's slice.
+    struct Event {
+        uint64_t idx=0; CAEN_DGTZ_EventInfo_t info{};
+        uint64_t tNs=0;                 // rollover-corrected trigger time since acquisition start
+        uint32_t ns[8]={}; uint16_t* wave[8]={};
+        std::vector<uint16_t> arena;
+        bool keep=true;                 // store the full waveforms (features/spectra prescale)
+        uint8_t src=kSrcSelf;           // TrigSrc
+        PulseFeatures feat[8];
+        float qShort[8]={}, qLong[8]={};   // PSD gate integrals (--spectra)
+        uint32_t nseg[8]={};            // --zle regions per channel
+        ZleSeg seg[8][WavesTree::kMaxSeg];
+    };
+    const uint32_t nPre = (uint32_t)recLen * (uint32_t)(100-std::min(post,100)) / 100;
+
+    std::vector<Block> blocks(nbuf);
+    // buffers go back to the library even when a CAEN call throws (--daemon keeps the board)
+    struct BlockGuard { std::vector<Block>& v; ~BlockGuard(){ for(auto& b : v) if(b.buf) CAEN_DGTZ_FreeReadoutBuffer(&b.buf); } } blockGuard{blocks};
+    for(auto& b : blocks) ok("MallocReadoutBuffer", CAEN_DGTZ_MallocReadoutBuffer(handle,&b.buf,&b.cap));
+    std::vector<Event> events(nevt);
+    for(auto& ev : events){
+        ev.arena.resize((size_t)nSave*recLen);
+        uint16_t* p = ev.arena.data();
+        for(int c=0;c<8;++c) if((saveMask>>c)&1){ ev.wave[c]=p; p+=recLen; }
+    }
+
+    SpscRing<uint32_t> freeBlocks(nbuf), fullBlocks(nbuf);     // readout <-> decode
+    SpscRing<uint32_t> freeEvents(nevt), readyEvents(nevt);    // decode  <-> write
+    for(int i=0;i<nbuf;++i) freeBlocks.try_push(i);
+    for(int i=0;i<nevt;++i) freeEvents.try_push(i);
+
+    std::atomic<bool> roDone{false}, decDone{false};
+    // A stage that fails (ok() throws) records why and stops the other stages.
+    std::atomic<bool> abortRun{false};
+    std::mutex errMutex;
+    std::string threadErr;
+    auto fail = [&](const char* what){
+        std::lock_guard<std::mutex> lk(errMutex);
+        if(threadErr.empty()) threadErr = what;
+        abortRun = true;
+    };
+    // Backpressure: how often (and how long) a stage waited on its downstream pool.
+    std::atomic<uint64_t> roStalls{0}, roStallNs{0}, decStalls{0}, decStallNs{0};
+    size_t fullHW=0, readyHW=0; // queue high-water marks (owned by the producers)
+    uint64_t bltReads=0, bltBytes=0;
+    // Hot-path histograms (common/perf.h). Each one is recorded by a single stage and read after the joins.
+    struct RunPerf {
+        LogHist readNs, bltBytes, bltEvents, bufOcc; // readout: ReadData latency, BLT size, blocks waiting for decode
+        LogHist decodeNs;                            // decode: per block (raw append with --raw)
+        LogHist textNs, rootNs;                      // write: per event
+    };
+    auto perf = std::make_unique<RunPerf>();
+    // Online spectra: the decode stage fills its shard, the write stage snapshots it into the file.
+    std::unique_ptr<Spectra> spec;
+    if(spectra) spec.reset(new Spectra(axes, saveMask, 1));
+    uint32_t snapshots = 0;
+    double snapMs = 0;
+    float psdFom[8] = {}, psdCut[8] = {};   // runinfo; filled at the end of each file
+    auto snapshotSpectra = [&]{
+        const uint64_t t0 = perf_now_ns();
+        spec->snapshot();
+        if(sdir){ write_spectra(*spec, sdir); rfile->cd(); }
+        snapshots++; snapMs += (perf_now_ns() - t0)*1e-6;
+    };
+    // Noise of the sw events: the write stage hands them to the worker's thread, the files get
+    // the run's accumulators so far. runinfo: rms over the record and PSD peak per saved channel.
+    std::unique_ptr<NoiseWorker> noiseW;
+    if(noise) noiseW.reset(new NoiseWorker((uint32_t)recLen, saveMask));
+    float noiseRms[8] = {}, noisePeak[8] = {};
+    unsigned long long noiseEvents = 0;
+    auto snapshotNoise = [&]{
+        noiseW->read([&](const NoiseAccum& na){
+            for(int c=0;c<8;++c){
+                noiseRms[c] = (float)na.rms(c); noisePeak[c] = (float)(na.peak_hz(c)*1e-6);
+                if(na.events(c)) noiseEvents = na.events(c);
+            }
+            if(ndir){ write_noise(na, ndir); rfile->cd(); }
+        });
+    };
+    // 64-bit event times and EventCounter gaps (every trigger is counted, 0x8100 bit 3), hence
+    // live time and rates. Owned by the decode stage.
+    RunClock clk;
+    uint64_t startWallNs = 0;
+
+    // Text output (--txtdir wins over --txt); formatted and written by its own thread
+    TextWriter textOut;
+    const bool doText = !txt.empty() || !txtdir.empty();
+    if(doText) textOut.open(txtdir.empty() ? txt : "", txtdir, (uint32_t)txtChunk, tag, trig);
+
+    const bool doDecode = stages.find('d')!=std::string::npos;
+    const bool native   = decoder=="native";
+    if(native){
+        const char* kname="";
+        x730_best_unpack(&kname);
+        printf("[info] decoder=native (%s)\n", kname);
     }
+    RawWriter raw;
+    if(!rawOut.empty()){
+        RawFileHeader fh;
+        fh.serial = bi.SerialNumber; fh.modelId = bi.Model;
+        fh.channels = bi.Channels;   fh.adcBits = bi.ADC_NBits;
+        snprintf(fh.model, sizeof(fh.model), "%s", bi.ModelName);
+        snprintf(fh.rocFw, sizeof(fh.rocFw), "%s", bi.ROC_FirmwareRel);
+        snprintf(fh.amcFw, sizeof(fh.amcFw), "%s", bi.AMC_FirmwareRel);
+        fh.N = N; fh.ch = ch; fh.recLen = recLen; fh.post = post;
+        fh.delta = delta; fh.ped = ped; fh.thrAbs = thr_abs; fh.pairMask = pair_mask;
+        fh.enMask = enMask; fh.saveMask = saveMask;
+        snprintf(fh.trig, sizeof(fh.trig), "%s", trig.c_str());
+        snprintf(fh.tag, sizeof(fh.tag), "%s", tag.c_str());
+        fh.startWallNs = wall_ns();
+        if(!raw.open(rawOut, fh)) return 1;
+    }
+    const bool doWrite  = stages.find('w')!=std::string::npos;
 
-    // Acquire
+    step("buffers");
     ok("ClearData", CAEN_DGTZ_ClearData(handle));
     std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    step("clear");
     ok("SWStartAcquisition", CAEN_DGTZ_SWStartAcquisition(handle));
+    const auto tAcq0 = std::chrono::steady_clock::now();
+    const uint64_t acq0Ns = perf_now_ns();
+    startWallNs = wall_ns();
+    const double setupMs = std::chrono::duration<double, std::milli>(tAcq0-tSetup0).count();
+    printf("[time] %s; setup total %.1f ms\n", steps.c_str(), setupMs);
 
-    char* rbuf=nullptr; uint32_t rsz=0;
-    ok("MallocReadoutBuffer", CAEN_DGTZ_MallocReadoutBuffer(handle,&rbuf,&rsz));
-    void* evt=nullptr; ok("AllocateEvent", CAEN_DGTZ_AllocateEvent(handle,&evt));
+    // Live monitoring stream (common/live_shm.h): the write stage publishes prescaled events and,
+    // twice a second, the run status. Readers map it read-only and never touch the board.
+    LiveWriter live;
+    LiveStatus liveSt;
+    auto liveTemps = [&](const uint32_t* t, uint64_t wallNs){
+        for(int c=0;c<8;++c) liveSt.temp[c] = t[c]==std::numeric_limits<uint32_t>::max() ? -1.0f : (float)t[c];
+        liveSt.tempWallNs = wallNs;
+    };
+    if(!liveName.empty()){
+        if(live.open(liveName, (uint32_t)liveSlots, (uint32_t)recLen, saveMask)){
+            liveSt.state = kLiveRunning;
+            liveSt.serial = bi.SerialNumber;
+            snprintf(liveSt.tag, sizeof(liveSt.tag), "%s", tag.c_str());
+            liveSt.startWallNs = liveSt.updateWallNs = startWallNs;
+            liveTemps(tempStart.data(), tempStartWallNs);
+            live.set_status(liveSt);
+            printf("[live] %s: %d slots, %.4g waveforms/s\n", liveName.c_str(), liveSlots, liveHz);
+        } else fprintf(stderr,"[warn] cannot map shared memory '%s'; live stream off\n", liveName.c_str());
+    }
+    double cpuAtStart = 0;
+    {
+        rusage ru{}; getrusage(RUSAGE_SELF, &ru);
+        cpuAtStart = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec*1e-6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec*1e-6;
+    }
 
-    // Text output (optional single file)
-    std::ofstream txt_out;
-    if(!txt.empty()){
-        txt_out.open(txt, std::ios::app);
-        if(!txt_out.is_open()){
-            fprintf(stderr,"[warn] could not open --txt='%s' for append\n", txt.c_str());
+    // Waiting for data: --readout irq blocks in IRQWait until the board has irqEvents events
+    // (falls back to polling if interrupts cannot be configured); --readout poll retries
+    // ReadData with a sleep that starts at 20 us and doubles up to 1 ms while the board is empty.
+    // SW mode keeps up to swBurst triggers outstanding instead of one trigger + 2 ms sleep.
+    bool useIrq = readoutMode=="irq";
+    if(useIrq){
+        CAEN_DGTZ_ErrorCode ec = CAEN_DGTZ_SetInterruptConfig(handle, CAEN_DGTZ_ENABLE, 1, 0xAAAA,
+                                                              (uint16_t)irqEvents, CAEN_DGTZ_IRQ_MODE_RORA);
+        if(ec!=CAEN_DGTZ_Success){
+            fprintf(stderr,"[warn] SetInterruptConfig failed (code=%d); using the adaptive poller\n", ec);
+            useIrq = false;
         }
     }
+    uint64_t swSent=0, swLost=0, irqWaits=0, irqTimeouts=0, emptyReads=0;
+    uint64_t swInjected=0;        // --sw-rate triggers sent
+    const uint64_t swGapNs = mixed ? (uint64_t)(1e9/swRate) : 0;
+    double roCpuSec=0;
+    bool stoppedEarly=false;      // readout stopped the board on a signal and drained it
+    TempSampler tsamp;
+    tsamp.start(tempEvery, acq0Ns);
+
+    std::thread readout([&]{
+        try {
+            auto lastNote = std::chrono::steady_clock::now();
+            auto lastData = lastNote;
+            uint64_t evRead=0;
+            uint32_t pollUs=20;
+            uint64_t nextSwNs = acq0Ns + swGapNs;
+            while(evRead<maxEv){
+                uint32_t bk;
+                if(!freeBlocks.try_pop(bk)){
+                    auto t0=std::chrono::steady_clock::now();
+                    Backoff bo;
+                    while(!freeBlocks.try_pop(bk)){
+                        if(abortRun) throw DaqError("aborted");
+                        bo.wait();
+                    }
+                    roStalls++;
+                    roStallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-t0).count();
+                }
+                Block& b = blocks[bk];
+                for(;;){
+                    if(abortRun) throw DaqError("aborted");
+                    if(!stoppedEarly && g_stopSignal.load()){
+                        // stop triggering, then read until the board is empty
+                        ok("SWStopAcquisition", CAEN_DGTZ_SWStopAcquisition(handle));
+                        stoppedEarly = true;
+                        printf("[stop] signal %d: acquisition stopped after %llu events read, draining the board\n",
+                               g_stopSignal.load(), (unsigned long long)evRead);
+                        fflush(stdout);
+                    }
+                    g_temps.poll(handle);
+                    if(swGapNs && !stoppedEarly){
+                        const uint64_t now = perf_now_ns();
+                        if(now >= nextSwNs){
+                            CAEN_DGTZ_SendSWtrigger(handle);
+                            swInjected++;
+                            nextSwNs = std::max(nextSwNs + swGapNs, now);
+                        }
+                    }
+                    if(trig=="sw" && !stoppedEarly){
+                        // keep swBurst triggers in flight; forget them if the board never answers
+                        uint64_t outstanding = swSent - std::min(swSent, evRead + swLost);
+                        if(outstanding && std::chrono::steady_clock::now()-lastData > std::chrono::milliseconds(200)){
+                            swLost += outstanding; outstanding = 0;
+                        }
+                        const uint64_t want = std::min<uint64_t>((uint64_t)swBurst, maxEv - std::min(maxEv, evRead));
+                        for(; outstanding<want; ++outstanding, ++swSent) CAEN_DGTZ_SendSWtrigger(handle);
+                    }
+                    if(useIrq && !stoppedEarly){
+                        irqWaits++;
+                        CAEN_DGTZ_ErrorCode ec = CAEN_DGTZ_IRQWait(handle, irqTimeoutMs);
+                        if(ec==CAEN_DGTZ_Timeout) irqTimeouts++;
+                        else ok("IRQWait", ec);
+                    }
+                    b.bsz=0;
+                    const uint64_t tr0 = perf_now_ns();
+                    ok("ReadData", CAEN_DGTZ_ReadData(handle, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT, b.buf, &b.bsz));
+                    b.readNs = perf_now_ns();
+                    perf->readNs.record(b.readNs - tr0);
+                    if(b.bsz>0){ pollUs=20; tsamp.step(handle, false); break; }
+                    if(stoppedEarly) break;     // drained
+                    emptyReads++;
+                    tsamp.step(handle, true);
+                    auto now=std::chrono::steady_clock::now();
+                    if(now-lastNote > std::chrono::seconds(5)){
+                        printf("[stat] no data yet (waiting for triggers)...\n");
+                        lastNote=now;
+                    }
+                    if(!useIrq){
+                        std::this_thread::sleep_for(std::chrono::microseconds(pollUs));
+                        pollUs = std::min<uint32_t>(pollUs*2, 1000);
+                    }
+                }
+                if(!b.bsz) break;   // drained; the block is abandoned (decode is freeBlocks' only producer)
+                lastData = std::chrono::steady_clock::now();
+                ok("GetNumEvents", CAEN_DGTZ_GetNumEvents(handle, b.buf, b.bsz, &b.nev));
+                evRead += b.nev;
+                bltReads++; bltBytes += b.bsz;
+                perf->bltBytes.record(b.bsz);
+                perf->bltEvents.record(b.nev);
+                fullBlocks.try_push(bk); // cannot fail: ring holds every block
+                const size_t occ = fullBlocks.size();
+                perf->bufOcc.record(occ);
+                fullHW = std::max(fullHW, occ);
+            }
+            roCpuSec = thread_cpu_sec();
+        } catch(const std::exception& e){ fail(e.what()); }
+        roDone = true;
+    });
+
+    // In --raw mode this stage writes whole blocks to the raw file instead of decoding.
+    uint64_t decoded=0;
+    double decCpuSec=0;
+    // Software ZLE on the calibrated pedestals; the decode stage finds the regions, the write
+    // stage stores them. Counters owned by the decode stage.
+    ZleCut zcut[8];
+    for(int c=0;c<8;++c) zcut[c] = zle_cut(pedOf(c), zleThr, zlePre, zlePost, zleBipolar);
+    std::vector<uint64_t> zleBits(zle_mask_words((uint32_t)recLen));
+    const uint8_t srcOfMode = trig=="sw" ? kSrcSw : trig=="ext" ? kSrcExt : kSrcSelf;
+    const uint32_t trigFrom = nPre > kTrigWin ? nPre - kTrigWin : 0, trigTo = nPre + kTrigWin;
+    uint32_t thrPair[2] = {};
+    for(int k=0;k<2;++k){ const uint32_t p = pedOf(pair_base+k); thrPair[k] = p > delta ? p - delta : 0u; }
+    uint64_t zleRecords = 0, zleSegs = 0, zleNs = 0;
+    std::thread decode([&]{
+        void* evt=nullptr;
+        try {
+            ok("AllocateEvent", CAEN_DGTZ_AllocateEvent(handle,&evt));
+            Backoff bo;
+            for(;;){
+                uint32_t bk;
+                if(!fullBlocks.try_pop(bk)){
+                    if(roDone && fullBlocks.size()==0) break;
+                    bo.wait(); continue;
+                }
+                bo.reset();
+                Block& b = blocks[bk];
+                const uint64_t td0 = perf_now_ns();
+                if(!rawOut.empty()){
+                    x730_for_each(b.buf, b.bsz, [&](const X730Event& xe){ clk.add(xe.counter, xe.ttt, b.readNs); }); // headers only
+                    raw.append(b.buf, b.bsz, b.nev);
+                    decoded = std::min<uint64_t>(maxEv, decoded + b.nev);
+                    perf->decodeNs.record(perf_now_ns() - td0);
+                    freeBlocks.try_push(bk);
+                    continue;
+                }
+                auto nextSlot = [&]()->uint32_t{
+                    uint32_t ei;
+                    if(!freeEvents.try_pop(ei)){
+                        auto t0=std::chrono::steady_clock::now();
+                        Backoff wb;
+                        while(!freeEvents.try_pop(ei)){
+                            if(abortRun) throw DaqError("aborted");
+                            wb.wait();
+                        }
+                        decStalls++;
+                        decStallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-t0).count();
+                    }
+                    Event& ev = events[ei];
+                    ev.idx = decoded++;
+                    ev.src = srcOfMode;
+                    std::fill(std::begin(ev.ns), std::end(ev.ns), 0u);
+                    return ei;
+                };
+                auto publish = [&](uint32_t ei){
+                    Event& ev = events[ei];
+                    // baseline events (--sw-rate) stay out of the spectra and are always stored whole
+                    const bool base = mixed && ev.src==kSrcSw;
+                    if(features || spec){
+                        for(int c=0;c<8;++c){
+                            if(!ev.ns[c]) continue;
+                            ev.feat[c] = pulse_features(ev.wave[c], ev.ns[c], nPre, cfdFrac);
+                            if(spec){
+                                psd_integrals(ev.wave[c], ev.ns[c], ev.feat[c].baseline, ev.feat[c].peak, gates, ev.qShort[c], ev.qLong[c]);
+                                if(!base) spec->shard(0).fill(c, ev.qLong[c], ev.qShort[c]);
+                            }
+                        }
+                        // deterministic prescale: keep event i when floor((i+1)f) > floor(i f)
+                        ev.keep = base || std::floor((ev.idx+1)*keepFrac) > std::floor(ev.idx*keepFrac);
+                    }
+                    if(zleThr && ev.keep && !base){
+                        const uint64_t tz0 = perf_now_ns();
+                        for(int c=0;c<8;++c){
+                            if(!ev.ns[c]) continue;
+                            ev.nseg[c] = zle_find(ev.wave[c], ev.ns[c], zcut[c], zleBits.data(), ev.seg[c], WavesTree::kMaxSeg);
+                            zleRecords++; zleSegs += ev.nseg[c];
+                        }
+                        zleNs += perf_now_ns() - tz0;
+                    }
+                    readyEvents.try_push(ei);
+                    readyHW = std::max(readyHW, readyEvents.size());
+                };
+                if(doDecode && native){
+                    x730_for_each(b.buf, b.bsz, [&](const X730Event& xe){
+                        if(decoded>=maxEv) return;
+                        const uint64_t tNs = clk.add(xe.counter, xe.ttt, b.readNs);
+                        const uint32_t ei = nextSlot();
+                        Event& ev = events[ei];
+                        ev.tNs                 = tNs;
+                        ev.info.EventSize      = xe.sizeWords*4;
+                        ev.info.BoardId        = xe.boardId;
+                        ev.info.Pattern        = xe.pattern;
+                        ev.info.ChannelMask    = xe.chMask;
+                        ev.info.EventCounter   = xe.counter;
+                        ev.info.TriggerTimeTag = xe.ttt;
+                        const uint32_t words = std::min<uint32_t>(xe.wordsPerCh, (uint32_t)recLen/2);
+                        for(int c=0;c<8;++c){
+                            if(!ev.wave[c] || !((xe.chMask>>c)&1)) continue;
+                            x730_unpack(x730_channel(xe, c), words, ev.wave[c]);
+                            ev.ns[c] = 2*words;
+                        }
+                        if(mixed){
+                            bool self = false;
+                            for(int k=0;k<2 && !self;++k)
+                                if((xe.chMask>>(pair_base+k))&1)
+                                    self = crosses_packed(x730_channel(xe, pair_base+k), words, trigFrom, trigTo, thrPair[k]);
+                            ev.src = self ? kSrcSelf : kSrcSw;
+                        }
+                        publish(ei);
+                    });
+                } else {
+                    for(uint32_t i=0;i<b.nev && decoded<maxEv;++i){
+                        const uint32_t ei = nextSlot();
+                        Event& ev = events[ei];
+                        if(doDecode){
+                            char* ep=nullptr;
+                            ok("GetEventInfo", CAEN_DGTZ_GetEventInfo(handle, b.buf, b.bsz, i, &ev.info, &ep));
+                            ev.tNs = clk.add(ev.info.EventCounter, ev.info.TriggerTimeTag, b.readNs);
+                            ok("DecodeEvent",  CAEN_DGTZ_DecodeEvent(handle, ep, &evt));
+                            auto* e=(CAEN_DGTZ_UINT16_EVENT_t*)evt;
+                            for(int c=0; e && c<8; ++c){
+                                if(!ev.wave[c]) continue;
+                                ev.ns[c] = std::min<uint32_t>(e->ChSize[c], (uint32_t)recLen);
+                                if(ev.ns[c]) std::memcpy(ev.wave[c], e->DataChannel[c], ev.ns[c]*sizeof(uint16_t));
+                            }
+                            if(mixed){
+                                bool self = false;
+                                for(int k=0;k<2 && e && !self;++k)
+                                    self = crosses(e->DataChannel[pair_base+k], e->ChSize[pair_base+k], trigFrom, trigTo, thrPair[k]);
+                                ev.src = self ? kSrcSelf : kSrcSw;
+                            }
+                        }
+                        publish(ei);
+                    }
+                }
+                perf->decodeNs.record(perf_now_ns() - td0);
+                freeBlocks.try_push(bk);
+            }
+        } catch(const std::exception& e){ fail(e.what()); }
+        if(evt) CAEN_DGTZ_FreeEvent(handle,&evt);
+        decCpuSec = thread_cpu_sec();
+        decDone = true;
+    });
 
-    auto lastNote = std::chrono::steady_clock::now();
-    int got=0;
+    uint64_t nBase = 0, fileBase = 0;   // baseline events written (--sw-rate), in the run / the current file
+    // One 'runinfo' entry per output file: settings, then the trigger clock of its events (times
+    // in ns since the acquisition start; start_wall_ns + t_ns is absolute) and the inter-arrival
+    // histogram. Without --rotate-* the file holds the whole run. N is -1 with --continuous.
+    int    ri_N=continuous ? -1 : N, ri_ch=ch, ri_recLen=recLen, ri_post=post;
+    unsigned ri_delta=delta, ri_ped=ped, ri_thr=thr_abs, ri_pairmask=pair_mask;
+    unsigned ri_savemask=saveMask, ri_enmask=enMask;
+    float ri_keepfrac = (features || spectra) ? (float)keepFrac : 1.0f;
+    std::string ri_trig = trig, ri_tag = tag;
+    std::string *ri_trigp = &ri_trig, *ri_tagp = &ri_tag;
+    unsigned long long ri_wall = startWallNs, ri_first = 0, ri_last = 0;
+    unsigned long long ri_events = 0, ri_trigs = 0, ri_gaps = 0;
+    unsigned ri_wraps = 0;
+    double ri_span = 0, ri_live = 0, ri_dead = 0, ri_deadfrac = 0;
+    double ri_trate = 0, ri_srate = 0;
+    double ri_iamin = 0, ri_iamean = 0;
+    unsigned ri_pedev = pcal.events;
+    int ri_tbucket = tBucket;
+    bool ri_pedcached = pedCached;
+    unsigned ri_gates[3] = {gates.pre, gates.shortLen, gates.longLen};
+    double ri_qmax = axes.qMax, ri_fomq = fomQMin;
+    unsigned ri_zle[3] = {zleThr, zlePre, zlePost};
+    double ri_zlered = 0;
+    // run: --run-number or allocated (0 = none); close_reason: 0 = end of the run, 1..3 = --rotate-events/mb/s, 4 = signal
+    unsigned ri_run = runNumber, ri_subrun = 0;
+    int ri_reason = 0;
+    unsigned long long ri_open = 0, ri_close = 0;
+    double ri_swrate = swRate;          // --sw-rate; baseline_events: how many of 'events' went to the baseline tag
+    unsigned long long ri_base = 0;
+    char iaLeaf[32];
+    snprintf(iaLeaf, sizeof(iaLeaf), "ia_hist[%d]/i", RunClock::kIaBins);
+    auto fillRunInfo = [&](const RunClock& c, uint32_t wraps, int reason)->TTree*{
+        ri_first = c.firstNs; ri_last = c.lastNs;
+        ri_events = c.events; ri_trigs = c.triggers(); ri_gaps = c.gaps; ri_wraps = wraps;
+        ri_span = c.span_s(); ri_live = c.live_s(); ri_dead = c.dead_s(); ri_deadfrac = c.dead_frac();
+        ri_trate = c.trigger_rate(); ri_srate = c.stored_rate();
+        ri_iamin = (double)c.iaMinNs; ri_iamean = c.ia_mean_ns();
+        ri_zlered = waves.zle_reduction();
+        ri_subrun = subrun; ri_reason = reason; ri_open = fileOpenWallNs; ri_close = wall_ns();
+        ri_base = fileBase;
+        rfile->cd();
+        TTree* runinfo = nullptr;
+        struct { const char* name; void* addr; const char* leaf; } rb[] = {
+            {"N",            &ri_N,        "N/I"},
+            {"ch",           &ri_ch,       "ch/I"},
+            {"recLen",       &ri_recLen,   "recLen/I"},
+            {"post",         &ri_post,     "post/I"},
+            {"delta",        &ri_delta,    "delta/i"},
+            {"ped",          &ri_ped,      "ped/i"},
+            {"ped_mean",     pcal.mean,    "ped_mean[8]/F"},
+            {"ped_rms",      pcal.rms,     "ped_rms[8]/F"},
+            {"ped_used",     pcal.used,    "ped_used[8]/i"},
+            {"ped_events",   &ri_pedev,    "ped_events/i"},
+            {"ped_cached",   &ri_pedcached,"ped_cached/O"},
+            {"temp_bucket",  &ri_tbucket,  "temp_bucket/I"},
+            {"thr_abs",      &ri_thr,      "thr_abs/i"},
+            {"pair_mask",    &ri_pairmask, "pair_mask/i"},
+            {"save_mask",    &ri_savemask, "save_mask/i"},
+            {"en_mask",      &ri_enmask,   "en_mask/i"},
+            {"keep_frac",    &ri_keepfrac, "keep_frac/F"},
+            {"trig_mode",    &ri_trigp,    nullptr},
+            {"tag",          &ri_tagp,     nullptr},
+            {"start_wall_ns",&ri_wall,     "start_wall_ns/l"},
+            {"t_first_ns",   &ri_first,    "t_first_ns/l"},
+            {"t_last_ns",    &ri_last,     "t_last_ns/l"},
+            {"ttt_wraps",    &ri_wraps,    "ttt_wraps/i"},
+            {"events",       &ri_events,   "events/l"},
+            {"triggers",     &ri_trigs,    "triggers/l"},
+            {"counter_gaps", &ri_gaps,     "counter_gaps/l"},
+            {"span_s",       &ri_span,     "span_s/D"},
+            {"live_s",       &ri_live,     "live_s/D"},
+            {"dead_s",       &ri_dead,     "dead_s/D"},
+            {"dead_frac",    &ri_deadfrac, "dead_frac/D"},
+            {"trigger_rate", &ri_trate,    "trigger_rate/D"},
+            {"stored_rate",  &ri_srate,    "stored_rate/D"},
+            {"ia_min_ns",    &ri_iamin,    "ia_min_ns/D"},
+            {"ia_mean_ns",   &ri_iamean,   "ia_mean_ns/D"},
+            {"ia_hist",      const_cast<uint32_t*>(c.ia), iaLeaf},
+            {"psd_fom",      psdFom,       "psd_fom[8]/F"},
+            {"psd_cut",      psdCut,       "psd_cut[8]/F"},
+            {"psd_gates",    ri_gates,     "psd_gates[3]/i"},
+            {"q_max",        &ri_qmax,     "q_max/D"},
+            {"fom_qmin",     &ri_fomq,     "fom_qmin/D"},
+            {"zle",          ri_zle,       "zle[3]/i"},
+            {"zle_reduction",&ri_zlered,   "zle_reduction/D"},
+            {"run",          &ri_run,      "run/i"},
+            {"subrun",       &ri_subrun,   "subrun/i"},
+            {"close_reason", &ri_reason,   "close_reason/I"},
+            {"open_wall_ns", &ri_open,     "open_wall_ns/l"},
+            {"close_wall_ns",&ri_close,    "close_wall_ns/l"},
+            {"sw_rate",      &ri_swrate,   "sw_rate/D"},
+            {"baseline_events",&ri_base,   "baseline_events/l"},
+            {"noise_events", &noiseEvents, "noise_events/l"},
+            {"noise_rms",    noiseRms,     "noise_rms[8]/F"},
+            {"noise_peak_mhz",noisePeak,   "noise_peak_mhz[8]/F"},
+        };
+        if((runinfo = (TTree*)rfile->Get("runinfo"))){
+            // Older files lack the timing branches: add them, zero-filled for the earlier runs.
+            const Long64_t prev = runinfo->GetEntries();
+            for(auto& b : rb){
+                if(runinfo->GetBranch(b.name)){ runinfo->SetBranchAddress(b.name, b.addr); continue; }
+                TBranch* br = b.leaf ? runinfo->Branch(b.name, b.addr, b.leaf)
+                                     : runinfo->Branch(b.name, *(std::string**)b.addr);
+                if(!br) continue;
+                if(prev>0){
+                    std::vector<char> zero(512, 0);
+                    br->SetAddress(b.leaf ? (void*)zero.data() : b.addr);
+                    for(Long64_t i=0;i<prev;++i) br->Fill();
+                    br->SetAddress(b.addr);
+                }
+            }
+        } else {
+            runinfo = new TTree("runinfo", "acquisition metadata and trigger clock (ns since acquisition start; "
+                                           "ia_hist: stored-event inter-arrival times, 10 bins/decade from 1 ns)");
+            for(auto& b : rb){
+                if(b.leaf) runinfo->Branch(b.name, b.addr, b.leaf);
+                else runinfo->Branch(b.name, *(std::string**)b.addr);
+            }
+        }
+        runinfo->Fill();
+        return runinfo;
+    };
 
-    while(got<N){
-        if(trig=="sw"){
-            CAEN_DGTZ_SendSWtrigger(handle);
-            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    // --rotate-*: the write stage keeps its own clock of the current file's events ('clk' belongs
+    // to decode), hands the full file to the closer thread and continues in the next one.
+    FileCloser closer;
+    RunClock fclk;
+    uint64_t fileEvents = 0, fileOpenNs = perf_now_ns();
+    const uint64_t rotateBytes = (uint64_t)(rotateMB*1e6), rotateNs = (uint64_t)(rotateS*1e9);
+    static const char* const kReason[] = {"end", "events", "size", "time", "signal", "abort"};
+    auto fileWraps = [&]{
+        constexpr uint64_t wrapNs = kX730TttWrap*kX730TickNs;
+        return fclk.events ? (uint32_t)(fclk.lastNs/wrapNs - fclk.firstNs/wrapNs) : 0u;
+    };
+    auto rotate = [&](int reason){
+        if(spec){
+            snapshotSpectra();
+            for(int c=0;c<8;++c){
+                if(!((saveMask>>c)&1)) continue;
+                const PsdFom f = spec->fom(c, fomQMin);
+                psdFom[c] = (float)f.fom; psdCut[c] = (float)f.cut;
+            }
         }
-        uint32_t bsz=0;
-        ok("ReadData", CAEN_DGTZ_ReadData(handle, CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT, rbuf, &bsz));
-        if(bsz==0){
-            auto now=std::chrono::steady_clock::now();
-            if(now-lastNote > std::chrono::seconds(5)){
-                printf("[stat] no data yet (waiting for triggers)...\n");
-                lastNote=now;
+        if(noiseW) snapshotNoise();
+        TTree* ri = fillRunInfo(fclk, fileWraps(), reason);
+        closer.submit({rfile, {temps, ftree, waves.tree, bwaves.tree, ri}, subrunPath(subrun), subrun, fileEvents});
+        subrun++;
+        fclk = RunClock{};
+        fileEvents = fileBase = 0; fileOpenNs = perf_now_ns();
+        openRoot(subrunPath(subrun));
+        printf("[rotate] subrun %u (%s) -> %s\n", subrun, kReason[reason], subrunPath(subrun).c_str());
+        fflush(stdout);
+    };
+    auto checkRotate = [&](uint64_t now){
+        if(!rotating || !rfile || !fileEvents) return;
+        int reason = 0;
+        if(rotateEvents && fileEvents >= rotateEvents) reason = 1;
+        else if(rotateBytes && (double)rfile->GetBytesWritten() >= (double)rotateBytes) reason = 2;
+        else if(rotateNs && now - fileOpenNs >= rotateNs) reason = 3;
+        if(reason) rotate(reason);
+    };
+
+    uint64_t got=0;
+    const double wrCpu0 = thread_cpu_sec();
+    // [evt] lines are rate limited: at 10k ev/s a printf per event costs more than the ROOT fill
+    const uint64_t evtGapNs = evtRate>0 ? (uint64_t)(1e9/evtRate) : 0;
+    uint64_t nextEvtNs = 0, nextSnapNs = 0;
+    const uint64_t liveGapNs = liveHz>0 ? (uint64_t)(1e9/liveHz) : 0;
+    uint64_t nextLiveNs = 0, nextLiveStNs = 0;
+    uint64_t liveTrig = 0, liveLastTNs = 0, liveEv0 = 0, liveTrig0 = 0, liveTNs0 = 0; // rates over t_ns between updates
+    uint32_t liveLastCnt = 0;
+    auto liveStatus = [&](uint64_t now){
+        if(now < nextLiveStNs) return;
+        const double dt = (liveLastTNs - liveTNs0)*1e-9;
+        const uint64_t dEv = got - liveEv0, dTrig = liveTrig - liveTrig0;
+        if(dt > 0){
+            liveSt.eventRate = dEv/dt; liveSt.triggerRate = dTrig/dt;
+            liveSt.deadFrac = dTrig > dEv ? 1.0 - double(dEv)/dTrig : 0.0;
+        } else if(!dEv) liveSt.eventRate = liveSt.triggerRate = liveSt.deadFrac = 0;
+        liveSt.events = got; liveSt.triggers = liveTrig;
+        liveSt.updateWallNs = wall_ns();
+        live.set_status(liveSt);
+        liveTNs0 = liveLastTNs; liveEv0 = got; liveTrig0 = liveTrig;
+        nextLiveStNs = now + 500000000ull;
+    };
+    // In-run temperature samples from the readout thread: into 'temps' and the live status.
+    size_t tempsSeen = 0;
+    std::vector<TempSample> tempNew;
+    auto drainTemps = [&]{
+        if(tsamp.ndone.load(std::memory_order_acquire) == tempsSeen) return;
+        tsamp.take(tempsSeen, tempNew);
+        tempsSeen += tempNew.size();
+        for(const auto& ts : tempNew){
+            if(rfile && temps){
+                t_when = 2; t_tns = ts.tNs; t_wall = ts.wallNs;
+                std::copy(ts.temp, ts.temp+8, t_temp);
+                temps->Fill();
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            continue;
+            if(live.is_open()) liveTemps(ts.temp, ts.wallNs);
         }
-        uint32_t nev=0; ok("GetNumEvents", CAEN_DGTZ_GetNumEvents(handle, rbuf, bsz, &nev));
-        for(uint32_t i=0;i<nev && got<N;++i){
-            CAEN_DGTZ_EventInfo_t info; char* ep=nullptr;
-            ok("GetEventInfo", CAEN_DGTZ_GetEventInfo(handle, rbuf, bsz, i, &info, &ep));
-            ok("DecodeEvent",  CAEN_DGTZ_DecodeEvent(handle, ep, &evt));
-            auto* e=(CAEN_DGTZ_UINT16_EVENT_t*)evt;
-            uint32_t ns = e? e->ChSize[ch] : 0;
-            printf("[evt] #%d  size=%u  chMask=0x%08x  cnt=%u  ttag=%u  ns=%u\n",
-                   got, info.EventSize, info.ChannelMask, info.EventCounter, info.TriggerTimeTag, ns);
-
-            // Text output
-            if(ns>0 && ( !txt.empty() || !txtdir.empty() )){
-                if(!txtdir.empty()){
-                    char tmp[512];
-                    snprintf(tmp, sizeof(tmp), "%s/waveform_%d.txt", txtdir.c_str(), got);
-                    std::ofstream fout(tmp, std::ios::app);
-                    if(fout.is_open()){
-                        fout << "# Event " << got << "  tag=" << tag << "  trig=" << trig
-                             << "  ch=" << ch << "  size=" << ns
-                             << "  cnt=" << info.EventCounter << "  ttag=" << info.TriggerTimeTag << "\n";
-                        for(uint32_t s=0; s<ns; ++s) fout << e->DataChannel[ch][s] << "\n";
-                        fout << "\n";
-                    } else {
-                        fprintf(stderr,"[warn] cannot write '%s'\n", tmp);
-                    }
-                } else if(txt_out.is_open()){
-                    txt_out << "# Event " << got << "  tag=" << tag << "  trig=" << trig
-                            << "  ch=" << ch << "  size=" << ns
-                            << "  cnt=" << info.EventCounter << "  ttag=" << info.TriggerTimeTag << "\n";
-                    for(uint32_t s=0; s<ns; ++s) txt_out << e->DataChannel[ch][s] << "\n";
-                    txt_out << "\n";
+    };
+    {
+        Backoff bo;
+        for(;;){
+            uint32_t ei;
+            if(!readyEvents.try_pop(ei)){
+                if(decDone && readyEvents.size()==0) break;
+                drainTemps();
+                if(live.is_open()) liveStatus(perf_now_ns());
+                if(rotating) checkRotate(perf_now_ns());
+                bo.wait(); continue;
+            }
+            bo.reset();
+            drainTemps();
+            const Event& ev = events[ei];
+            const auto& info = ev.info;
+            if(rotating) fclk.add_ns(info.EventCounter, ev.tNs);
+            if(live.is_open()){
+                liveTrig += got ? (info.EventCounter - liveLastCnt) & 0xFFFFFFu : 1;
+                liveLastCnt = info.EventCounter; liveLastTNs = ev.tNs;
+                const uint64_t now = perf_now_ns();
+                if(now >= nextLiveNs && liveGapNs){
+                    live.publish(ev.tNs, info.EventCounter, info.TriggerTimeTag, ev.wave, ev.ns);
+                    nextLiveNs = now + liveGapNs;
+                }
+                liveStatus(now);
+            }
+            if(doWrite && noiseW && ev.src==kSrcSw) noiseW->offer(ev.wave, ev.ns);
+            uint64_t rootNs = 0; bool didRoot = false;
+            if(doWrite && ftree){
+                const uint64_t tf0 = perf_now_ns();
+                f_cnt = info.EventCounter; f_ttt = info.TriggerTimeTag; f_mask = info.ChannelMask; f_tns = ev.tNs;
+                f_kept = ev.keep; f_src = ev.src;
+                for(int c=0;c<8;++c){
+                    const PulseFeatures& pf = ev.feat[c];
+                    const bool have = ev.ns[c]>0;
+                    f_base[c] = have ? pf.baseline : 0;  f_rms[c] = have ? pf.rms : 0;
+                    f_amp[c]  = have ? pf.amplitude : 0; f_peak[c] = have ? pf.peak : 0;
+                    f_int[c]  = have ? pf.integral : 0;  f_cfd[c] = have ? pf.tCfd : -1;
+                    f_qs[c]   = have ? ev.qShort[c] : 0;  f_ql[c]  = have ? ev.qLong[c] : 0;
                 }
+                ftree->Fill();
+                rootNs += perf_now_ns() - tf0; didRoot = true;
             }
+            if(doWrite && ev.keep){
+                if(evtRate>0){
+                    const uint64_t now = perf_now_ns();
+                    if(now >= nextEvtNs){
+                        printf("[evt] #%llu  size=%u  chMask=0x%08x  cnt=%u  ttag=%u  ns=%u\n",
+                               (unsigned long long)ev.idx, info.EventSize, info.ChannelMask, info.EventCounter, info.TriggerTimeTag, ev.ns[ch]);
+                        nextEvtNs = now + evtGapNs;
+                    }
+                }
 
-            // ROOT output
-            if(rfile && dtag && ns>0){
-                dtag->cd();
-                char hname[128], htitle[256];
-                snprintf(hname,  sizeof(hname),  "wave_ev%06d_ch%d", got, ch);
-                snprintf(htitle, sizeof(htitle), "Event %d, ch %d;sample;ADC", got, ch);
-                TH1I h(hname, htitle, ns, 0.0, double(ns));
-                for(uint32_t s=0; s<ns; ++s) h.SetBinContent(int(s)+1, e->DataChannel[ch][s]);
-                h.Write();
-                rfile->cd(); // back to root dir
+                // Text output: one block per saved channel (copied here, formatted by the writer thread)
+                if(doText){
+                    ScopedNs timeText{perf->textNs};
+                    textOut.add(ev.idx, info.EventCounter, info.TriggerTimeTag, ev.wave, ev.ns);
+                }
+
+                // ROOT output; baseline events of a mixed run go to their own tag
+                const bool base = mixed && ev.src==kSrcSw;
+                if(base){ nBase++; fileBase++; }
+                WavesTree& wv = base ? bwaves : waves;
+                TDirectory* dir = base ? btag : dtag;
+                const uint64_t tr0 = perf_now_ns();
+                if(wv.tree){
+                    wv.EventCounter   = info.EventCounter;
+                    wv.TriggerTimeTag = info.TriggerTimeTag;
+                    wv.TimeNs         = ev.tNs;
+                    wv.ChannelMask    = info.ChannelMask;
+                    for(int c=0;c<8;++c){
+                        if(!ev.wave[c]) continue;
+                        if(wv.zle) wv.set_roi(c, ev.wave[c], ev.ns[c], ev.seg[c], ev.ns[c] ? ev.nseg[c] : 0);
+                        else wv.set(c, ev.wave[c], ev.ns[c]);
+                    }
+                    wv.fill();
+                } else if(rfile && dir){
+                    dir->cd();
+                    for(int c=0;c<8;++c){
+                        const uint32_t ns = ev.ns[c];
+                        if(!ns) continue;
+                        char hname[128], htitle[256];
+                        snprintf(hname,  sizeof(hname),  "wave_ev%06llu_ch%d", (unsigned long long)ev.idx, c);
+                        snprintf(htitle, sizeof(htitle), "Event %llu, ch %d", (unsigned long long)ev.idx, c);
+                        std::unique_ptr<TH1I>& h = th1[c];
+                        if(!h || h->GetNbinsX()!=int(ns)){
+                            h.reset(new TH1I(hname, htitle, ns, 0.0, double(ns)));
+                            h->SetDirectory(nullptr);
+                            h->GetXaxis()->SetTitle("sample"); h->GetYaxis()->SetTitle("ADC");
+                        } else {
+                            h->SetName(hname); h->SetTitle(htitle);
+                        }
+                        for(uint32_t s=0; s<ns; ++s) h->SetBinContent(int(s)+1, ev.wave[c][s]);
+                        h->SetEntries(ns);
+                        h->Write();
+                    }
+                    rfile->cd(); // back to root dir
+                }
+                if(wv.tree || (rfile && dir)){ rootNs += perf_now_ns() - tr0; didRoot = true; }
             }
+            if(didRoot) perf->rootNs.record(rootNs);
+            if(spec && spectraSnap>0){
+                const uint64_t now = perf_now_ns();
+                if(!nextSnapNs) nextSnapNs = now + (uint64_t)(spectraSnap*1e9);
+                else if(now >= nextSnapNs){ snapshotSpectra(); nextSnapNs = now + (uint64_t)(spectraSnap*1e9); }
+            }
+            got++; fileEvents++;
+            freeEvents.try_push(ei);
+            if(rotating) checkRotate(perf_now_ns());
+        }
+    }
+    readout.join();
+    decode.join();
+    if(abortRun){
+        CAEN_DGTZ_SWStopAcquisition(handle);
+        if(useIrq) CAEN_DGTZ_SetInterruptConfig(handle, CAEN_DGTZ_DISABLE, 1, 0xAAAA, 1, CAEN_DGTZ_IRQ_MODE_RORA);
+        // Keep what was taken: the trees are written as in the normal finalize, runinfo marks the abort
+        if(rfile){
+            drainTemps();
+            TTree* ri = fillRunInfo(rotating ? fclk : clk, rotating ? fileWraps() : clk.wraps(), 5);
+            waves.write();
+            bwaves.write();
+            if(ftree){
+                if(TDirectory* d = ftree->GetDirectory()) d->cd();
+                ftree->Write("", TObject::kOverwrite);
+            }
+            rfile->cd();
+            if(temps) temps->Write("", TObject::kOverwrite);
+            ri->Write("", TObject::kOverwrite);
+            rfile->Write();
+            rfile->Close();
+            delete rfile;
+            rfile = nullptr;
+            fprintf(stderr,"[ERR] run aborted after %llu events (%s); written to %s\n",
+                    (unsigned long long)got, threadErr.c_str(), subrunPath(subrun).c_str());
+        }
+        closer.stop();
+        throw DaqError(threadErr);
+    }
+    drainTemps();
+    if(!rawOut.empty()){
+        got = decoded;
+        raw.close();
+        printf("[raw] %.1f MB in %llu blocks -> %s\n", raw.bytes_written()/1e6, (unsigned long long)bltReads, rawOut.c_str());
+    }
+    const double acqSec = std::chrono::duration<double>(std::chrono::steady_clock::now()-tAcq0).count();
+
+    if(doText){
+        const auto tTxt = std::chrono::steady_clock::now();
+        textOut.close();
+        printf("[txt] %.1f MB in %llu file(s), drained in %.1f ms\n", textOut.bytes_written()/1e6,
+               (unsigned long long)(txtdir.empty() ? 1 : textOut.files_opened()),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-tTxt).count());
+    }
+    const double wrCpuSec = thread_cpu_sec() - wrCpu0;
 
-            got++;
+    // Final spectra and the PSD figure of merit per saved channel
+    if(spec){
+        snapshotSpectra();
+        for(int c=0;c<8;++c){
+            if(!((saveMask>>c)&1)) continue;
+            const PsdFom f = spec->fom(c, fomQMin);
+            psdFom[c] = (float)f.fom; psdCut[c] = (float)f.cut;
+            printf("[psd] ch%d FOM %.3f  cut %.3f  low %.3f+-%.3f (%llu)  high %.3f+-%.3f (%llu)  Q_long >= %.0f\n",
+                   c, f.fom, f.cut, f.m1, f.s1, (unsigned long long)f.n1, f.m2, f.s2, (unsigned long long)f.n2, fomQMin);
         }
+        printf("[psd] %u snapshot(s), %.1f ms total\n", snapshots, snapMs);
+    }
+    // Final noise: drain the worker, then the band summaries (low: < 1 MHz, high: > 10 MHz)
+    float noiseLf[8] = {}, noiseHf[8] = {};
+    if(noiseW){
+        const uint64_t tn0 = perf_now_ns();
+        noiseW->finish();
+        const double drainMs = (perf_now_ns() - tn0)*1e-6;
+        snapshotNoise();
+        noiseW->read([&](const NoiseAccum& na){
+            for(int c=0;c<8;++c){
+                if(!na.events(c)) continue;
+                noiseLf[c] = (float)na.band_rms(c, 0, 1e6); noiseHf[c] = (float)na.band_rms(c, 10e6, 1e12);
+                printf("[noise] ch%d rms %.2f ADC, PSD peak %.2f MHz, < 1 MHz %.2f ADC, > 10 MHz %.2f ADC (%llu events)\n",
+                       c, noiseRms[c], noisePeak[c], noiseLf[c], noiseHf[c], (unsigned long long)na.events(c));
+            }
+            printf("[noise] %llu of %llu sw events used (%llu dropped while the worker was busy), %u-point FFT, %s; drained in %.1f ms\n",
+                   noiseEvents, (unsigned long long)noiseW->offered() + noiseW->dropped(),
+                   (unsigned long long)noiseW->dropped(), na.nfft(), na.kernel(), drainMs);
+        });
+    }
+
+    {
+        rusage ru{}; getrusage(RUSAGE_SELF, &ru);
+        const double procCpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec*1e-6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec*1e-6;
+        printf("[readout] mode=%s  trigger rate %.1f Hz  cpu: readout %.1f%%, process %.1f%% (of one core)  empty reads=%llu",
+               useIrq ? "irq" : "poll", acqSec>0 ? got/acqSec : 0.0,
+               acqSec>0 ? 100*roCpuSec/acqSec : 0.0, acqSec>0 ? 100*(procCpu-cpuAtStart)/acqSec : 0.0,
+               (unsigned long long)emptyReads);
+        if(useIrq)   printf("  irq waits=%llu timeouts=%llu", (unsigned long long)irqWaits, (unsigned long long)irqTimeouts);
+        if(trig=="sw") printf("  sw sent=%llu lost=%llu burst=%d", (unsigned long long)swSent, (unsigned long long)swLost, swBurst);
+        if(mixed) printf("  sw injected=%llu", (unsigned long long)swInjected);
+        printf("\n");
+    }
+    printf("[pipe] stages=%s  %.1f ev/s  %.2f MB/s  BLT=%llu (%.1f ev/BLT)\n",
+           stages.c_str(), acqSec>0 ? got/acqSec : 0.0, acqSec>0 ? bltBytes/acqSec/1e6 : 0.0,
+           (unsigned long long)bltReads, bltReads ? double(got)/bltReads : 0.0);
+    printf("[pipe] backpressure: readout waited %llu x (%.1f ms) for a buffer, decode waited %llu x (%.1f ms) for an event slot;"
+           " high-water blocks=%zu/%d events=%zu/%d\n",
+           (unsigned long long)roStalls.load(), roStallNs.load()/1e6,
+           (unsigned long long)decStalls.load(), decStallNs.load()/1e6,
+           fullHW, nbuf, readyHW, nevt);
+    if(got>0) printf("[pipe] cpu per event: readout %.2f us, decode %.2f us, write %.2f us\n",
+                     1e6*roCpuSec/got, 1e6*decCpuSec/got, 1e6*wrCpuSec/got);
+
+    struct PerfMetric { const char* name; const LogHist* h; double scale; const char* unit; };
+    const PerfMetric metrics[] = {
+        {"readdata_ns",   &perf->readNs,    1e-3, "us"},
+        {"blt_bytes",     &perf->bltBytes,  1e-3, "kB"},
+        {"blt_events",    &perf->bltEvents, 1,    "ev"},
+        {"buf_occupancy", &perf->bufOcc,    1,    "blocks"},
+        {"decode_ns",     &perf->decodeNs,  1e-3, "us"},
+        {"text_ns",       &perf->textNs,    1e-3, "us"},
+        {"root_ns",       &perf->rootNs,    1e-3, "us"},
+    };
+    constexpr size_t nMetrics = sizeof(metrics)/sizeof(metrics[0]);
+    for(const auto& m : metrics){
+        const LogHist& h = *m.h;
+        if(!h.count()) continue;
+        printf("[perf] %-13s n=%-8llu mean %8.2f  p50 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f %s\n",
+               m.name, (unsigned long long)h.count(), h.mean()*m.scale, h.percentile(0.5)*m.scale,
+               h.percentile(0.99)*m.scale, h.percentile(0.999)*m.scale, double(h.max())*m.scale, m.unit);
+    }
+    const uint64_t cntGaps = clk.gaps;
+    const double deadFrac = clk.dead_frac();
+    if(clk.events>1)
+        printf("[rate] %llu triggers, %llu lost while busy; over %.3f s of trigger time: live %.3f s, dead %.3f s (%.2f%%),"
+               " trigger rate %.1f Hz, stored %.1f Hz, %u TTT rollovers\n",
+               (unsigned long long)clk.triggers(), (unsigned long long)cntGaps, clk.span_s(), clk.live_s(), clk.dead_s(),
+               100*deadFrac, clk.trigger_rate(), clk.stored_rate(), clk.wraps());
+    if(mixed)
+        printf("[mixed] %llu software triggers sent at %.4g Hz; %llu baseline events -> '%s', %llu self-triggered -> '%s'\n",
+               (unsigned long long)swInjected, swRate, (unsigned long long)nBase, baseTag.c_str(),
+               (unsigned long long)(got - nBase), tag.c_str());
+    if(tempEvery > 0)
+        printf("[temp] %zu samples during the run, every %.4g s; %llu channel reads could not wait for an empty board\n",
+               tempsSeen, tempEvery, (unsigned long long)tsamp.forced);
+    // Reduction of the stored records; the scan rate is what the decode stage can sustain.
+    const double zleRed = waves.zle_reduction();
+    if(zleThr && zleRecords){
+        const char* kname = "";
+        zle_best_mask(&kname);
+        printf("[zle] kept %llu of %llu samples (reduction %.1fx), %.2f regions per record; scan %.0f Msamples/s (%s)\n",
+               (unsigned long long)waves.roiSamples, (unsigned long long)waves.recSamples, zleRed,
+               double(zleSegs)/zleRecords, zleNs ? double(zleRecords)*recLen/(zleNs*1e-9)/1e6 : 0.0, kname);
     }
 
-    if(txt_out.is_open()) txt_out.close();
+    if(!perfLp.empty()){
+        std::string fields;
+        lp_field(fields, "events", double(got));
+        lp_field(fields, "acq_s", acqSec);
+        lp_field(fields, "counter_gaps", double(cntGaps));
+        lp_field(fields, "dead_frac", deadFrac);
+        lp_field(fields, "live_s", clk.live_s());
+        lp_field(fields, "trigger_rate_hz", clk.trigger_rate());
+        if(zleThr) lp_field(fields, "zle_reduction", zleRed);
+        for(int c=0;c<8;++c){
+            if(!noiseW || !noiseRms[c]) continue;
+            const std::string n = std::to_string(c);
+            lp_field(fields, ("noise_rms_ch" + n).c_str(), noiseRms[c]);
+            lp_field(fields, ("noise_peak_mhz_ch" + n).c_str(), noisePeak[c]);
+            lp_field(fields, ("noise_lf_ch" + n).c_str(), noiseLf[c]);
+            lp_field(fields, ("noise_hf_ch" + n).c_str(), noiseHf[c]);
+        }
+        for(const auto& m : metrics){
+            if(!m.h->count()) continue;
+            const std::string n = m.name;
+            lp_field(fields, (n+"_mean").c_str(), m.h->mean());
+            lp_field(fields, (n+"_p50").c_str(),  m.h->percentile(0.5));
+            lp_field(fields, (n+"_p99").c_str(),  m.h->percentile(0.99));
+            lp_field(fields, (n+"_max").c_str(),  double(m.h->max()));
+        }
+        char host[256] = {};
+        gethostname(host, sizeof(host)-1);
+        std::string line = lp_escape(std::string(bi.ModelName) + "_perf") + ",host=" + lp_escape(host)
+                         + ",device=" + lp_escape(bi.ModelName) + ",tag=" + lp_escape(tag)
+                         + " " + fields + " " + std::to_string(wall_ns()) + "\n";
+        // In-run temperatures as read_temp_influx writes them, which skips readings while a run holds the board
+        std::vector<TempSample> tall;
+        tsamp.take(0, tall);
+        for(const auto& ts : tall){
+            std::string tf;
+            for(int c=0;c<8;++c) if(ts.temp[c] < 200) lp_field(tf, ("temp_ch" + std::to_string(c)).c_str(), ts.temp[c]);
+            if(!tf.empty()) line += lp_escape(bi.ModelName) + ",host=" + lp_escape(host) + ",device=" + lp_escape(bi.ModelName)
+                                  + " " + tf + " " + std::to_string(ts.wallNs) + "\n";
+        }
+        FILE* f = perfLp=="-" ? stdout : fopen(perfLp.c_str(), "a");
+        if(!f) fprintf(stderr,"[warn] cannot append to --perf-lp '%s'\n", perfLp.c_str());
+        else {
+            fputs(line.c_str(), f);
+            if(f!=stdout) fclose(f);
+        }
+    }
 
-    ok("SWStopAcquisition", CAEN_DGTZ_SWStopAcquisition(handle));
+    if(!stoppedEarly) ok("SWStopAcquisition", CAEN_DGTZ_SWStopAcquisition(handle));
+    if(useIrq) CAEN_DGTZ_SetInterruptConfig(handle, CAEN_DGTZ_DISABLE, 1, 0xAAAA, 1, CAEN_DGTZ_IRQ_MODE_RORA);
 
     // Temperatures at end
     read_temperatures(handle, tempEnd);
+    if(live.is_open()){
+        liveTemps(tempEnd.data(), wall_ns());
+        liveSt.state = kLiveEnded;
+        liveSt.events = got; liveSt.triggers = clk.triggers();
+        liveSt.eventRate = clk.stored_rate(); liveSt.triggerRate = clk.trigger_rate(); liveSt.deadFrac = deadFrac;
+        liveSt.updateWallNs = wall_ns();
+        live.set_status(liveSt);
+    }
     if(rfile && temps){
-        t_when = 1;
+        t_when = 1; t_tns = perf_now_ns() - acq0Ns; t_wall = wall_ns();
         for(int i=0;i<8;++i) t_temp[i] = tempEnd[i];
         temps->Fill();
     }
 
-    // Cleanup digitizer
-    if(evt)  CAEN_DGTZ_FreeEvent(handle,&evt);
-    if(rbuf) CAEN_DGTZ_FreeReadoutBuffer(&rbuf);
-    CAEN_DGTZ_CloseDigitizer(handle);
+    // One 'perf' entry per run: the histogram summaries above plus the EventCounter dead time
+    TTree* perfTree = nullptr;
+    char p_tag[64];
+    snprintf(p_tag, sizeof(p_tag), "%s", tag.c_str());
+    unsigned long long p_events = (unsigned long long)got, p_gaps = cntGaps;
+    double p_acq = acqSec, p_dead = deadFrac;
+    PerfRow p_rows[nMetrics];
+    if(rfile){
+        for(size_t i=0;i<nMetrics;++i) p_rows[i] = perf_row(*metrics[i].h);
+        std::vector<std::pair<const char*, void*>> addr = {
+            {"tag", p_tag}, {"events", &p_events}, {"counter_gaps", &p_gaps}, {"dead_frac", &p_dead}, {"acq_s", &p_acq}};
+        for(size_t i=0;i<nMetrics;++i) addr.push_back({metrics[i].name, &p_rows[i]});
+        if((perfTree = (TTree*)rfile->Get("perf"))){
+            for(auto& a : addr) perfTree->SetBranchAddress(a.first, a.second);
+        } else {
+            perfTree = new TTree("perf","hot-path latency/size histogram summaries per run (ns, bytes, events, blocks)");
+            perfTree->Branch("tag",          p_tag,     "tag/C");
+            perfTree->Branch("events",       &p_events, "events/l");
+            perfTree->Branch("counter_gaps", &p_gaps,   "counter_gaps/l");
+            perfTree->Branch("dead_frac",    &p_dead,   "dead_frac/D");
+            perfTree->Branch("acq_s",        &p_acq,    "acq_s/D");
+            for(size_t i=0;i<nMetrics;++i) perfTree->Branch(metrics[i].name, &p_rows[i], kPerfLeaves);
+        }
+        perfTree->Fill();
+    }
+
+    // One 'runinfo' entry per run, or per file of a rotated run
+    TTree* runinfo = rfile ? fillRunInfo(rotating ? fclk : clk, rotating ? fileWraps() : clk.wraps(), g_stopSignal ? 4 : 0) : nullptr;
 
+    g_temps.poll(handle); // a TEMP request that raced the end of the run
     // Finalize ROOT
+    const auto tFin = std::chrono::steady_clock::now();
     if(rfile){
         // write trees updated above
+        if(waves.tree && waves.packedBytes)
+            printf("[info] packed waveforms: %.1f MB -> %.1f MB (ratio %.2f)\n",
+                   waves.rawBytes/1e6, waves.packedBytes/1e6, waves.pack_ratio());
+        waves.write();
+        bwaves.write();
+        if(ftree){
+            if(TDirectory* d = ftree->GetDirectory()) d->cd();
+            ftree->Write("", TObject::kOverwrite);
+        }
+        rfile->cd();
         if(temps) temps->Write("", TObject::kOverwrite);
         if(runinfo) runinfo->Write("", TObject::kOverwrite);
+        if(perfTree) perfTree->Write("", TObject::kOverwrite);
         rfile->Write();
         rfile->Close();
         delete rfile;
+        rfile = nullptr;
+        if((rotating || continuous) && !fsync_path(subrunPath(subrun)))
+            fprintf(stderr,"[warn] fsync of '%s' failed\n", subrunPath(subrun).c_str());
+        printf("[time] finalize %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-tFin).count());
     }
+    closer.stop();
+    if(rotating)
+        printf("[rotate] run %06u: %u file(s) closed in the background (%.1f ms each), writes waited %.1f ms for a close; last %s\n",
+               runNumber, closer.closed, closer.closed ? closer.closeMs/closer.closed : 0.0, closer.waitMs, subrunPath(subrun).c_str());
 
-    printf("[ok] Collected %d events. Bye.\n", got);
+    if(summary){
+        summary->events  = (int)got;
+        summary->setupMs = setupMs;
+        summary->acqSec  = acqSec;
+    }
+    printf("[ok] Collected %llu events%s.\n", (unsigned long long)got, g_stopSignal ? " (stopped by signal)" : "");
     return 0;
 }
+
+// --daemon: keep the board open and take requests on a UNIX socket (protocol in common/daq_socket.h).
+// One run at a time; TEMP is answered directly between runs and by the readout thread during one.
+static int serve(int handle, const CAEN_DGTZ_BoardInfo_t& bi, const std::string& path){
+    std::signal(SIGPIPE, SIG_IGN);
+    const int lfd = unix_listen(path);
+    if(lfd<0) return 1;
+    g_listenFd = lfd;
+    printf("[daemon] serial=%u listening on %s\n", bi.SerialNumber, path.c_str());
+    fflush(stdout);
+
+    std::mutex runMutex;           // held for the whole of a run
+    std::atomic<int> clients{0};
+    std::atomic<bool> quit{false};
+
+    auto fmt_temps = [](const std::vector<uint32_t>& t){
+        std::string r = "OK temp";
+        for(uint32_t v : t) r += (v==std::numeric_limits<uint32_t>::max()) ? " -1" : " " + std::to_string(v);
+        return r;
+    };
+
+    auto handle_request = [&](const std::string& line)->std::string{
+        std::vector<std::string> tok;
+        for(size_t p=0; p<line.size(); ){
+            const size_t q = line.find_first_of(" \t", p);
+            if(q!=p) tok.push_back(line.substr(p, q==std::string::npos ? std::string::npos : q-p));
+            if(q==std::string::npos) break;
+            p = q+1;
+        }
+        if(tok.empty()) return "ERR empty request";
+        const std::string cmd = tok[0];
+        if(cmd=="PING"){
+            const bool busy = !runMutex.try_lock();
+            if(!busy) runMutex.unlock();
+            return "OK pong serial=" + std::to_string(bi.SerialNumber) + " busy=" + (busy ? "1" : "0");
+        }
+        if(cmd=="TEMP"){
+            std::vector<uint32_t> t;
+            if(runMutex.try_lock()){
+                read_temperatures(handle, t);
+                runMutex.unlock();
+                return fmt_temps(t);
+            }
+            if(g_temps.request(t, std::chrono::milliseconds(2000))) return fmt_temps(t);
+            return "ERR busy (run in setup)";
+        }
+        if(cmd=="QUIT"){
+            if(!runMutex.try_lock()) return "ERR busy";
+            quit = true;
+            runMutex.unlock();
+            shutdown(lfd, SHUT_RDWR); // wakes accept()
+            return "OK bye";
+        }
+        if(cmd=="RUN"){
+            std::unique_lock<std::mutex> lk(runMutex, std::try_to_lock);
+            if(!lk.owns_lock()) return "ERR busy";
+            printf("[daemon] %s\n", line.c_str());
+            fflush(stdout);
+            RunSummary sum;
+            int rc;
+            std::string why;
+            try {
+                rc = run_acquisition(handle, bi, std::vector<std::string>(tok.begin()+1, tok.end()), &sum);
+            } catch(const std::exception& e){
+                rc = 1; why = e.what();
+            }
+            g_temps.poll(handle);
+            fflush(stdout);
+            if(rc==2) return "ERR bad options";
+            if(rc!=0) return "ERR " + (why.empty() ? std::string("run failed") : why);
+            char r[160];
+            snprintf(r, sizeof(r), "OK events=%d setup_ms=%.1f acq_s=%.3f", sum.events, sum.setupMs, sum.acqSec);
+            return r;
+        }
+        return "ERR unknown command '" + cmd + "'";
+    };
+
+    while(!quit && !g_stopSignal){
+        const int fd = accept4(lfd, nullptr, nullptr, SOCK_CLOEXEC);
+        if(fd<0){
+            if(errno==EINTR || errno==ECONNABORTED) continue;
+            break;
+        }
+        clients++;
+        std::thread([&, fd]{
+            std::string line;
+            if(sock_read_line(fd, line)) sock_write_all(fd, handle_request(line) + "\n");
+            close(fd);
+            clients--;
+        }).detach();
+    }
+    while(clients>0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    g_listenFd = -1;
+    close(lfd);
+    unlink(path.c_str());
+    printf("[daemon] stopped\n");
+    return 0;
+}
+
+int main(int argc,char**argv){
+    const std::vector<std::string> args(argv+1, argv+argc);
+    int link=0;
+    std::string daemonSock;
+    for(size_t i=0;i<args.size();++i){
+        if(args[i]=="-h"||args[i]=="--help"){ usage(argv[0]); return 0; }
+        if(i+1<args.size() && args[i]=="--link") link=std::atoi(args[i+1].c_str());
+        if(i+1<args.size() && args[i]=="--daemon") daemonSock=args[i+1];
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    // Open (the first run resets the board unless the config cache says it is already programmed)
+    const auto tOpen = std::chrono::steady_clock::now();
+    int handle=-1;
+    CAEN_DGTZ_BoardInfo_t bi{};
+    try {
+        ok("OpenDigitizer", CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_USB, link, 0, 0, &handle));
+        ok("GetInfo", CAEN_DGTZ_GetInfo(handle, &bi));
+    } catch(const DaqError&){
+        if(handle>=0) CAEN_DGTZ_CloseDigitizer(handle);
+        return 1;
+    }
+    printf("[board] Model=%s  ROC=%s  AMC=%s  Ch=%u  link=%d  serial=%u\n",
+           bi.ModelName, bi.ROC_FirmwareRel, bi.AMC_FirmwareRel, bi.Channels, link, bi.SerialNumber);
+    printf("[time] open %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-tOpen).count());
+
+    int rc;
+    try {
+        rc = daemonSock.empty() ? run_acquisition(handle, bi, args) : serve(handle, bi, daemonSock);
+    } catch(const DaqError&){
+        rc = 1; // already reported by die() / the abort path
+    }
+    CAEN_DGTZ_CloseDigitizer(handle);
+    if(rc==0 && daemonSock.empty()) printf("[ok] Bye.\n");
+    return rc;
+}
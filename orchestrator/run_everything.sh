@@ -2,7 +2,7 @@
 set -euo pipefail
 #source "/home/ANNIE/daq/orchestrator/.env"
 
-export INFLUX_HOST INFLUX_PORT INFLUX_DB INFLUX_USER INFLUX_PASS
+export INFLUX_HOST INFLUX_PORT INFLUX_DB INFLUX_USER INFLUX_PASS INFLUX_SPOOL
 export DATA_DIR UTILS_DIR SW_BIN TH_BIN
 
 # -------- defaults if .env doesn't define them --------
@@ -15,19 +15,35 @@ export DATA_DIR UTILS_DIR SW_BIN TH_BIN
 : "${DAQ_THRESHOLD:=164}" #20mV
 : "${TH_N_EVENTS:=10000}"
 : "${SW_N_EVENTS:=1000}"
+: "${SW_BURST:=32}"
+: "${MIXED_SW_RATE:=0}" # >0: no separate SW run; baseline triggers at this rate (Hz) inside the threshold run
+: "${WAVE_FORMAT:=th1}" # th1 | tree | packed (codec-packed samples: smaller files to rsync)
+: "${DAQ_SOCK:=/home/ANNIE/daq/.daq.sock}"
+: "${PERF_LP:=${DATA_DIR}/perf.lp}" # per-run hot-path stats (Influx line protocol), posted after the runs
 
 # Influx v1 (optional defaults)
 : "${INFLUX_HOST:=192.168.197.46}"
 : "${INFLUX_PORT:=8086}"
 : "${INFLUX_DB:=AmBeHV}"
+: "${INFLUX_SPOOL:=/home/ANNIE/daq/spool/influx.lp}" # points kept while Influx is down, replayed by influx_push
 
-# -------- single-host lock to avoid CAEN collisions --------
-lock="/home/ANNIE/daq/.caen.lock"
-exec 9>"$lock"
-flock -n 9 || { echo "[warn] DAQ busy (lock)"; exit 0; }
+# -------- acquisition daemon (keeps the board open) or one process per run --------
+# The daemon serializes runs itself; without it, take the single-host lock to avoid CAEN collisions.
+if "${UTILS_DIR}/daqctl" -s "${DAQ_SOCK}" PING >/dev/null 2>&1; then
+  daq_run() { shift; "${UTILS_DIR}/daqctl" -s "${DAQ_SOCK}" RUN "$@"; } # binary arg unused
+else
+  lock="/home/ANNIE/daq/.caen.lock"
+  exec 9>"$lock"
+  flock -n 9 || { echo "[warn] DAQ busy (lock)"; exit 0; }
+  daq_run() { "$@"; }
+fi
 
 # Ensure output dir exists
-mkdir -p "${DATA_DIR}"
+mkdir -p "${DATA_DIR}" "${INFLUX_SPOOL%/*}"
+
+# Heartbeats are stamped when the run ends and posted together with the perf stats at the end
+hb=()
+heartbeat() { hb+=(-l "DT5730S,host=${HOSTNAME},mode=$1,run=${run} status=$2i ${EPOCHREALTIME//[.,]/}000"); }
 
 run="$("${UTILS_DIR}/next_run_number.sh")"
 ts="$(date -u +"%Y-%m-%dT%H-%M-%SZ")"
@@ -35,30 +51,49 @@ ts="$(date -u +"%Y-%m-%dT%H-%M-%SZ")"
 sw_ok=1
 th_ok=1
 
-# --- Software Trigger Run ---
-mode="sw"
-root_out="${DATA_DIR}/run_${run}_${ts}_${mode}.root"
-echo "[run] SW acquisition -> ${root_out}"
-"${SW_BIN}" \
-  -n "${SW_N_EVENTS}" \
-  -m sw \
-  -c "${DAQ_CHANNEL}" \
-  -r 1500 \
-  --root "${root_out}" || sw_ok=0
+# --- Software Trigger Run (skipped in mixed mode: the threshold run samples the baseline itself) ---
+mixed=()
+if [[ "${MIXED_SW_RATE}" == "0" ]]; then
+  mode="sw"
+  root_out="${DATA_DIR}/run_${run}_${ts}_${mode}.root"
+  echo "[run] SW acquisition -> ${root_out}"
+  daq_run "${SW_BIN}" \
+    -n "${SW_N_EVENTS}" \
+    -m sw \
+    --sw-burst "${SW_BURST}" \
+    --noise \
+    -c "${DAQ_CHANNEL}" \
+    -r 1500 \
+    --perf-lp "${PERF_LP}" \
+    --format "${WAVE_FORMAT}" \
+    --root "${root_out}" || sw_ok=0
 
-"${UTILS_DIR}/heartbeat_influx.sh" "DT5730S" "${sw_ok}" "mode=sw,run=${run}"
+  heartbeat sw "${sw_ok}"
+else
+  mixed=(--sw-rate "${MIXED_SW_RATE}" --noise)
+fi
 
 # --- Threshold Trigger Run ---
 mode="self"
 root_out="${DATA_DIR}/run_${run}_${ts}_${mode}.root"
 echo "[run] Threshold acquisition -> ${root_out}"
-"${TH_BIN}" \
+daq_run "${TH_BIN}" \
   -n "${TH_N_EVENTS}" \
   -m self \
   -c "${DAQ_CHANNEL}" \
   -t "${DAQ_THRESHOLD}" \
   -r 1500 \
   --post 80 \
+  "${mixed[@]}" \
+  --perf-lp "${PERF_LP}" \
+  --format "${WAVE_FORMAT}" \
   --root "${root_out}" || th_ok=0
 
-"${UTILS_DIR}/heartbeat_influx.sh" "DT5730S" "${th_ok}" "mode=self,run=${run}"
+heartbeat self "${th_ok}"
+[[ ${#mixed[@]} -gt 0 ]] && heartbeat sw "${th_ok}"
+
+# --- Monitoring: heartbeats + the perf stats the runs appended, one keep-alive POST; whatever
+# Influx does not take now waits in the spool and goes out with a later cycle ---
+perf=()
+[[ -s "${PERF_LP}" ]] && perf=(--rm "${PERF_LP}")
+"${UTILS_DIR}/influx_push" "${hb[@]}" "${perf[@]}" || echo "[warn] monitoring points spooled in ${INFLUX_SPOOL}"
@@ -0,0 +1,670 @@
+// Software stand-in for the subset of CAENDigitizer used by the DAQ binaries.
+// Header-only; put this directory first on the include path and drop -lCAENDigitizer:
+//   g++ -O2 -std=c++17 -Isim daq_threshold_v1.0.0.cpp -o daq_threshold_sim $(root-config --cflags --libs) -pthread
+//
+// Blocks are produced in the X730 standard-firmware layout (4-word header, then
+// per enabled channel recLen/2 words holding two 14-bit samples each), so anything
+// that decodes real DT5730S data decodes these too.
+//
+// Knobs (environment, read once per process):
+//   DGTZ_SIM_RATE        self/ext pulse rate in Hz (default 1000); in self-trigger mode only
+//                        pulses crossing the programmed threshold trigger
+//   DGTZ_SIM_AMP         pulse peak height in ADC counts (default 2000)
+//   DGTZ_SIM_AMP_SPREAD  relative Gaussian spread of the peak height (default 0)
+//   DGTZ_SIM_RISE_NS     rise time constant (default 4), DGTZ_SIM_DECAY_NS decay (default 40)
+//   DGTZ_SIM_SLOW_FRAC   share of a slow component in the pulse integral (default 0)
+//   DGTZ_SIM_SLOW_NS     slow decay constant (default 300)
+//   DGTZ_SIM_POP2        fraction of pulses from a second population (default 0) whose slow
+//                        share is DGTZ_SIM_SLOW2_FRAC (default 0.3): a PSD test source
+//   DGTZ_SIM_NOISE       baseline noise RMS in ADC counts (default 2)
+//   DGTZ_SIM_MEM_EVENTS  events the board memory holds; triggers beyond it are lost
+//                        (default min(1024, 5.12 MS / recLen), as on a DT5730); lost triggers still
+//                        advance EventCounter when 0x8100 bit 3 "count all triggers" is set
+//   DGTZ_SIM_LINK_MBPS   link bandwidth in MB/s; ReadData blocks for bytes/bandwidth (0 = unlimited)
+//   DGTZ_SIM_READ_US     fixed cost of one ReadData transaction in us (default 0)
+//   DGTZ_SIM_REG_US      cost of one register access in us (default 0)
+//   DGTZ_SIM_TEMP        ADC temperature in C (default 40), DGTZ_SIM_TEMP_STEP added per channel,
+//                        DGTZ_SIM_TEMP_DRIFT in C per minute since the process started
+//   DGTZ_SIM_REPORT      if set, SWStopAcquisition prints triggers seen/lost to stderr
+//   DGTZ_SIM_SHARED      if set, all boards of the process see the same pulse train and start their
+//                        clocks together (as with an S-IN/TRG-OUT daisy chain): multi-board tests
+//   DGTZ_SIM_CLOCK_OFFSET_NS  comma list, per board in open order: added to its trigger time tag
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef enum {
+    CAEN_DGTZ_Success                 =  0,
+    CAEN_DGTZ_CommError               = -1,
+    CAEN_DGTZ_GenericError            = -2,
+    CAEN_DGTZ_InvalidParam            = -3,
+    CAEN_DGTZ_InvalidLinkType         = -4,
+    CAEN_DGTZ_InvalidHandle           = -5,
+    CAEN_DGTZ_MaxDevicesError         = -6,
+    CAEN_DGTZ_BadBoardType            = -7,
+    CAEN_DGTZ_BadInterruptLev         = -8,
+    CAEN_DGTZ_BadEventNumber          = -9,
+    CAEN_DGTZ_ReadDeviceRegisterFail  = -10,
+    CAEN_DGTZ_WriteDeviceRegisterFail = -11,
+    CAEN_DGTZ_InvalidChannelNumber    = -13,
+    CAEN_DGTZ_ChannelBusy             = -14,
+    CAEN_DGTZ_FPIOModeInvalid         = -15,
+    CAEN_DGTZ_WrongAcqMode            = -16,
+    CAEN_DGTZ_FunctionNotAllowed      = -17,
+    CAEN_DGTZ_Timeout                 = -18,
+    CAEN_DGTZ_InvalidBuffer           = -19,
+    CAEN_DGTZ_EventNotFound           = -20,
+    CAEN_DGTZ_InvalidEvent            = -21,
+    CAEN_DGTZ_OutOfMemory             = -22,
+    CAEN_DGTZ_InterruptNotConfigured  = -27,
+    CAEN_DGTZ_NotYetImplemented       = -99,
+} CAEN_DGTZ_ErrorCode;
+
+typedef enum { CAEN_DGTZ_USB = 0, CAEN_DGTZ_OpticalLink = 1 } CAEN_DGTZ_ConnectionType;
+typedef enum { CAEN_DGTZ_SLAVE_TERMINATED_READOUT_MBLT = 0 } CAEN_DGTZ_ReadMode_t;
+typedef enum {
+    CAEN_DGTZ_TRGMODE_DISABLED       = 0,
+    CAEN_DGTZ_TRGMODE_EXTOUT_ONLY    = 2,
+    CAEN_DGTZ_TRGMODE_ACQ_ONLY       = 1,
+    CAEN_DGTZ_TRGMODE_ACQ_AND_EXTOUT = 3,
+} CAEN_DGTZ_TriggerMode_t;
+typedef enum { CAEN_DGTZ_SW_CONTROLLED = 0, CAEN_DGTZ_S_IN_CONTROLLED = 1 } CAEN_DGTZ_AcqMode_t;
+typedef enum { CAEN_DGTZ_PulsePolarityPositive = 0, CAEN_DGTZ_PulsePolarityNegative = 1 } CAEN_DGTZ_PulsePolarity_t;
+typedef enum { CAEN_DGTZ_TriggerOnRisingEdge = 0, CAEN_DGTZ_TriggerOnFallingEdge = 1 } CAEN_DGTZ_TriggerPolarity_t;
+typedef enum { CAEN_DGTZ_DISABLE = 0, CAEN_DGTZ_ENABLE = 1 } CAEN_DGTZ_EnaDis_t;
+typedef enum { CAEN_DGTZ_IRQ_MODE_RORA = 0, CAEN_DGTZ_IRQ_MODE_ROAK = 1 } CAEN_DGTZ_IRQMode_t;
+
+#define MAX_UINT16_CHANNEL_SIZE 64
+
+typedef struct {
+    char     ModelName[12];
+    uint32_t Model;
+    uint32_t Channels;
+    uint32_t FormFactor;
+    uint32_t FamilyCode;
+    char     ROC_FirmwareRel[20];
+    char     AMC_FirmwareRel[40];
+    uint32_t SerialNumber;
+    char     MezzanineSerNum[4][8];
+    uint32_t PCB_Revision;
+    uint32_t ADC_NBits;
+    uint32_t SAMCorrectionDataLoaded;
+    int      CommHandle;
+    int      VMEHandle;
+    char     License[17];
+} CAEN_DGTZ_BoardInfo_t;
+
+typedef struct {
+    uint32_t EventSize;
+    uint32_t BoardId;
+    uint32_t Pattern;
+    uint32_t ChannelMask;
+    uint32_t EventCounter;
+    uint32_t TriggerTimeTag;
+} CAEN_DGTZ_EventInfo_t;
+
+typedef struct {
+    uint32_t  ChSize[MAX_UINT16_CHANNEL_SIZE];
+    uint16_t* DataChannel[MAX_UINT16_CHANNEL_SIZE];
+} CAEN_DGTZ_UINT16_EVENT_t;
+
+namespace dgtz_sim {
+
+constexpr int kMaxBoards = 8;
+constexpr int kChannels  = 8;
+constexpr uint32_t kMaxBLT = 1023;
+
+struct Board {
+    bool     open = false;
+    int      link = 0, node = 0;
+    uint32_t enMask = 0xFF;
+    uint32_t recLen = 1024;
+    uint32_t post = 50;
+    uint32_t maxBLT = 1;
+    uint32_t dcOffset[kChannels] = {};
+    uint32_t thr[kChannels] = {};
+    uint32_t selfMask = 0;
+    int      selfMode = CAEN_DGTZ_TRGMODE_DISABLED;
+    int      swMode = CAEN_DGTZ_TRGMODE_ACQ_ONLY;
+    int      extMode = CAEN_DGTZ_TRGMODE_DISABLED;
+    int      pulsePol[kChannels] = {};
+    int      trigPol[kChannels] = {};
+    bool     running = false;
+    uint32_t evCounter = 0;
+    std::chrono::steady_clock::time_point t0;
+    double   nextTrigNs = 0;   // next physics pulse, ns since t0
+    double   rateHz = 1000.0;
+    bool     irqOn = false;
+    uint32_t irqEvents = 1;
+    std::mt19937_64 rng{12345};
+    std::mt19937_64 pulseRng{4242}; // DGTZ_SIM_SHARED: pulse times/heights, identical on every board
+    double   clockOffsetNs = 0;
+    // board memory: triggered events not read out yet
+    struct Stored { double tNs; float amp; uint8_t pop; };
+    std::deque<Stored> stored;
+    uint64_t trigSeen = 0, trigLost = 0;
+    std::map<uint32_t, uint32_t> regs; // registers only reachable through Read/WriteRegister
+    // unit-height pulse templates for the current recLen/post, one per population
+    std::vector<float> tmpl[2];
+    uint32_t tmplRecLen = 0, tmplPost = 0;
+    std::vector<uint16_t> row; // one channel's samples before packing
+};
+
+inline Board g_boards[kMaxBoards];
+
+inline double env_double(const char* name, double dflt){
+    const char* v = std::getenv(name);
+    return (v && *v) ? std::atof(v) : dflt;
+}
+
+struct Params {
+    double amp, ampSpread, riseNs, decayNs, slowFrac, slowNs, pop2, slow2Frac, noise;
+    double memEvents, linkMBps, readUs, regUs, temp, tempStep, tempDrift;
+    bool   report, shared;
+    std::vector<double> clockOffsetNs;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+inline std::vector<double> env_list(const char* name){
+    std::vector<double> v;
+    const char* s = std::getenv(name);
+    while(s && *s){
+        char* end = nullptr;
+        v.push_back(std::strtod(s, &end));
+        if(end==s) break;
+        s = (*end==',') ? end+1 : end;
+    }
+    return v;
+}
+inline const Params& params(){
+    static const Params p{
+        env_double("DGTZ_SIM_AMP", 2000), env_double("DGTZ_SIM_AMP_SPREAD", 0),
+        env_double("DGTZ_SIM_RISE_NS", 4), env_double("DGTZ_SIM_DECAY_NS", 40),
+        env_double("DGTZ_SIM_SLOW_FRAC", 0), env_double("DGTZ_SIM_SLOW_NS", 300),
+        env_double("DGTZ_SIM_POP2", 0), env_double("DGTZ_SIM_SLOW2_FRAC", 0.3),
+        env_double("DGTZ_SIM_NOISE", 2),
+        env_double("DGTZ_SIM_MEM_EVENTS", 0), env_double("DGTZ_SIM_LINK_MBPS", 0),
+        env_double("DGTZ_SIM_READ_US", 0), env_double("DGTZ_SIM_REG_US", 0),
+        env_double("DGTZ_SIM_TEMP", 40), env_double("DGTZ_SIM_TEMP_STEP", 0), env_double("DGTZ_SIM_TEMP_DRIFT", 0),
+        std::getenv("DGTZ_SIM_REPORT") != nullptr, std::getenv("DGTZ_SIM_SHARED") != nullptr,
+        env_list("DGTZ_SIM_CLOCK_OFFSET_NS"),
+    };
+    return p;
+}
+
+// Gaussian noise drawn once; each channel of each event reads it from a random offset.
+constexpr uint32_t kNoiseLen = 1u << 16;
+inline const int16_t* noise_table(){
+    static const std::vector<int16_t> t = []{
+        std::vector<int16_t> v(kNoiseLen);
+        std::mt19937_64 r(777);
+        std::normal_distribution<double> g(0.0, params().noise);
+        for(auto& x : v) x = (int16_t)std::lround(g(r));
+        return v;
+    }();
+    return t.data();
+}
+
+inline void busy_for_us(double us){
+    if(us <= 0) return;
+    const auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds((int64_t)(us*1e3));
+    if(us >= 200) std::this_thread::sleep_until(until);
+    else while(std::chrono::steady_clock::now() < until) {}
+}
+
+inline Board* get(int handle){
+    if(handle<0 || handle>=kMaxBoards || !g_boards[handle].open) return nullptr;
+    return &g_boards[handle];
+}
+// Register access: same as get() plus the configured per-access latency.
+inline Board* reg(int handle){
+    Board* b = get(handle);
+    if(b) busy_for_us(params().regUs);
+    return b;
+}
+
+inline uint32_t n_enabled(const Board& b){
+    return (uint32_t)__builtin_popcount(b.enMask & 0xFF);
+}
+
+inline uint32_t event_words(const Board& b){
+    return 4 + n_enabled(b) * (b.recLen/2);
+}
+
+// Baseline in ADC counts for a given DC offset (negative polarity: offset 0 -> top of range).
+inline uint16_t baseline_for(uint32_t dc){
+    return (uint16_t)(16383.0 * (1.0 - (dc & 0xFFFF) / 65535.0));
+}
+
+inline uint32_t mem_events(const Board& b){
+    const double m = params().memEvents;
+    return m > 0 ? (uint32_t)m : std::max<uint32_t>(1, std::min<uint32_t>(1024, 5242880u / std::max<uint32_t>(b.recLen, 1)));
+}
+
+inline bool physics_enabled(const Board& b){
+    return (b.selfMode!=CAEN_DGTZ_TRGMODE_DISABLED && b.selfMask) || b.extMode!=CAEN_DGTZ_TRGMODE_DISABLED;
+}
+
+inline double now_ns(const Board& b){
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - b.t0).count();
+}
+
+// Double-exponential pulse (500 MS/s, 2 ns/sample) with an optional slow component, peak 1.
+inline void build_templates(Board& b){
+    if(b.tmplRecLen==b.recLen && b.tmplPost==b.post) return;
+    const Params& p = params();
+    const uint32_t t0 = b.recLen * (100 - std::min<uint32_t>(b.post, 100)) / 100;
+    const double slow[2] = {p.slowFrac, p.slow2Frac};
+    for(int k=0;k<2;++k){
+        auto& t = b.tmpl[k];
+        t.assign(b.recLen, 0.f);
+        double peak = 0;
+        for(uint32_t s=t0; s<b.recLen; ++s){
+            const double tn = 2.0 * (s - t0);
+            const double rise = 1.0 - std::exp(-tn / p.riseNs);
+            const double v = rise * ((1.0-slow[k]) * std::exp(-tn / p.decayNs) / p.decayNs
+                                     + slow[k] * std::exp(-tn / p.slowNs) / p.slowNs);
+            t[s] = (float)v;
+            peak = std::max(peak, v);
+        }
+        if(peak > 0) for(auto& v : t) v = (float)(v / peak);
+    }
+    b.tmplRecLen = b.recLen; b.tmplPost = b.post;
+}
+
+// Acquisition Control (0x8100) bit 3: EventCounter counts all triggers, not only accepted ones,
+// so triggers lost with the memory full show up as counter gaps.
+constexpr uint32_t kRegAcqControl = 0x8100;
+inline void lose_trigger(Board& b){
+    b.trigLost++;
+    if((b.regs[kRegAcqControl] >> 3) & 1) b.evCounter++;
+}
+
+// Moves the physics pulses up to 'now' into board memory (or counts them lost when it is full).
+// In pure self-trigger mode a pulse only triggers if its peak crosses a self-trigger threshold.
+inline void advance(Board& b, double now){
+    if(!b.running || !physics_enabled(b) || b.rateHz <= 0) return;
+    const Params& p = params();
+    std::exponential_distribution<double> gap(b.rateHz * 1e-9);
+    std::normal_distribution<double> spread(1.0, p.ampSpread);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const bool selfOnly = b.extMode==CAEN_DGTZ_TRGMODE_DISABLED;
+    const uint32_t cap = mem_events(b);
+    std::mt19937_64& r = p.shared ? b.pulseRng : b.rng;
+    while(b.nextTrigNs <= now){
+        const double amp = std::max(0.0, p.amp * (p.ampSpread > 0 ? spread(r) : 1.0));
+        const uint8_t pop = (p.pop2 > 0 && u(r) < p.pop2) ? 1 : 0;
+        bool fires = !selfOnly;
+        for(int c=0; c<kChannels && !fires; ++c)
+            if((b.selfMask>>c)&1) fires = baseline_for(b.dcOffset[c]) - amp <= (double)b.thr[c];
+        if(fires){
+            b.trigSeen++;
+            if(b.stored.size() < cap) b.stored.push_back({b.nextTrigNs, (float)amp, pop});
+            else lose_trigger(b);
+        }
+        b.nextTrigNs += gap(r);
+    }
+}
+
+inline void write_event(Board& b, uint32_t* w, const Board::Stored& ev){
+    const uint32_t words = event_words(b);
+    w[0] = 0xA0000000u | (words & 0x0FFFFFFFu);
+    w[1] = (b.enMask & 0xFFu);
+    w[2] = (b.evCounter++ & 0x00FFFFFFu);
+    w[3] = (uint32_t)((uint64_t)std::max(0.0, (ev.tNs + b.clockOffsetNs) / 8.0) & 0x7FFFFFFFu);
+    uint32_t* p = w + 4;
+    build_templates(b);
+    const int16_t* nz = noise_table();
+    const float* tm = b.tmpl[ev.pop].data();
+    b.row.resize(b.recLen);
+    uint16_t* row = b.row.data();
+    for(int ch=0; ch<kChannels; ++ch){
+        if(!(b.enMask & (1u<<ch))) continue;
+        const int base = baseline_for(b.dcOffset[ch]);
+        const uint32_t off = (uint32_t)b.rng();
+        for(uint32_t s=0; s<b.recLen; ++s){
+            int v = base + nz[(off + s) & (kNoiseLen-1)] - (int)(ev.amp * tm[s]);
+            row[s] = (uint16_t)std::min(16383, std::max(0, v));
+        }
+        for(uint32_t s=0; s+1<b.recLen; s+=2) *p++ = (uint32_t)row[s] | ((uint32_t)row[s+1] << 16);
+    }
+}
+
+} // namespace dgtz_sim
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_ConnectionType, int link, int node, uint32_t, int* handle){
+    static int opened = 0;
+    for(int h=0; h<dgtz_sim::kMaxBoards; ++h){
+        auto& b = dgtz_sim::g_boards[h];
+        if(b.open) continue;
+        b = dgtz_sim::Board{};
+        b.open = true;
+        b.link = link; b.node = node;
+        b.rateHz = dgtz_sim::env_double("DGTZ_SIM_RATE", 1000.0);
+        const auto& offs = dgtz_sim::params().clockOffsetNs;
+        b.clockOffsetNs = opened < (int)offs.size() ? offs[opened] : 0.0;
+        opened++;
+        b.rng.seed(12345 + 7919u*(unsigned)link + 104729u*(unsigned)node);
+        *handle = h;
+        return CAEN_DGTZ_Success;
+    }
+    return CAEN_DGTZ_MaxDevicesError;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_CloseDigitizer(int handle){
+    auto* b = dgtz_sim::get(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    b->open = false; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_Reset(int handle){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    const int link = b->link, node = b->node; const double rate = b->rateHz, off = b->clockOffsetNs;
+    *b = dgtz_sim::Board{}; b->open = true; b->link = link; b->node = node; b->rateHz = rate; b->clockOffsetNs = off;
+    b->rng.seed(12345 + 7919u*(unsigned)link + 104729u*(unsigned)node);
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetInfo(int handle, CAEN_DGTZ_BoardInfo_t* bi){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    std::memset(bi, 0, sizeof(*bi));
+    std::strcpy(bi->ModelName, "DT5730S");
+    bi->Model = 730; bi->Channels = 8; bi->FamilyCode = 11; bi->ADC_NBits = 14;
+    std::strcpy(bi->ROC_FirmwareRel, "4.25_SIM");
+    std::strcpy(bi->AMC_FirmwareRel, "0.12_SIM");
+    bi->SerialNumber = 90000u + (uint32_t)b->link + 100u*(uint32_t)b->node;
+    return CAEN_DGTZ_Success;
+}
+
+#define DGTZ_SIM_SETTER(name, field)                                          \
+    inline CAEN_DGTZ_ErrorCode name(int handle, uint32_t v){                  \
+        auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;\
+        b->field = v; return CAEN_DGTZ_Success; }
+DGTZ_SIM_SETTER(CAEN_DGTZ_SetChannelEnableMask, enMask)
+DGTZ_SIM_SETTER(CAEN_DGTZ_SetPostTriggerSize,   post)
+#undef DGTZ_SIM_SETTER
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetRecordLength(int handle, uint32_t v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(v < 2) return CAEN_DGTZ_InvalidParam;
+    b->recLen = v & ~1u; return CAEN_DGTZ_Success;   // two samples per word
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetChannelEnableMask(int handle, uint32_t* v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; *v = b->enMask; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetRecordLength(int handle, uint32_t* v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; *v = b->recLen; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetPostTriggerSize(int handle, uint32_t* v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; *v = b->post; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetMaxNumEventsBLT(int handle, uint32_t n){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(n==0 || n>dgtz_sim::kMaxBLT) return CAEN_DGTZ_InvalidParam;
+    b->maxBLT = n; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetMaxNumEventsBLT(int handle, uint32_t* n){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; *n = b->maxBLT; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetAcquisitionMode(int handle, CAEN_DGTZ_AcqMode_t){
+    return dgtz_sim::reg(handle) ? CAEN_DGTZ_Success : CAEN_DGTZ_InvalidHandle;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetChannelPulsePolarity(int handle, uint32_t ch, CAEN_DGTZ_PulsePolarity_t p){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    b->pulsePol[ch] = p; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetChannelPulsePolarity(int handle, uint32_t ch, CAEN_DGTZ_PulsePolarity_t* p){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    *p = (CAEN_DGTZ_PulsePolarity_t)b->pulsePol[ch]; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetTriggerPolarity(int handle, uint32_t ch, CAEN_DGTZ_TriggerPolarity_t p){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    b->trigPol[ch] = p; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetTriggerPolarity(int handle, uint32_t ch, CAEN_DGTZ_TriggerPolarity_t* p){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    *p = (CAEN_DGTZ_TriggerPolarity_t)b->trigPol[ch]; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetChannelDCOffset(int handle, uint32_t ch, uint32_t v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    b->dcOffset[ch] = v; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetChannelDCOffset(int handle, uint32_t ch, uint32_t* v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    *v = b->dcOffset[ch]; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetChannelTriggerThreshold(int handle, uint32_t ch, uint32_t v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    b->thr[ch] = v; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetChannelTriggerThreshold(int handle, uint32_t ch, uint32_t* v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    *v = b->thr[ch]; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetChannelSelfTrigger(int handle, CAEN_DGTZ_TriggerMode_t m, uint32_t mask){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    b->selfMode = m;
+    b->selfMask = (m==CAEN_DGTZ_TRGMODE_DISABLED) ? (b->selfMask & ~mask) : (b->selfMask | mask);
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetChannelSelfTrigger(int handle, uint32_t ch, CAEN_DGTZ_TriggerMode_t* m){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    *m = ((b->selfMask>>ch)&1) ? (CAEN_DGTZ_TriggerMode_t)b->selfMode : CAEN_DGTZ_TRGMODE_DISABLED;
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetSWTriggerMode(int handle, CAEN_DGTZ_TriggerMode_t m){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; b->swMode = m; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetSWTriggerMode(int handle, CAEN_DGTZ_TriggerMode_t* m){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; *m = (CAEN_DGTZ_TriggerMode_t)b->swMode; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetExtTriggerInputMode(int handle, CAEN_DGTZ_TriggerMode_t m){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; b->extMode = m; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetExtTriggerInputMode(int handle, CAEN_DGTZ_TriggerMode_t* m){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle; *m = (CAEN_DGTZ_TriggerMode_t)b->extMode; return CAEN_DGTZ_Success;
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_WriteRegister(int handle, uint32_t addr, uint32_t v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    b->regs[addr] = v; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_ReadRegister(int handle, uint32_t addr, uint32_t* v){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    auto it = b->regs.find(addr);
+    *v = it==b->regs.end() ? 0u : it->second;
+    return CAEN_DGTZ_Success;
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SWStartAcquisition(int handle){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    // Shared mode: a board started while another runs joins its clock and pulse train.
+    const dgtz_sim::Board* peer = nullptr;
+    for(const auto& o : dgtz_sim::g_boards) if(o.open && o.running && &o!=b){ peer = &o; break; }
+    b->running = true;
+    b->t0 = (dgtz_sim::params().shared && peer) ? peer->t0 : std::chrono::steady_clock::now();
+    b->pulseRng.seed(4242);
+    b->nextTrigNs = 0;
+    b->trigSeen = b->trigLost = 0;
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SWStopAcquisition(int handle){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(b->running && dgtz_sim::params().report && b->trigSeen > 1)
+        fprintf(stderr, "[sim] link %d: %llu triggers, %llu lost with board memory full (%u events), dead time %.2f%%\n",
+                b->link, (unsigned long long)b->trigSeen, (unsigned long long)b->trigLost, dgtz_sim::mem_events(*b),
+                100.0 * b->trigLost / b->trigSeen);
+    b->running = false; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_ClearData(int handle){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    b->stored.clear(); b->evCounter = 0; return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SendSWtrigger(int handle){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(b->running && b->swMode!=CAEN_DGTZ_TRGMODE_DISABLED){
+        const double now = dgtz_sim::now_ns(*b);
+        dgtz_sim::advance(*b, now);
+        b->trigSeen++;
+        if(b->stored.size() < dgtz_sim::mem_events(*b)) b->stored.push_back({now, 0.f, 0});
+        else dgtz_sim::lose_trigger(*b);
+    }
+    return CAEN_DGTZ_Success;
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_MallocReadoutBuffer(int handle, char** buf, uint32_t* size){
+    auto* b = dgtz_sim::get(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    const uint32_t bytes = b->maxBLT * (4 + dgtz_sim::kChannels * (b->recLen/2)) * 4u;
+    *buf = (char*)std::malloc(bytes);
+    if(!*buf) return CAEN_DGTZ_OutOfMemory;
+    *size = bytes;
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_FreeReadoutBuffer(char** buf){
+    std::free(*buf); *buf = nullptr; return CAEN_DGTZ_Success;
+}
+
+// Returns up to maxBLT stored events, then blocks for the transfer time the configured link needs.
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_ReadData(int handle, CAEN_DGTZ_ReadMode_t, char* buf, uint32_t* size){
+    auto* b = dgtz_sim::get(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    const dgtz_sim::Params& p = dgtz_sim::params();
+    *size = 0;
+    if(b->running) dgtz_sim::advance(*b, dgtz_sim::now_ns(*b));
+    const uint32_t words = dgtz_sim::event_words(*b);
+    uint32_t* w = reinterpret_cast<uint32_t*>(buf);
+    uint32_t n = 0;
+    while(n < b->maxBLT && !b->stored.empty()){
+        dgtz_sim::write_event(*b, w, b->stored.front());
+        b->stored.pop_front();
+        w += words; ++n;
+    }
+    *size = n * words * 4u;
+    dgtz_sim::busy_for_us(p.readUs + (p.linkMBps > 0 ? *size / p.linkMBps : 0.0));
+    return CAEN_DGTZ_Success;
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetNumEvents(int, char* buf, uint32_t size, uint32_t* nev){
+    const uint32_t* w = reinterpret_cast<const uint32_t*>(buf);
+    uint32_t words = size/4, pos = 0, n = 0;
+    while(pos + 4 <= words && (w[pos]>>28)==0xA){
+        uint32_t sz = w[pos] & 0x0FFFFFFFu;
+        if(sz < 4 || pos + sz > words) break;
+        pos += sz; ++n;
+    }
+    *nev = n;
+    return CAEN_DGTZ_Success;
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_GetEventInfo(int, char* buf, uint32_t size, int32_t idx,
+                                                  CAEN_DGTZ_EventInfo_t* info, char** evtPtr){
+    const uint32_t* w = reinterpret_cast<const uint32_t*>(buf);
+    uint32_t words = size/4, pos = 0;
+    for(int32_t i=0; ; ++i){
+        if(pos + 4 > words || (w[pos]>>28)!=0xA) return CAEN_DGTZ_EventNotFound;
+        uint32_t sz = w[pos] & 0x0FFFFFFFu;
+        if(i == idx){
+            info->EventSize      = sz*4;
+            info->BoardId        = w[pos+1] >> 27;
+            info->Pattern        = (w[pos+1] >> 8) & 0xFFFF;
+            info->ChannelMask    = (w[pos+1] & 0xFF) | ((w[pos+2] >> 16) & 0xFF00);
+            info->EventCounter   = w[pos+2] & 0x00FFFFFFu;
+            info->TriggerTimeTag = w[pos+3];
+            *evtPtr = buf + pos*4;
+            return CAEN_DGTZ_Success;
+        }
+        pos += sz;
+    }
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_AllocateEvent(int, void** evt){
+    auto* e = (CAEN_DGTZ_UINT16_EVENT_t*)std::calloc(1, sizeof(CAEN_DGTZ_UINT16_EVENT_t));
+    if(!e) return CAEN_DGTZ_OutOfMemory;
+    *evt = e;
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_FreeEvent(int, void** evt){
+    auto* e = (CAEN_DGTZ_UINT16_EVENT_t*)*evt;
+    if(e){ for(auto* p : e->DataChannel) std::free(p); std::free(e); }
+    *evt = nullptr;
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_DecodeEvent(int, char* evtPtr, void** evt){
+    auto* e = (CAEN_DGTZ_UINT16_EVENT_t*)*evt;
+    if(!e) return CAEN_DGTZ_InvalidEvent;
+    const uint32_t* w = reinterpret_cast<const uint32_t*>(evtPtr);
+    const uint32_t sz   = w[0] & 0x0FFFFFFFu;
+    const uint32_t mask = w[1] & 0xFF;
+    const uint32_t nch  = (uint32_t)__builtin_popcount(mask);
+    const uint32_t per  = nch ? (sz-4)/nch : 0;
+    const uint32_t* p = w + 4;
+    for(int ch=0; ch<dgtz_sim::kChannels; ++ch){
+        if(!(mask & (1u<<ch))){ e->ChSize[ch] = 0; continue; }
+        if(e->ChSize[ch] < per*2 || !e->DataChannel[ch]){
+            std::free(e->DataChannel[ch]);
+            e->DataChannel[ch] = (uint16_t*)std::malloc(per*2*sizeof(uint16_t));
+        }
+        e->ChSize[ch] = per*2;
+        for(uint32_t k=0; k<per; ++k){
+            e->DataChannel[ch][2*k]   = (uint16_t)(p[k] & 0x3FFF);
+            e->DataChannel[ch][2*k+1] = (uint16_t)((p[k] >> 16) & 0x3FFF);
+        }
+        p += per;
+    }
+    return CAEN_DGTZ_Success;
+}
+
+// IRQWait returns once irqEvents events are expected to be in board memory: the next physics
+// pulse is known exactly, later ones are extrapolated at the mean rate.
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_SetInterruptConfig(int handle, CAEN_DGTZ_EnaDis_t state, uint8_t level,
+                                                        uint32_t, uint16_t nev, CAEN_DGTZ_IRQMode_t){
+    auto* b = dgtz_sim::reg(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(state==CAEN_DGTZ_ENABLE && (level<1 || level>7)) return CAEN_DGTZ_BadInterruptLev;
+    b->irqOn = state==CAEN_DGTZ_ENABLE;
+    b->irqEvents = nev ? nev : 1;
+    return CAEN_DGTZ_Success;
+}
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_IRQWait(int handle, uint32_t timeoutMs){
+    auto* b = dgtz_sim::get(handle); if(!b) return CAEN_DGTZ_InvalidHandle;
+    if(!b->irqOn) return CAEN_DGTZ_InterruptNotConfigured;
+    using clk = std::chrono::steady_clock;
+    const auto deadline = clk::now() + std::chrono::milliseconds(timeoutMs);
+    dgtz_sim::advance(*b, dgtz_sim::now_ns(*b));
+    if(b->stored.size() >= b->irqEvents) return CAEN_DGTZ_Success;
+    if(b->running && dgtz_sim::physics_enabled(*b) && b->rateHz > 0){
+        const double missing = double(b->irqEvents - b->stored.size());
+        const double readyNs = b->nextTrigNs + (missing - 1) * 1e9 / b->rateHz;
+        const auto ready = b->t0 + std::chrono::nanoseconds((int64_t)readyNs);
+        std::this_thread::sleep_until(std::min(ready, deadline));
+        return ready <= deadline ? CAEN_DGTZ_Success : CAEN_DGTZ_Timeout;
+    }
+    // SW triggers only: they arrive from this process, so poll briefly
+    while(clk::now() < deadline){
+        if(!b->stored.empty()) return CAEN_DGTZ_Success;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return CAEN_DGTZ_Timeout;
+}
+
+inline CAEN_DGTZ_ErrorCode CAEN_DGTZ_ReadTemperature(int handle, int32_t ch, uint32_t* t){
+    if(!dgtz_sim::reg(handle)) return CAEN_DGTZ_InvalidHandle;
+    if(ch<0 || ch>=dgtz_sim::kChannels) return CAEN_DGTZ_InvalidChannelNumber;
+    const dgtz_sim::Params& p = dgtz_sim::params();
+    const double minutes = std::chrono::duration<double>(std::chrono::steady_clock::now() - p.start).count() / 60.0;
+    *t = (uint32_t)std::max(0L, std::lround(p.temp + p.tempStep*ch + p.tempDrift*minutes));
+    return CAEN_DGTZ_Success;
+}
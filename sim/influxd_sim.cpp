@@ -0,0 +1,128 @@
+// Stand-in for an InfluxDB v1 server: accepts POST /write over HTTP/1.1 keep-alive and answers
+// 204, so the exporter (common/influx.h), read_temp_influx and influx_push can be tested without
+// the monitoring host. Received line protocol is appended to --out; stopping the process and
+// starting it again is a network outage.
+// Build: g++ -O2 -std=c++17 influxd_sim.cpp -o influxd_sim
+//
+//   influxd_sim --port 18086 --out /tmp/influx.lp -v
+//   influxd_sim --port 18086 --fail-first 3       # 503 to the first 3 writes, then 204
+//   influxd_sim --port 18086 --status 400         # refuse every write
+// On SIGINT/SIGTERM it prints connections, requests and lines received.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static volatile sig_atomic_t g_stop = 0;
+static void on_signal(int){ g_stop = 1; }
+
+struct Conn { std::string in; bool continued = false; };
+
+int main(int argc, char** argv){
+    int port = 8086, status = 204, failFirst = 0;
+    std::string out;
+    bool verbose = false;
+    for(int i=1;i<argc;++i){
+        std::string a = argv[i];
+        auto need = [&](const char* opt)->const char*{
+            if(i+1>=argc){ fprintf(stderr,"[ERR] %s needs a value\n", opt); exit(2); }
+            return argv[++i];
+        };
+        if(a=="--port") port = atoi(need("--port"));
+        else if(a=="--out") out = need("--out");
+        else if(a=="--status") status = atoi(need("--status"));
+        else if(a=="--fail-first") failFirst = atoi(need("--fail-first"));
+        else if(a=="-v") verbose = true;
+        else { fprintf(stderr,"Usage: %s [--port p] [--out file] [--status code] [--fail-first n] [-v]\n", argv[0]); return 2; }
+    }
+    signal(SIGINT, on_signal); signal(SIGTERM, on_signal); signal(SIGPIPE, SIG_IGN);
+
+    const int ls = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    const int one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET; sa.sin_port = htons((uint16_t)port); sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(ls<0 || bind(ls, (sockaddr*)&sa, sizeof(sa))!=0 || listen(ls, 16)!=0){
+        fprintf(stderr,"[ERR] cannot listen on 127.0.0.1:%d: %s\n", port, strerror(errno)); return 1;
+    }
+    FILE* fo = out.empty() ? nullptr : fopen(out.c_str(), "a");
+    printf("[sim] influx stand-in on 127.0.0.1:%d\n", port);
+    fflush(stdout);
+
+    std::map<int, Conn> conns;
+    unsigned long long nConn = 0, nReq = 0, nLines = 0;
+    std::vector<pollfd> pfd;
+    while(!g_stop){
+        pfd.assign(1, pollfd{ls, POLLIN, 0});
+        for(auto& kv : conns) pfd.push_back(pollfd{kv.first, POLLIN, 0});
+        if(poll(pfd.data(), pfd.size(), 200) <= 0) continue;
+        if(pfd[0].revents & POLLIN){
+            const int c = accept4(ls, nullptr, nullptr, SOCK_CLOEXEC);
+            if(c>=0){ conns[c]; ++nConn; if(verbose) printf("[sim] connection #%llu\n", nConn); }
+        }
+        for(size_t k=1;k<pfd.size();++k){
+            if(!pfd[k].revents) continue;
+            const int fd = pfd[k].fd;
+            Conn& cn = conns[fd];
+            char buf[65536];
+            const ssize_t r = recv(fd, buf, sizeof(buf), 0);
+            if(r<=0){ close(fd); conns.erase(fd); continue; }
+            cn.in.append(buf, (size_t)r);
+            bool closeIt = false;
+            for(;;){                        // every complete request in the buffer
+                const size_t he = cn.in.find("\r\n\r\n");
+                if(he==std::string::npos) break;
+                std::string head = cn.in.substr(0, he);
+                for(char& ch : head) ch = (char)tolower(ch);
+                size_t len = 0;
+                if(size_t p = head.find("content-length:"); p!=std::string::npos) len = strtoul(head.c_str()+p+15, nullptr, 10);
+                if(!cn.continued && head.find("expect: 100-continue")!=std::string::npos && cn.in.size() < he+4+len){
+                    send(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25, MSG_NOSIGNAL);
+                    cn.continued = true;
+                }
+                if(cn.in.size() < he+4+len) break;
+                const std::string body = cn.in.substr(he+4, len);
+                cn.in.erase(0, he+4+len);
+                cn.continued = false;
+                closeIt = head.find("connection: close")!=std::string::npos;
+                ++nReq;
+                int code = nReq <= (unsigned long long)failFirst ? 503 : status;
+                if(head.compare(0, 11, "post /write")!=0) code = 404;
+                unsigned long long lines = 0;
+                for(size_t p=0;p<body.size();){
+                    size_t e = body.find('\n', p);
+                    if(e==std::string::npos) e = body.size();
+                    if(e>p) ++lines;
+                    p = e+1;
+                }
+                if(code/100==2){
+                    nLines += lines;
+                    if(fo){ fwrite(body.data(), 1, body.size(), fo); if(!body.empty() && body.back()!='\n') fputc('\n', fo); fflush(fo); }
+                }
+                if(verbose) printf("[sim] request #%llu: %zu bytes, %llu lines -> %d\n", nReq, body.size(), lines, code);
+                char resp[256];
+                const char* msg = code/100==2 ? "" : "{\"error\":\"influxd_sim\"}";
+                const int n = snprintf(resp, sizeof(resp), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n%s",
+                                       code, code/100==2 ? "No Content" : "Error", strlen(msg), msg);
+                send(fd, resp, (size_t)n, MSG_NOSIGNAL);
+            }
+            if(closeIt){ close(fd); conns.erase(fd); }
+        }
+        fflush(stdout);
+    }
+    printf("[sim] %llu connections, %llu requests, %llu lines\n", nConn, nReq, nLines);
+    if(fo) fclose(fo);
+    for(auto& kv : conns) close(kv.first);
+    close(ls);
+    return 0;
+}
@@ -0,0 +1,39 @@
+// Client for the acquisition daemon (daq_threshold_v1.0.0 --daemon <socket>).
+// Build: g++ -O2 -std=c++17 -I.. daqctl.cpp -o daqctl
+//
+//   daqctl PING
+//   daqctl TEMP
+//   daqctl RUN -n 1000 -m sw --sw-burst 32 -c 0 -r 1500 --root /abs/path/run.root
+//   daqctl QUIT
+//
+// The socket defaults to $DAQ_SOCK, then /home/ANNIE/daq/.daq.sock; -s overrides both.
+// Output paths in RUN are resolved by the daemon, so pass absolute paths.
+// Exit status: 0 = OK reply, 1 = ERR reply, 3 = daemon not reachable.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "common/daq_socket.h"
+
+int main(int argc, char** argv){
+    std::string sock = getenv("DAQ_SOCK") ? getenv("DAQ_SOCK") : kDefaultDaqSocket;
+    int i = 1;
+    if(i+1<argc && std::string(argv[i])=="-s"){ sock = argv[i+1]; i += 2; }
+    if(i>=argc || std::string(argv[i])=="-h" || std::string(argv[i])=="--help"){
+        fprintf(stderr, "Usage: %s [-s socket] PING|TEMP|QUIT|RUN <daq options...>\n", argv[0]);
+        return 2;
+    }
+    std::string req;
+    for(; i<argc; ++i){
+        if(!req.empty()) req += ' ';
+        req += argv[i];
+    }
+    std::string reply;
+    if(!daq_request(sock, req, reply)){
+        fprintf(stderr, "[ERR] daemon not reachable on %s\n", sock.c_str());
+        return 3;
+    }
+    printf("%s\n", reply.c_str());
+    return reply.compare(0, 2, "OK")==0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+// Live view of a running acquisition (daq_threshold --live /name): maps the shared-memory stream
+// (common/live_shm.h) read-only and prints the run status and the latest waveform once per interval.
+// Never opens the board and needs no lock.
+// Build: g++ -O2 -std=c++17 -I.. daqlive.cpp -o daqlive -lrt
+//
+//   daqlive                 # /daq_live, once per second
+//   daqlive /daq_live -i 0.5 -c 1
+//   daqlive --once          # one status line (exit 3 if no stream)
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/live_shm.h"
+
+static const char* state_name(uint32_t s){
+    return s==kLiveRunning ? "running" : s==kLiveEnded ? "ended" : "idle";
+}
+
+int main(int argc, char** argv){
+    std::string name = kDefaultLiveName;
+    double interval = 1.0;
+    int ch = -1;            // channel of the waveform summary (-1 = first in the record)
+    bool once = false;
+    for(int i=1;i<argc;++i){
+        std::string a = argv[i];
+        if(a=="-i" && i+1<argc) interval = std::max(0.05, std::atof(argv[++i]));
+        else if(a=="-c" && i+1<argc) ch = std::atoi(argv[++i]);
+        else if(a=="--once") once = true;
+        else if(a=="-h" || a=="--help"){ fprintf(stderr,"Usage: %s [/name] [-i seconds] [-c ch] [--once]\n", argv[0]); return 0; }
+        else name = a;
+    }
+
+    LiveReader rd;
+    uint64_t lastHead = 0, gen = 0;
+    auto tLast = std::chrono::steady_clock::now();
+    std::vector<uint16_t> w;
+    for(;;){
+        if(rd.stale() && !rd.open(name)){
+            if(once){ fprintf(stderr,"[ERR] no live stream '%s'\n", name.c_str()); return 3; }
+            printf("[live] waiting for '%s'\n", name.c_str());
+            fflush(stdout);
+            std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+            continue;
+        }
+        if(rd.header()->generation.load() != gen){ gen = rd.header()->generation.load(); lastHead = rd.head(); }
+        LiveStatus st;
+        if(!rd.status(st)){ std::this_thread::sleep_for(std::chrono::milliseconds(10)); continue; }
+        const auto now = std::chrono::steady_clock::now();
+        const double dt = std::chrono::duration<double>(now - tLast).count();
+        const uint64_t head = rd.head();
+        const double pubRate = dt > 0 && head >= lastHead ? (head - lastHead)/dt : 0.0;
+        lastHead = head; tLast = now;
+
+        const double age = st.updateWallNs ? (double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now().time_since_epoch()).count()) - double(st.updateWallNs))*1e-9 : 0.0;
+        printf("[live] %s tag=%s serial=%u  events=%llu  rate %.1f Hz  trig %.1f Hz  dead %.2f%%  (%.1f s ago)  T=",
+               state_name(st.state), st.tag, st.serial, (unsigned long long)st.events, st.eventRate, st.triggerRate,
+               100*st.deadFrac, age);
+        for(int c=0;c<8;++c) printf(c ? ",%.0f" : "%.0f", st.temp[c]);
+        printf("  ring %.1f rec/s", pubRate);
+
+        // Latest record: copy out of the slot, keep it only if the writer did not lap it meanwhile.
+        const LiveHeader& h = *rd.header();
+        bool have = false;
+        uint32_t cnt = 0; int wc = -1;
+        if(head && rd.peek(head - 1, [&](const LiveRecord& r){
+                wc = ch;
+                if(wc < 0) for(int c=0;c<8;++c) if((r.chMask>>c)&1){ wc = c; break; }
+                const uint16_t* s = wc >= 0 && wc < 8 ? live_channel(h, r, wc) : nullptr;
+                w.assign(s ? s : nullptr, s ? s + r.ns : nullptr);
+                cnt = r.eventCounter;
+            })) have = !w.empty();
+        if(have){
+            uint32_t mn = 0xFFFF, mx = 0; double base = 0;
+            const size_t nb = std::min<size_t>(w.size(), 64);
+            for(size_t i=0;i<w.size();++i){ mn = std::min<uint32_t>(mn, w[i]); mx = std::max<uint32_t>(mx, w[i]); }
+            for(size_t i=0;i<nb;++i) base += w[i];
+            base /= nb;
+            printf("  last #%u ch%d: baseline %.1f min %u max %u amp %.0f", cnt, wc, base, mn, mx, base - mn);
+        }
+        printf("\n");
+        fflush(stdout);
+        if(once) return 0;
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+    }
+}
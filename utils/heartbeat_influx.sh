@@ -1,15 +1,22 @@
 #!/usr/bin/env bash
 set -euo pipefail
 # Env required: INFLUX_HOST, INFLUX_PORT, INFLUX_DB
-# Optional: INFLUX_USER, INFLUX_PASS
+# Optional: INFLUX_USER, INFLUX_PASS, INFLUX_SPOOL (points wait there while Influx is down)
 # Usage: heartbeat_influx_v1.sh <measurement> <status_int> <tags...>
+# The line is built with shell builtins and handed to influx_push, which also replays the spool;
+# only without influx_push does it fall back to curl.
 
 meas="${1:-daq_heartbeat}"; shift || true
 status="${1:-0}"; shift || true
 tags="$*"
 
-ts_ns=$(date +%s%N)
-line="${meas},host=$(hostname)${tags:+,}${tags} status=${status}i ${ts_ns}"
+ts_ns="${EPOCHREALTIME//[.,]/}000"
+line="${meas},host=${HOSTNAME}${tags:+,}${tags} status=${status}i ${ts_ns}"
+
+push="${BASH_SOURCE[0]%/*}/influx_push"
+if [[ -x "${push}" ]]; then
+  exec "${push}" -l "${line}"
+fi
 
 base="http://${INFLUX_HOST}:${INFLUX_PORT}/write?db=${INFLUX_DB}&precision=ns"
 if [[ -n "${INFLUX_USER:-}" && -n "${INFLUX_PASS:-}" ]]; then
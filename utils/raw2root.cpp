@@ -0,0 +1,170 @@
+// Offline decoder for --raw dumps: memory-maps the file, walks the blocks and decodes
+// the X730 events (common/x730.h) into the same ROOT layout daq_threshold writes.
+// Build: g++ -O2 -std=c++17 -I.. raw2root.cpp -o raw2root $(root-config --cflags --libs)
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TDirectory.h>
+#include <TH1I.h>
+#include <TTree.h>
+
+#include "common/rawfile.h"
+#include "common/run_clock.h"
+#include "common/waves_tree.h"
+#include "common/x730.h"
+
+static void usage(const char* prog){
+    fprintf(stderr,
+        "Usage: %s in.x7raw out.root [--format tree|packed|th1] [--compress alg[:level]] [--basket bytes]\n"
+        "          [--tag name] [--all-channels]\n"
+        "  By default the run's --save-mask channels are written; --all-channels writes every enabled one.\n", prog);
+}
+
+int main(int argc, char** argv){
+    std::string in, out, format = "tree", compress, tagOverride;
+    int basket = 0;
+    bool allCh = false;
+    for(int i=1;i<argc;++i){
+        std::string a = argv[i];
+        auto need = [&](const char* o)->const char*{
+            if(i+1>=argc){ fprintf(stderr,"missing after %s\n",o); std::exit(2); }
+            return argv[++i];
+        };
+        if(a=="--format") format = need("--format");
+        else if(a=="--compress") compress = need("--compress");
+        else if(a=="--basket") basket = std::atoi(need("--basket"));
+        else if(a=="--tag") tagOverride = need("--tag");
+        else if(a=="--all-channels") allCh = true;
+        else if(a=="-h" || a=="--help"){ usage(argv[0]); return 0; }
+        else if(in.empty()) in = a;
+        else if(out.empty()) out = a;
+        else { usage(argv[0]); return 2; }
+    }
+    if(in.empty() || out.empty() || (format!="tree" && format!="packed" && format!="th1")){ usage(argv[0]); return 2; }
+    const int comp = compress.empty() ? -1 : parse_root_compression(compress);
+    if(!compress.empty() && comp<0){ fprintf(stderr,"[ERR] unknown --compress '%s'\n", compress.c_str()); return 2; }
+
+    RawMap map;
+    if(!map.open(in)){ fprintf(stderr,"[ERR] cannot map '%s'\n", in.c_str()); return 1; }
+
+    TFile* rfile = TFile::Open(out.c_str(), "UPDATE");
+    if(!rfile || rfile->IsZombie()){
+        rfile = TFile::Open(out.c_str(), "RECREATE");
+        if(rfile && !rfile->IsZombie() && comp>=0) rfile->SetCompressionSettings(comp);
+    }
+    if(!rfile || rfile->IsZombie()){ fprintf(stderr,"[ERR] cannot open '%s'\n", out.c_str()); return 1; }
+
+    // runinfo, same branches as daq_threshold
+    int    ri_N=0, ri_ch=0, ri_recLen=0, ri_post=0;
+    unsigned ri_delta=0, ri_ped=0, ri_thr=0, ri_pairmask=0;
+    std::string ri_trig, ri_tag;
+    std::string *ri_trigp = &ri_trig, *ri_tagp = &ri_tag;
+    TTree* runinfo = (TTree*)rfile->Get("runinfo");
+    if(runinfo){
+        runinfo->SetBranchAddress("N",         &ri_N);
+        runinfo->SetBranchAddress("ch",        &ri_ch);
+        runinfo->SetBranchAddress("recLen",    &ri_recLen);
+        runinfo->SetBranchAddress("post",      &ri_post);
+        runinfo->SetBranchAddress("delta",     &ri_delta);
+        runinfo->SetBranchAddress("ped",       &ri_ped);
+        runinfo->SetBranchAddress("thr_abs",   &ri_thr);
+        runinfo->SetBranchAddress("pair_mask", &ri_pairmask);
+        runinfo->SetBranchAddress("trig_mode", &ri_trigp);
+        runinfo->SetBranchAddress("tag",       &ri_tagp);
+    } else {
+        runinfo = new TTree("runinfo","acquisition metadata");
+        runinfo->Branch("N",         &ri_N,        "N/I");
+        runinfo->Branch("ch",        &ri_ch,       "ch/I");
+        runinfo->Branch("recLen",    &ri_recLen,   "recLen/I");
+        runinfo->Branch("post",      &ri_post,     "post/I");
+        runinfo->Branch("delta",     &ri_delta,    "delta/i");
+        runinfo->Branch("ped",       &ri_ped,      "ped/i");
+        runinfo->Branch("thr_abs",   &ri_thr,      "thr_abs/i");
+        runinfo->Branch("pair_mask", &ri_pairmask, "pair_mask/i");
+        runinfo->Branch("trig_mode", &ri_trig);
+        runinfo->Branch("tag",       &ri_tag);
+    }
+
+    TDirectory* dtag = nullptr;
+    WavesTree waves;
+    RawFileHeader run{};
+    uint32_t saveMask = 0;
+    std::vector<uint16_t> buf;
+    uint64_t nev = 0, nblk = 0, idx = 0;
+    RunClock clk; // t_ns per event; the block wall times catch rollovers across quiet periods
+
+    auto finishRun = [&]{
+        if(waves.tree){ waves.write(); waves = WavesTree{}; }
+        rfile->cd();
+    };
+
+    const auto t0 = std::chrono::steady_clock::now();
+    bool clean = map.walk(
+        [&](const RawFileHeader& fh){
+            finishRun();
+            run = fh;
+            ri_N=fh.N; ri_ch=fh.ch; ri_recLen=fh.recLen; ri_post=fh.post;
+            ri_delta=fh.delta; ri_ped=fh.ped; ri_thr=fh.thrAbs; ri_pairmask=fh.pairMask;
+            ri_trig = std::string(fh.trig, strnlen(fh.trig, sizeof(fh.trig)));
+            ri_tag  = tagOverride.empty() ? std::string(fh.tag, strnlen(fh.tag, sizeof(fh.tag))) : tagOverride;
+            runinfo->Fill();
+            if(!(dtag = (TDirectory*)rfile->Get(ri_tag.c_str()))) dtag = rfile->mkdir(ri_tag.c_str());
+            saveMask = allCh ? (fh.enMask & 0xFF) : (fh.saveMask ? fh.saveMask & 0xFF : 1u << fh.ch);
+            buf.assign(fh.recLen > 0 ? fh.recLen : 0, 0);
+            idx = 0;
+            clk = RunClock{};
+            if(format!="th1") waves.attach(dtag, (uint32_t)fh.recLen, saveMask, basket, comp, format=="packed");
+            rfile->cd();
+        },
+        [&](const RawBlockHeader& bh, const char* payload){
+            ++nblk;
+            x730_for_each(payload, bh.bytes, [&](const X730Event& ev){
+                const uint32_t ns = std::min<uint32_t>(2*ev.wordsPerCh, (uint32_t)buf.size());
+                const uint64_t tNs = clk.add(ev.counter, ev.ttt, bh.wallNs);
+                if(waves.tree){
+                    waves.EventCounter = ev.counter;
+                    waves.TriggerTimeTag = ev.ttt;
+                    waves.TimeNs = tNs;
+                    waves.ChannelMask = ev.chMask;
+                }
+                for(int c=0;c<8;++c){
+                    if(!((saveMask>>c)&1)) continue;
+                    const bool present = (ev.chMask>>c)&1;
+                    if(present) x730_unpack(x730_channel(ev, c), ns/2, buf.data());
+                    if(waves.tree){
+                        waves.set(c, buf.data(), present ? ns : 0);
+                    } else if(dtag && present && ns>0){
+                        dtag->cd();
+                        char hname[128], htitle[256];
+                        snprintf(hname,  sizeof(hname),  "wave_ev%06d_ch%d", (int)idx, c);
+                        snprintf(htitle, sizeof(htitle), "Event %d, ch %d;sample;ADC", (int)idx, c);
+                        TH1I h(hname, htitle, ns, 0.0, double(ns));
+                        for(uint32_t s=0; s<ns; ++s) h.SetBinContent(int(s)+1, buf[s]);
+                        h.Write();
+                    }
+                }
+                waves.fill();
+                ++idx; ++nev;
+            });
+        });
+    finishRun();
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+    runinfo->Write("", TObject::kOverwrite);
+    rfile->Write();
+    rfile->Close();
+    delete rfile;
+
+    if(waves.packedBytes) printf("[info] packed waveforms: %.1f MB -> %.1f MB (ratio %.2f)\n",
+                                 waves.rawBytes/1e6, waves.packedBytes/1e6, waves.pack_ratio());
+    if(!clean) fprintf(stderr,"[warn] '%s' is truncated or corrupt; decoded what was readable\n", in.c_str());
+    printf("[ok] %llu events in %llu blocks, %.1f MB in %.2f s (%.1f MB/s) -> %s\n",
+           (unsigned long long)nev, (unsigned long long)nblk, map.size()/1e6, sec,
+           sec>0 ? map.size()/1e6/sec : 0.0, out.c_str());
+    return clean ? 0 : 1;
+}
@@ -1,7 +1,12 @@
+// Build: g++ -O2 -std=c++17 -I.. read_temp_influx.cpp -o read_temp_influx -lcurl -lCAENDigitizer
+// Points go through the batching exporter (common/influx.h): one keep-alive connection for the
+// whole loop, and a spool file that keeps them while the Influx host is down.
 #include <CAENDigitizer.h>
-#include <curl/curl.h>
+#include <fcntl.h>
+#include <sys/file.h>
 #include <unistd.h>       // gethostname
 #include <chrono>
+#include <csignal>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -11,6 +16,12 @@
 #include <thread>
 #include <vector>
 
+#include "common/daq_socket.h"
+#include "common/influx.h"
+
+static volatile sig_atomic_t g_stop = 0;
+static void on_signal(int) { g_stop = 1; }
+
 struct Config {
     std::string influx_host = "127.0.0.1";
     int influx_port = 8086;
@@ -19,15 +30,23 @@ struct Config {
     int interval_sec = 5;
     bool once = false;
     bool verbose = false;
+    std::string daemon_socket;  // ask a running daq_threshold --daemon instead of opening the board
+    std::string lock_path;      // open the board only while holding this lock, once per reading
+    double flush_sec = 10;      // batch points for up to this long
+    std::string spool;          // keep unsent points here while Influx is unreachable
+    double spool_max_mb = 32;
 };
 
 static void usage(const char* prog) {
     std::cerr <<
     "Usage: " << prog << " --influx-host <HOST> --influx-port <PORT> --influx-db <DB> --measurement <MEAS>\n"
-    "       [--interval <seconds>] [--once] [--verbose]\n\n"
+    "       [--interval <seconds>] [--once] [--verbose] [--daemon-socket <path>] [--lock <file>]\n"
+    "       [--flush <seconds>] [--spool <file>] [--spool-max <MB>]\n\n"
     "Example:\n"
     "  " << prog << " --influx-host 192.168.197.46 --influx-port 8086 \\\n"
-    "      --influx-db AmBeHV --measurement DT5730S --interval 5 --verbose\n";
+    "      --influx-db AmBeHV --measurement DT5730S --interval 5 --verbose\n"
+    "  " << prog << " ... --daemon-socket /home/ANNIE/daq/.daq.sock --lock /home/ANNIE/daq/.caen.lock \\\n"
+    "      --spool /home/ANNIE/daq/spool/influx.lp   # one long-lived process for temp_loop.sh\n";
 }
 
 static bool parse_args(int argc, char** argv, Config& cfg) {
@@ -45,6 +64,11 @@ static bool parse_args(int argc, char** argv, Config& cfg) {
         else if (a == "--interval")    cfg.interval_sec= std::atoi(need_value("--interval"));
         else if (a == "--once")        cfg.once = true;
         else if (a == "--verbose")     cfg.verbose = true;
+        else if (a == "--daemon-socket") cfg.daemon_socket = need_value("--daemon-socket");
+        else if (a == "--lock")        cfg.lock_path = need_value("--lock");
+        else if (a == "--flush")       cfg.flush_sec = std::atof(need_value("--flush"));
+        else if (a == "--spool")       cfg.spool = need_value("--spool");
+        else if (a == "--spool-max")   cfg.spool_max_mb = std::atof(need_value("--spool-max"));
         else if (a == "-h" || a == "--help") { usage(argv[0]); return false; }
         else { std::cerr << "Unknown arg: " << a << "\n"; usage(argv[0]); return false; }
     }
@@ -57,32 +81,6 @@ static std::string get_hostname() {
     return "unknown-host";
 }
 
-static bool influx_write(const Config& cfg, const std::string& line_protocol) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return false;
-
-    std::ostringstream url;
-    url << "http://" << cfg.influx_host << ":" << cfg.influx_port
-        << "/write?db=" << cfg.influx_db;
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.str().c_str());
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, line_protocol.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)line_protocol.size());
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L); // short network timeout
-
-    // Optional: quiet down
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
-    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 0L);
-
-    CURLcode res = curl_easy_perform(curl);
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    curl_easy_cleanup(curl);
-
-    return (res == CURLE_OK && (http_code == 204 || http_code == 200));
-}
-
 // Probe which 'ch' index returns a valid temperature
 static int find_temp_channel(int handle, bool verbose) {
     for (int ch = 0; ch < 8; ++ch) {
@@ -111,21 +109,65 @@ int main(int argc, char** argv) {
     Config cfg;
     if (!parse_args(argc, argv, cfg)) return 2;
 
-    // Open digitizer (USB, link 0)
+    // Open digitizer (USB, link 0), unless the acquisition daemon owns it or it is shared under
+    // --lock (then it is opened per reading, while the lock is held, and closed again).
     int handle = -1;
-    if (CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_USB, 0, 0, 0, &handle) != CAEN_DGTZ_Success) {
-        std::cerr << "[error] Failed to open digitizer (USB, 0,0,0).\n";
-        return 1;
-    }
+    int temp_ch = -1;
+    if (cfg.daemon_socket.empty() && cfg.lock_path.empty()) {
+        if (CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_USB, 0, 0, 0, &handle) != CAEN_DGTZ_Success) {
+            std::cerr << "[error] Failed to open digitizer (USB, 0,0,0).\n";
+            return 1;
+        }
 
-    // Find which temperature channel works
-    int temp_ch = find_temp_channel(handle, cfg.verbose);
-    if (temp_ch < 0) {
-        std::cerr << "[error] Could not find a readable temperature channel.\n";
-        CAEN_DGTZ_CloseDigitizer(handle);
-        return 1;
+        // Find which temperature channel works
+        temp_ch = find_temp_channel(handle, cfg.verbose);
+        if (temp_ch < 0) {
+            std::cerr << "[error] Could not find a readable temperature channel.\n";
+            CAEN_DGTZ_CloseDigitizer(handle);
+            return 1;
+        }
     }
 
+    auto read_board = [&](int h, std::vector<int>& temps) {
+        for (int ch = 0; ch < 8; ++ch) {
+            uint32_t temp_raw = 0;
+            if (CAEN_DGTZ_ReadTemperature(h, ch, &temp_raw) == CAEN_DGTZ_Success)
+                temps[ch] = (int)temp_raw;
+        }
+    };
+
+    // Per-channel temperatures (C), -1 where unsupported
+    auto read_temps = [&](std::vector<int>& temps)->bool {
+        temps.assign(8, -1);
+        if (!cfg.daemon_socket.empty()) {
+            std::string reply;
+            if (daq_request(cfg.daemon_socket, "TEMP", reply) && reply.compare(0, 8, "OK temp ") == 0) {
+                std::istringstream is(reply.substr(8));
+                for (int ch = 0; ch < 8 && (is >> temps[ch]); ++ch) {}
+                return true;
+            }
+            if (cfg.lock_path.empty()) {
+                std::cerr << "[error] daemon TEMP failed: " << (reply.empty() ? "not reachable" : reply) << "\n";
+                return false;
+            }
+        }
+        if (handle >= 0) { read_board(handle, temps); return true; }
+
+        // Shared board: skip this reading if a run holds the lock
+        int lfd = open(cfg.lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lfd < 0 || flock(lfd, LOCK_EX | LOCK_NB) != 0) {
+            if (lfd >= 0) close(lfd);
+            if (cfg.verbose) std::cerr << "[info] board busy (" << cfg.lock_path << "), reading skipped\n";
+            return false;
+        }
+        int h = -1;
+        bool ok = CAEN_DGTZ_OpenDigitizer(CAEN_DGTZ_USB, 0, 0, 0, &h) == CAEN_DGTZ_Success;
+        if (ok) { read_board(h, temps); CAEN_DGTZ_CloseDigitizer(h); }
+        else std::cerr << "[error] Failed to open digitizer (USB, 0,0,0).\n";
+        close(lfd);
+        return ok;
+    };
+
     std::string host = get_hostname();
     if (cfg.verbose) {
         std::cerr << "[info] Using measurement='" << cfg.measurement
@@ -134,74 +176,69 @@ int main(int argc, char** argv) {
         std::cerr << "[info] Host tag will be '" << host << "'; temp channel=" << temp_ch << "\n";
     }
 
-    // Init libcurl once
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-
-    auto loop_once = [&](bool& ok)->void {
-    ok = true;
-    std::ostringstream fields;
-    fields.setf(std::ios::fixed);
-    fields.precision(1);
-
-    // Query up to 8 channels and build Influx line protocol
-    for (int ch = 0; ch < 8; ++ch) {
-        uint32_t temp_raw = 0;
-        CAEN_DGTZ_ErrorCode ret = CAEN_DGTZ_ReadTemperature(handle, ch, &temp_raw);
-        if (ret == CAEN_DGTZ_Success && temp_raw < 200) {
-            double temp_c = static_cast<double>(temp_raw);
-            if (fields.tellp() > 0) fields << ",";
-            fields << "temp_ch" << ch << "=" << temp_c;
-            if (cfg.verbose)
-                std::cerr << "[debug] ch" << ch << " = " << temp_c << " C\n";
+    InfluxConfig icfg;
+    influx_config_from_env(icfg);       // user/pass (and a default spool) as the orchestrator exports them
+    icfg.host = cfg.influx_host;
+    icfg.port = cfg.influx_port;
+    icfg.db = cfg.influx_db;
+    icfg.flushSec = cfg.once ? 0 : cfg.flush_sec;
+    if (!cfg.spool.empty()) icfg.spool = cfg.spool;
+    icfg.spoolMax = (size_t)(cfg.spool_max_mb * 1e6);
+    icfg.verbose = cfg.verbose;
+    InfluxExporter influx(icfg);
+    const std::string series = lp_escape(cfg.measurement) + ",host=" + lp_escape(host) + ",device=DT5730S";
+
+    // One reading into the batch; false if nothing could be read.
+    auto loop_once = [&]()->bool {
+        std::string fields;
+        std::vector<int> temps;
+        if (!read_temps(temps)) return false;
+        for (int ch = 0; ch < 8; ++ch) {
+            if (temps[ch] >= 0 && temps[ch] < 200) {
+                lp_field(fields, ("temp_ch" + std::to_string(ch)).c_str(), temps[ch]);
+                if (cfg.verbose)
+                    std::cerr << "[debug] ch" << ch << " = " << temps[ch] << " C\n";
+            }
         }
-    }
-
-    if (fields.tellp() == 0) {
-        std::cerr << "[error] No valid temperature channels read.\n";
-        ok = false;
-        return;
-    }
-
-    std::ostringstream lp;
-    lp << cfg.measurement
-       << ",host=" << host
-       << ",device=DT5730S "
-       << fields.str();
-
-    std::string line = lp.str();
-    if (cfg.verbose)
-        std::cerr << "[debug] line-protocol: " << line << "\n";
-
-    bool sent = influx_write(cfg, line);
-    if (!sent) {
-        std::cerr << "[error] Failed to write to InfluxDB at "
-                  << cfg.influx_host << ":" << cfg.influx_port
-                  << " (db=" << cfg.influx_db << ")\n";
-        ok = false;
-        return;
-    }
-
-    std::cout << "Temperatures sent: " << fields.str() << std::endl;
-};
-
+        if (fields.empty()) {
+            std::cerr << "[error] No valid temperature channels read.\n";
+            return false;
+        }
+        if (cfg.verbose)
+            std::cerr << "[debug] line-protocol: " << series << " " << fields << "\n";
+        influx.add(series, fields);
+        std::cout << "Temperatures read: " << fields << std::endl;
+        return true;
+    };
 
     if (cfg.once) {
-        bool ok = false;
-        loop_once(ok);
-        curl_global_cleanup();
-        CAEN_DGTZ_CloseDigitizer(handle);
+        bool ok = loop_once() && influx.flush();
+        if (!ok && influx.stats().lines)
+            std::cerr << "[error] Failed to write to InfluxDB at " << cfg.influx_host << ":" << cfg.influx_port
+                      << " (db=" << cfg.influx_db << ")" << (icfg.spool.empty() ? "" : "; point spooled") << "\n";
+        if (handle >= 0) CAEN_DGTZ_CloseDigitizer(handle);
         return ok ? 0 : 1;
     }
 
-    // Continuous mode
-    while (true) {
-        bool ok = false;
-        loop_once(ok);
-        if (!ok) break;
-        std::this_thread::sleep_for(std::chrono::seconds(cfg.interval_sec));
+    // Continuous mode: a failed reading or write is logged and the loop goes on; unsent points
+    // wait in the spool. SIGINT/SIGTERM flush the batch before exiting.
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    auto next = std::chrono::steady_clock::now();
+    while (!g_stop) {
+        loop_once();
+        next += std::chrono::seconds(std::max(1, cfg.interval_sec));
+        while (!g_stop && std::chrono::steady_clock::now() < next) {
+            influx.poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
     }
+    influx.flush();
+    const InfluxStats& st = influx.stats();
+    std::cerr << "[info] " << st.lines << " points: " << st.sentLines << " sent, " << st.spooledLines << " spooled, "
+              << st.replayedLines << " replayed, " << st.droppedLines << " dropped; "
+              << st.posts << " posts on " << st.connects << " connection(s)\n";
 
-    curl_global_cleanup();
-    CAEN_DGTZ_CloseDigitizer(handle);
+    if (handle >= 0) CAEN_DGTZ_CloseDigitizer(handle);
     return 0;
 }
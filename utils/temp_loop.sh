@@ -1,13 +1,37 @@
 #!/usr/bin/env bash
 set -euo pipefail
 
+# One long-lived reader: a single keep-alive connection to Influx, points batched and spooled
+# while the host is down. With the acquisition daemon running, temperatures come through its
+# socket (no board open, no lock); otherwise the board is opened per reading under the shared
+# lock, and the reading is skipped while a run holds it.
+DAQ_SOCK="${DAQ_SOCK:-/home/ANNIE/daq/.daq.sock}"
+INFLUX_SPOOL="${INFLUX_SPOOL:-/home/ANNIE/daq/spool/influx.lp}"
+READER=/home/ANNIE/daq/utils/read_temp_influx
+LOG=/home/ANNIE/daq/logs/temp_influx.log
+BUILD="cd /home/ANNIE/daq/utils && g++ -O2 -std=c++17 -I.. read_temp_influx.cpp -o read_temp_influx -lcurl -lCAENDigitizer"
+mkdir -p "${INFLUX_SPOOL%/*}"
+
 while true; do
-  flock -n /home/ANNIE/daq/.caen.lock /home/ANNIE/daq/utils/read_temp_influx \
+  if [[ ! -x "${READER}" ]]; then
+    echo "[ERR] $(date -Is) ${READER} missing; build it: ${BUILD}" >>"${LOG}"
+    sleep 60; continue
+  fi
+  rc=0
+  "${READER}" \
     --influx-host 192.168.197.46 \
     --influx-port 8086 \
     --influx-db AmBeHV \
     --measurement DT5730S \
-    --once >>/home/ANNIE/daq/logs/temp_influx.log 2>&1 || true
-
-  sleep 5
+    --interval 5 \
+    --flush 10 \
+    --daemon-socket "${DAQ_SOCK}" \
+    --lock /home/ANNIE/daq/.caen.lock \
+    --spool "${INFLUX_SPOOL}" >>"${LOG}" 2>&1 || rc=$?
+  # exit 2 = option rejected: a binary older than read_temp_influx.cpp (--flush/--spool/--daemon-socket)
+  if (( rc == 2 )); then
+    echo "[ERR] $(date -Is) ${READER} rejects the loop's options; rebuild it: ${BUILD}" >>"${LOG}"
+    sleep 60; continue
+  fi
+  sleep 5   # only if it could not start
 done
@@ -0,0 +1,119 @@
+// Convert a run written with one TH1I key per event (wave_ev%06d_ch%d under each tag
+// directory) into the columnar format: one 'waves' TTree per tag (see common/waves_tree.h).
+// runinfo and temps are copied unchanged. EventCounter/TriggerTimeTag were never stored
+// in the TH1I format: EventCounter is set to the event index, TriggerTimeTag to 0.
+// Build: g++ -O2 -std=c++17 -I.. th1_to_tree.cpp -o th1_to_tree $(root-config --cflags --libs)
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TDirectory.h>
+#include <TKey.h>
+#include <TH1.h>
+#include <TTree.h>
+
+#include "common/waves_tree.h"
+
+static void usage(const char* prog){
+    fprintf(stderr,
+        "Usage: %s in.root [out.root] [--packed] [--compress alg[:level]] [--basket bytes]\n"
+        "  out.root defaults to in_tree.root; --packed stores codec-packed samples (common/wavecodec.h)\n", prog);
+}
+
+int main(int argc, char** argv){
+    std::string in, out, compress;
+    int basket = 0;
+    bool packed = false;
+    for(int i=1;i<argc;++i){
+        std::string a = argv[i];
+        if(a=="--compress" && i+1<argc) compress = argv[++i];
+        else if(a=="--basket" && i+1<argc) basket = std::atoi(argv[++i]);
+        else if(a=="--packed") packed = true;
+        else if(a=="-h" || a=="--help"){ usage(argv[0]); return 0; }
+        else if(in.empty()) in = a;
+        else if(out.empty()) out = a;
+        else { usage(argv[0]); return 2; }
+    }
+    if(in.empty()){ usage(argv[0]); return 2; }
+    if(out.empty()){
+        out = in;
+        auto dot = out.rfind(".root");
+        out = (dot==std::string::npos ? out : out.substr(0,dot)) + "_tree.root";
+    }
+    const int comp = compress.empty() ? -1 : parse_root_compression(compress);
+    if(!compress.empty() && comp<0){ fprintf(stderr,"[ERR] unknown --compress '%s'\n", compress.c_str()); return 2; }
+
+    TFile* fin = TFile::Open(in.c_str(), "READ");
+    if(!fin || fin->IsZombie()){ fprintf(stderr,"[ERR] cannot open '%s'\n", in.c_str()); return 1; }
+    TFile* fout = TFile::Open(out.c_str(), "RECREATE");
+    if(!fout || fout->IsZombie()){ fprintf(stderr,"[ERR] cannot create '%s'\n", out.c_str()); return 1; }
+    if(comp>=0) fout->SetCompressionSettings(comp);
+
+    for(const char* tn : {"runinfo", "temps"}){
+        auto* t = (TTree*)fin->Get(tn);
+        if(!t) continue;
+        fout->cd();
+        TTree* c = t->CloneTree(-1, "fast");
+        if(c) c->Write("", TObject::kOverwrite);
+    }
+
+    TIter nextDir(fin->GetListOfKeys());
+    while(auto* dk = (TKey*)nextDir()){
+        if(std::string(dk->GetClassName()).find("TDirectory")==std::string::npos) continue;
+        auto* din = (TDirectory*)dk->ReadObj();
+        if(!din) continue;
+
+        // event -> (channel -> key); highest cycle wins
+        std::map<int, std::map<int, TKey*>> evs;
+        uint32_t recLen = 0, mask = 0;
+        TIter next(din->GetListOfKeys());
+        while(auto* k = (TKey*)next()){
+            int ev=-1, c=-1;
+            if(std::sscanf(k->GetName(), "wave_ev%d_ch%d", &ev, &c)!=2 || c<0 || c>=8) continue;
+            if(std::string(k->GetClassName())!="TH1I") continue;
+            auto& slot = evs[ev][c];
+            if(!slot || k->GetCycle() > slot->GetCycle()) slot = k;
+            mask |= 1u<<c;
+        }
+        if(evs.empty()) continue;
+        // record length from the first histogram of the tag
+        if(auto* h = (TH1*)evs.begin()->second.begin()->second->ReadObj()){
+            recLen = (uint32_t)h->GetNbinsX();
+            delete h;
+        }
+
+        TDirectory* dout = fout->mkdir(din->GetName());
+        WavesTree wt;
+        wt.attach(dout, recLen, mask, basket, comp, packed);
+        std::vector<uint16_t> buf(recLen);
+        for(auto& [ev, chans] : evs){
+            wt.EventCounter = (uint32_t)ev;
+            wt.TriggerTimeTag = 0;
+            wt.ChannelMask = 0;
+            for(int c=0;c<8;++c) if((mask>>c)&1) wt.set(c, buf.data(), 0);
+            for(auto& [c, k] : chans){
+                auto* h = (TH1*)k->ReadObj();
+                if(!h) continue;
+                const uint32_t n = std::min<uint32_t>(recLen, (uint32_t)h->GetNbinsX());
+                for(uint32_t s=0;s<n;++s) buf[s] = (uint16_t)h->GetBinContent(int(s)+1);
+                wt.set(c, buf.data(), n);
+                wt.ChannelMask |= 1u<<c;
+                delete h;
+            }
+            wt.fill();
+        }
+        wt.write();
+        printf("[conv] %s: %zu events, recLen=%u, channels=0x%02x\n", din->GetName(), evs.size(), recLen, mask);
+        if(packed) printf("[conv] %s: packed ratio %.2f\n", din->GetName(), wt.pack_ratio());
+    }
+
+    fout->Write();
+    fout->Close();
+    fin->Close();
+    printf("[ok] wrote %s\n", out.c_str());
+    return 0;
+}